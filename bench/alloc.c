@@ -0,0 +1,66 @@
+/* alloc.c
+ * Benchmark for reference counted memory and message allocation
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Times allocation of reference counted memory and messages through
+//the installed allocator.
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#define N_ROUNDS 200000
+#define N_LIVE 64
+#define N_MSGS 2000000
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+	void *live[N_LIVE];
+	double start;
+	int i, j;
+	
+	//Mixed sizes from 16 to 715 bytes, N_LIVE alive at a time
+	start = now();
+	for (i = 0; i < N_ROUNDS; i++)
+	{
+		for (j = 0; j < N_LIVE; j++)
+			live[j] = mtc_rcmem_alloc(16 + (j * 37) % 700);
+		for (j = 0; j < N_LIVE; j++)
+			mtc_rcmem_unref(live[j]);
+	}
+	printf("rcmem alloc+unref: %.1f ns\n", 
+		(now() - start) / ((double) N_ROUNDS * N_LIVE) * 1e9);
+	
+	start = now();
+	for (i = 0; i < N_MSGS; i++)
+		mtc_msg_unref(mtc_msg_new(40, 0));
+	printf("mtc_msg_new+unref: %.1f ns\n", 
+		(now() - start) / N_MSGS * 1e9);
+	
+	return 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+
+# bigschema.sh
+# Writes a large schema to standard output, used to time mdlc
+# 
+# Copyright 2013 Akash Rawal
+# This file is part of MTC.
+# 
+# MTC is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+# 
+# MTC is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+#
+
+# Usage: bigschema.sh N > big.mdl; time mdlc big.mdl
+#
+# The schema has N macros, N enumerations of 3 values, N structures
+# and N/10 classes. Every structure uses a macro for an array size and
+# refers to one of the first 50 structures, so that lookups rather
+# than code generation for deeply nested types dominate.
+
+if test $# -ne 1; then
+	echo "Usage: $0 N" >&2
+	exit 1
+fi
+
+awk -v n="$1" 'BEGIN {
+	for (i = 0; i < n; i++)
+		printf("_define M%d %d\n", i, i % 200 + 1);
+	for (i = 0; i < n; i++)
+		printf("enum E%d { E%d_a, E%d_b, E%d_c }\n", i, i, i, i);
+	for (i = 0; i < n; i++)
+	{
+		prev = (i >= 50) ? sprintf("S%d", i % 50) : "uint32";
+		printf("struct S%d\n{\n\tuint32 id;\n\tstring name;\n", i);
+		printf("\tarray M%d uchar key;\n\tref %s prev;\n", i, prev);
+		printf("\tE%d kind;\n\tseq uint64 vals;\n}\n", i);
+	}
+	for (i = 0; i < n; i += 10)
+	{
+		printf("class C%d\n{\n\tget(S%d s; | uint32 r;);\n", i, i);
+		printf("\tput(E%d e;);\n}\n", i);
+	}
+}'
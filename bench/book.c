@@ -0,0 +1,179 @@
+/* book.c
+ * Benchmark for message size and speed of an order book schema
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Book is a snapshot of 10 levels on both sides, Trades carries 256
+//deltas. The same program is built for fixed width and for variable
+//length integers:
+//
+//    mdlc book_fixed.mdl; mdlc book_var.mdl
+//    cc -O2 -o book_fixed book.c `pkg-config --cflags --libs mtc0`
+//    cc -O2 -DBOOK_VAR -o book_var book.c `pkg-config --cflags --libs mtc0`
+//
+//Variable length integers pay off on links slower than
+//    8 * (fixed bytes - var bytes) / (var time - fixed time)
+//bits per second, with time the sum of serialize and deserialize.
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifdef BOOK_VAR
+#include "book_var_declares.h"
+#include "book_var_defines.h"
+#else
+#include "book_fixed_declares.h"
+#include "book_fixed_defines.h"
+#endif
+
+#define N_LEVELS 10
+#define N_TRADES 256
+#define N_ITERS 20000
+#define N_RUNS 30
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+//Best time per message of serializing (or deserializing) n times
+static double time_book(Book *book, MtcMsg *msg, int n)
+{
+	Book res;
+	double start;
+	int i;
+	
+	start = now();
+	if (book)
+	{
+		for (i = 0; i < n; i++)
+			mtc_msg_unref(Book__serialize(book));
+	}
+	else
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (Book__deserialize(msg, &res) < 0)
+				exit(1);
+			Book__free(&res);
+		}
+	}
+	
+	return (now() - start) / n;
+}
+
+static double time_trades(Trades *trades, MtcMsg *msg, int n)
+{
+	Trades res;
+	double start;
+	int i;
+	
+	start = now();
+	if (trades)
+	{
+		for (i = 0; i < n; i++)
+			mtc_msg_unref(Trades__serialize(trades));
+	}
+	else
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (Trades__deserialize(msg, &res) < 0)
+				exit(1);
+			Trades__free(&res);
+		}
+	}
+	
+	return (now() - start) / n;
+}
+
+#define min_time(var, expr) \
+	do { double t_ = (expr); if (t_ < (var)) (var) = t_; } while (0)
+
+int main(void)
+{
+	Level bids[N_LEVELS], asks[N_LEVELS];
+	int64_t ts_deltas[N_TRADES], price_deltas[N_TRADES];
+	uint32_t qtys[N_TRADES];
+	Book book;
+	Trades trades;
+	MtcMsg *book_msg, *trades_msg;
+	double book_ser = 1, book_deser = 1, trades_ser = 1, trades_deser = 1;
+	int i, run;
+	
+	srand(1);
+	for (i = 0; i < N_LEVELS; i++)
+	{
+		bids[i].price = 1012345 - i;
+		bids[i].qty = 1 + rand() % 2000;
+		bids[i].orders = 1 + rand() % 30;
+		asks[i].price = 1012346 + i;
+		asks[i].qty = 1 + rand() % 2000;
+		asks[i].orders = 1 + rand() % 30;
+	}
+	book.instrument = 48213;
+	book.seqno = 912345678;
+	book.timestamp = 1700000000123456789LL;
+	book.bids.data = bids;
+	book.bids.len = N_LEVELS;
+	book.asks.data = asks;
+	book.asks.len = N_LEVELS;
+	
+	for (i = 0; i < N_TRADES; i++)
+	{
+		ts_deltas[i] = rand() % 5000;
+		price_deltas[i] = rand() % 7 - 3;
+		qtys[i] = 1 + rand() % 500;
+	}
+	trades.instrument = 48213;
+	trades.ts_deltas.data = ts_deltas;
+	trades.ts_deltas.len = N_TRADES;
+	trades.qtys.data = qtys;
+	trades.qtys.len = N_TRADES;
+	trades.price_deltas.data = price_deltas;
+	trades.price_deltas.len = N_TRADES;
+	
+	book_msg = Book__serialize(&book);
+	trades_msg = Trades__serialize(&trades);
+	
+	for (run = 0; run < N_RUNS; run++)
+	{
+		min_time(book_ser, time_book(&book, NULL, N_ITERS));
+		min_time(book_deser, time_book(NULL, book_msg, N_ITERS));
+		min_time(trades_ser, time_trades(&trades, NULL, N_ITERS / 10));
+		min_time(trades_deser, time_trades(NULL, trades_msg, N_ITERS / 10));
+	}
+	
+	printf("Book   %5zu bytes, serialize %7.1f ns, deserialize %7.1f ns\n",
+		mtc_msg_get_blocks(book_msg)[0].size, 
+		book_ser * 1e9, book_deser * 1e9);
+	printf("Trades %5zu bytes, serialize %7.1f ns, deserialize %7.1f ns\n",
+		mtc_msg_get_blocks(trades_msg)[0].size, 
+		trades_ser * 1e9, trades_deser * 1e9);
+	
+	mtc_msg_unref(book_msg);
+	mtc_msg_unref(trades_msg);
+	
+	return 0;
+}
@@ -0,0 +1,93 @@
+/* ints.c
+ * Benchmark for encoding and decoding integer fields
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Times the generated __write and __read of a structure of 8 integer
+//fields, reusing one message so that only the conversions are
+//measured.
+//
+//    mdlc ints.mdl
+//    cc -O2 -o ints ints.c `pkg-config --cflags --libs mtc0`
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "ints_declares.h"
+#include "ints_defines.h"
+
+#define N_ITERS 2000000
+#define N_FIELDS 8
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+	Nums value = {1, 2, 3, -4, -5, 6, 7, -8}, res;
+	MtcMsg *msg;
+	MtcDStream dstream;
+	MtcSegment seg;
+	uint64_t sum = 0;
+	double start, encode, decode;
+	long i;
+	
+	msg = Nums__serialize(&value);
+	
+	start = now();
+	for (i = 0; i < N_ITERS; i++)
+	{
+		value.c = i;
+		mtc_msg_iter(msg, &dstream);
+		mtc_dstream_get_segment
+			(&dstream, mtc_msg_get_blocks(msg)[0].size, 0, &seg);
+		Nums__write(&value, &seg, &dstream);
+#ifdef __GNUC__
+		//Keep the stores from being optimized away
+		__asm__ volatile("" : : "r" (msg) : "memory");
+#endif
+	}
+	encode = now() - start;
+	
+	start = now();
+	for (i = 0; i < N_ITERS; i++)
+	{
+		mtc_msg_iter(msg, &dstream);
+		mtc_dstream_get_segment
+			(&dstream, mtc_msg_get_blocks(msg)[0].size, 0, &seg);
+		Nums__read(&res, &seg, &dstream);
+		sum += res.c + res.h;
+	}
+	decode = now() - start;
+	
+	printf("encode %.2f ns/field, decode %.2f ns/field (%lu)\n", 
+		encode / ((double) N_ITERS * N_FIELDS) * 1e9,
+		decode / ((double) N_ITERS * N_FIELDS) * 1e9, 
+		(unsigned long) sum);
+	
+	mtc_msg_unref(msg);
+	
+	return 0;
+}
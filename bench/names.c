@@ -0,0 +1,102 @@
+/* names.c
+ * Benchmark for validation of strings while reading messages
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Times deserializing and creating a view of a message holding
+//64 strings of various lengths, best of several runs.
+//
+//    mdlc names.mdl
+//    cc -O2 -o names names.c `pkg-config --cflags --libs mtc0`
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "names_declares.h"
+#include "names_defines.h"
+
+#define N_STRINGS 64
+#define N_ITERS 20000
+#define N_RUNS 15
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+	size_t lens[] = {8, 32, 128, 512};
+	char buf[600], *strings[N_STRINGS];
+	Names value, res;
+	Names__view view;
+	MtcMsg *msg;
+	double start, best_read, best_view, elapsed;
+	int i, l, run;
+	
+	for (l = 0; l < 4; l++)
+	{
+		for (i = 0; i < N_STRINGS; i++)
+		{
+			memset(buf, 'a' + i % 26, lens[l]);
+			buf[lens[l]] = 0;
+			strings[i] = mtc_rcmem_strdup(buf);
+		}
+		value.names.data = strings;
+		value.names.len = N_STRINGS;
+		msg = Names__serialize(&value);
+		
+		best_read = best_view = 1e9;
+		for (run = 0; run < N_RUNS; run++)
+		{
+			start = now();
+			for (i = 0; i < N_ITERS; i++)
+			{
+				if (Names__deserialize(msg, &res) < 0)
+					return 1;
+				Names__free(&res);
+			}
+			elapsed = now() - start;
+			if (elapsed < best_read)
+				best_read = elapsed;
+			
+			start = now();
+			for (i = 0; i < N_ITERS; i++)
+				if (Names__view_init(msg, &view) < 0)
+					return 1;
+			elapsed = now() - start;
+			if (elapsed < best_view)
+				best_view = elapsed;
+		}
+		printf("%d x %3zu bytes: deserialize %.0f ns, view_init %.0f ns\n", 
+			N_STRINGS, lens[l], best_read / N_ITERS * 1e9, 
+			best_view / N_ITERS * 1e9);
+		
+		mtc_msg_unref(msg);
+		for (i = 0; i < N_STRINGS; i++)
+			mtc_rcmem_unref(strings[i]);
+	}
+	
+	return 0;
+}
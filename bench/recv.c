@@ -0,0 +1,237 @@
+/* recv.c
+ * Benchmark for receiving and deserializing messages
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Usage: recv blocks|payload
+//
+//A message is sent through a socket pair as a frame (byte stream
+//size, number of blocks, block sizes, then the contents) and received
+//either into one allocation per block with one iovec each ('blocks')
+//or into the payload of mtc_msg_try_new_allocd() with a single
+//read() ('payload'). The received message is then deserialized and
+//freed. Strings in a payload are slices, so deserializing copies
+//them; this is included in the times.
+//
+//    mdlc recv.mdl
+//    cc -O2 -o recv recv.c `pkg-config --cflags --libs mtc0`
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "recv_declares.h"
+#include "recv_defines.h"
+
+#define N_ITERS 200000
+#define MAX_BLOCKS 16
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static MtcMBlock block_new(void *mem, size_t size)
+{
+	MtcMBlock res;
+	
+	res.mem = mem;
+	res.size = size;
+	res.parent = NULL;
+	
+	return res;
+}
+
+static void read_all(int fd, void *buf, size_t len)
+{
+	ssize_t res;
+	
+	while (len)
+	{
+		res = read(fd, buf, len);
+		if (res <= 0)
+		{
+			perror("read");
+			exit(1);
+		}
+		buf = MTC_PTR_ADD(buf, res);
+		len -= res;
+	}
+}
+
+static void send_frame(int fd, MtcMsg *msg)
+{
+	MtcMBlock *blocks = mtc_msg_get_blocks(msg);
+	size_t n_blocks = mtc_msg_get_n_blocks(msg), i;
+	uint32_t header[MAX_BLOCKS + 2];
+	struct iovec iov[MAX_BLOCKS + 1];
+	
+	header[0] = blocks[0].size;
+	header[1] = n_blocks - 1;
+	for (i = 1; i < n_blocks; i++)
+		header[i + 1] = blocks[i].size;
+	iov[0].iov_base = header;
+	iov[0].iov_len = (n_blocks + 1) * sizeof(uint32_t);
+	for (i = 0; i < n_blocks; i++)
+	{
+		iov[i + 1].iov_base = blocks[i].mem;
+		iov[i + 1].iov_len = blocks[i].size;
+	}
+	
+	if (writev(fd, iov, n_blocks + 1) < 0)
+	{
+		perror("writev");
+		exit(1);
+	}
+}
+
+//One allocation and one iovec per block
+static MtcMsg *recv_blocks(int fd)
+{
+	uint32_t header[MAX_BLOCKS + 2];
+	struct iovec iov[MAX_BLOCKS + 1];
+	MtcMBlock *blocks;
+	MtcMsg *msg;
+	size_t i, n_blocks, len = 0;
+	ssize_t res;
+	
+	read_all(fd, header, 2 * sizeof(uint32_t));
+	n_blocks = header[1];
+	read_all(fd, header + 2, n_blocks * sizeof(uint32_t));
+	
+	msg = mtc_msg_new(header[0], n_blocks);
+	blocks = mtc_msg_get_blocks(msg);
+	for (i = 1; i <= n_blocks; i++)
+		blocks[i] = block_new
+			(mtc_rcmem_alloc(header[i + 1]), header[i + 1]);
+	for (i = 0; i <= n_blocks; i++)
+	{
+		iov[i].iov_base = blocks[i].mem;
+		iov[i].iov_len = blocks[i].size;
+		len += blocks[i].size;
+	}
+	
+	//The whole frame fits in the socket buffer
+	res = readv(fd, iov, n_blocks + 1);
+	if (res < 0 || (size_t) res != len)
+	{
+		fprintf(stderr, "Short read\n");
+		exit(1);
+	}
+	
+	return msg;
+}
+
+//One allocation and one read() for the byte stream and all blocks
+static MtcMsg *recv_payload(int fd)
+{
+	uint32_t header[MAX_BLOCKS + 2];
+	MtcMsg *msg;
+	void *payload;
+	size_t size;
+	
+	read_all(fd, header, 2 * sizeof(uint32_t));
+	read_all(fd, header + 2, header[1] * sizeof(uint32_t));
+	
+	msg = mtc_msg_try_new_allocd(header[0], header[1], header + 2);
+	if (! msg)
+		exit(1);
+	payload = mtc_msg_get_payload(msg, &size);
+	read_all(fd, payload, size);
+	
+	return msg;
+}
+
+int main(int argc, char **argv)
+{
+	MtcMsg *(*recv_fn)(int fd);
+	Record value, res;
+	MtcMsg *msg, *received;
+	char text[4][400];
+	char data[4][700];
+	int fds[2], i;
+	double start, t_recv = 0, t_deser = 0;
+	
+	if (argc < 2 || (strcmp(argv[1], "blocks") && strcmp(argv[1], "payload")))
+	{
+		fprintf(stderr, "Usage: %s blocks|payload\n", argv[0]);
+		return 1;
+	}
+	recv_fn = strcmp(argv[1], "blocks") ? recv_payload : recv_blocks;
+	
+	//Strings of 300 to 390 bytes, raw values of 400 to 700 bytes
+	for (i = 0; i < 4; i++)
+	{
+		memset(text[i], 'a' + i, 300 + i * 30);
+		text[i][300 + i * 30] = 0;
+		memset(data[i], i, sizeof(data[i]));
+	}
+	value.id = 1;
+	value.name = mtc_rcmem_strdup(text[0]);
+	value.path = mtc_rcmem_strdup(text[1]);
+	value.comment = mtc_rcmem_strdup(text[2]);
+	value.owner = mtc_rcmem_strdup(text[3]);
+	value.thumbnail = block_new(mtc_rcmem_dup(data[0], 400), 400);
+	value.checksum = block_new(mtc_rcmem_dup(data[1], 500), 500);
+	value.extra = block_new(mtc_rcmem_dup(data[2], 600), 600);
+	value.data = block_new(mtc_rcmem_dup(data[3], 700), 700);
+	msg = Record__serialize(&value);
+	
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+	{
+		perror("socketpair");
+		return 1;
+	}
+	
+	for (i = 0; i < N_ITERS; i++)
+	{
+		send_frame(fds[0], msg);
+		
+		start = now();
+		received = recv_fn(fds[1]);
+		t_recv += now() - start;
+		
+		start = now();
+		if (Record__deserialize(received, &res) < 0)
+		{
+			fprintf(stderr, "Deserialization failed\n");
+			return 1;
+		}
+		mtc_msg_unref(received);
+		Record__free(&res);
+		t_deser += now() - start;
+	}
+	
+	printf("%s: receive %.1f ns, deserialize+free %.1f ns, total %.1f ns\n",
+		argv[1], t_recv / N_ITERS * 1e9, t_deser / N_ITERS * 1e9, 
+		(t_recv + t_deser) / N_ITERS * 1e9);
+	
+	mtc_msg_unref(msg);
+	Record__free(&value);
+	
+	return 0;
+}
@@ -0,0 +1,135 @@
+/* refcount.c
+ * Benchmark for reference counting of messages shared between threads
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Usage: refcount N_THREADS
+//Meaningful with a library configured with --enable-atomic-refcount;
+//the cross-thread part frees messages on another thread, which
+//otherwise is not allowed.
+//
+//    cc -O2 -o refcount refcount.c -pthread `pkg-config --cflags --libs mtc0`
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#define N_PAIRS 2000000
+#define N_MSGS 500000
+#define QUEUE_SIZE 1024
+#define MAX_THREADS 64
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+//All threads reference and unreference the same message
+static MtcMsg *shared;
+
+static void *ref_unref(void *arg)
+{
+	int i;
+	
+	for (i = 0; i < N_PAIRS; i++)
+	{
+		mtc_msg_ref(shared);
+		mtc_msg_unref(shared);
+	}
+	
+	return NULL;
+}
+
+//Messages are created by one thread and destroyed by another
+static MtcMsg *queue[QUEUE_SIZE];
+static unsigned int head, tail;
+
+static void *produce(void *arg)
+{
+	int i;
+	
+	for (i = 0; i < N_MSGS; i++)
+	{
+		MtcMsg *msg = mtc_msg_new(32, 0);
+		
+		while (head - __atomic_load_n(&tail, __ATOMIC_ACQUIRE) 
+			>= QUEUE_SIZE)
+			;
+		queue[head % QUEUE_SIZE] = msg;
+		__atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+	}
+	
+	return NULL;
+}
+
+static void *consume(void *arg)
+{
+	int i;
+	
+	for (i = 0; i < N_MSGS; i++)
+	{
+		while (__atomic_load_n(&head, __ATOMIC_ACQUIRE) == tail)
+			;
+		mtc_msg_unref(queue[tail % QUEUE_SIZE]);
+		__atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+	}
+	
+	return NULL;
+}
+
+int main(int argc, char **argv)
+{
+	pthread_t threads[MAX_THREADS];
+	int n_threads, i;
+	double start;
+	
+	n_threads = argc > 1 ? atoi(argv[1]) : 1;
+	if (n_threads < 1 || n_threads > MAX_THREADS)
+	{
+		fprintf(stderr, "Number of threads must be 1 to %d\n", 
+			MAX_THREADS);
+		return 1;
+	}
+	
+	shared = mtc_msg_new(16, 0);
+	start = now();
+	for (i = 0; i < n_threads; i++)
+		pthread_create(threads + i, NULL, ref_unref, NULL);
+	for (i = 0; i < n_threads; i++)
+		pthread_join(threads[i], NULL);
+	printf("%d threads, ref+unref of one message: %.1f ns/pair, "
+		"final refcount %d\n", 
+		n_threads, (now() - start) / N_PAIRS * 1e9, shared->refcount);
+	mtc_msg_unref(shared);
+	
+	start = now();
+	pthread_create(threads, NULL, produce, NULL);
+	pthread_create(threads + 1, NULL, consume, NULL);
+	pthread_join(threads[0], NULL);
+	pthread_join(threads[1], NULL);
+	printf("new on one thread, unref on another: %.1f ns/message\n", 
+		(now() - start) / N_MSGS * 1e9);
+	
+	return 0;
+}
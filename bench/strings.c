@@ -0,0 +1,90 @@
+/* strings.c
+ * Benchmark for serialization of short strings
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Compare blocks and allocations per message with and without
+//inline encoding of strings:
+//
+//    mdlc --inline-threshold=0 strings.mdl     (or 32)
+//    cc -O2 -o strings strings.c `pkg-config --cflags --libs mtc0`
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "strings_declares.h"
+#include "strings_defines.h"
+
+#define N_ITERS 1000000
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(void)
+{
+	char *tags[4] = {"admin", "staff", "beta", "eu"};
+	MtcAllocCounters counters;
+	Person value, res;
+	MtcMsg *msg;
+	size_t n_allocs = 0, n_blocks = 0;
+	double start;
+	int i;
+	
+	value.id = 7;
+	value.first = "Ada";
+	value.last = "Lovelace";
+	value.email = "ada@example.org";
+	value.city = "London";
+	value.country = "UK";
+	value.tags.data = tags;
+	value.tags.len = 4;
+	
+	mtc_set_alloc_accounting(1);
+	start = now();
+	for (i = 0; i < N_ITERS; i++)
+	{
+		msg = Person__serialize(&value);
+		n_blocks += mtc_msg_get_n_blocks(msg);
+		if (Person__deserialize(msg, &res) < 0)
+		{
+			fprintf(stderr, "Deserialization failed\n");
+			return 1;
+		}
+		Person__free(&res);
+		mtc_msg_unref(msg);
+	}
+	printf("serialize+deserialize+free: %.1f ns\n", 
+		(now() - start) / N_ITERS * 1e9);
+	
+	for (i = 0; i < MTC_ALLOC_CAT_N; i++)
+	{
+		mtc_get_alloc_counters(i, &counters);
+		n_allocs += counters.n_allocs;
+	}
+	printf("%.2f allocations, %.2f blocks per message\n", 
+		(double) n_allocs / N_ITERS, (double) n_blocks / N_ITERS);
+	
+	return 0;
+}
@@ -0,0 +1,98 @@
+/* tree.c
+ * Benchmark for serialization of nested sequences
+ * 
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ * 
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//Usage: tree N_NODES N_LEAVES
+//Compare serializing in one pass and with a counting pass:
+//
+//    mdlc --inline-threshold=16 --single-pass=always tree.mdl  (or never)
+//    cc -O2 -o tree tree.c `pkg-config --cflags --libs mtc0`
+
+#include <mtc0/mtc.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tree_declares.h"
+#include "tree_defines.h"
+
+static double now(void)
+{
+	struct timespec t;
+	
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t vals[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	char *tags[3] = {"a", "bb", "ccc"};
+	Tree tree;
+	int n_nodes, n_leaves, n_iters, i, j;
+	size_t n_bytes = 0;
+	double start;
+	
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s N_NODES N_LEAVES\n", argv[0]);
+		return 1;
+	}
+	n_nodes = atoi(argv[1]);
+	n_leaves = atoi(argv[2]);
+	
+	tree.nodes.len = n_nodes;
+	tree.nodes.data = (Node *) mtc_alloc(n_nodes * sizeof(Node));
+	for (i = 0; i < n_nodes; i++)
+	{
+		Node *node = tree.nodes.data + i;
+		
+		node->id = i;
+		node->tags.data = tags;
+		node->tags.len = 3;
+		node->leaves.len = n_leaves;
+		node->leaves.data = (Leaf *) mtc_alloc(n_leaves * sizeof(Leaf));
+		for (j = 0; j < n_leaves; j++)
+		{
+			node->leaves.data[j].name = "leafname";
+			node->leaves.data[j].vals.data = vals;
+			node->leaves.data[j].vals.len = 8;
+		}
+	}
+	
+	//About the same amount of work for every size
+	n_iters = 2000000 / (n_nodes * n_leaves + 1) + 1;
+	start = now();
+	for (i = 0; i < n_iters; i++)
+	{
+		MtcMsg *msg = Tree__serialize(&tree);
+		
+		n_bytes += mtc_msg_get_blocks(msg)[0].size;
+		mtc_msg_unref(msg);
+	}
+	printf("%d x %d: %.1f ns/message, %zu bytes\n", n_nodes, n_leaves, 
+		(now() - start) / n_iters * 1e9, n_bytes / n_iters);
+	
+	for (i = 0; i < n_nodes; i++)
+		mtc_free(tree.nodes.data[i].leaves.data);
+	mtc_free(tree.nodes.data);
+	
+	return 0;
+}
@@ -36,6 +36,7 @@ void mtc_write_one_way_serializers
 		//With arguments (structure, serializer deserializer)
 		
 		MtcSymbolVar *iter;
+		int single_pass;
 		
 		//Write the structure definition
 		fprintf(h_file, 
@@ -66,27 +67,49 @@ void mtc_write_one_way_serializers
 			klass->parent.name, member, sn,
 			klass->parent.name, member, as);
 		
+		single_pass = mtc_var_list_use_single_pass(list);
+		
 		//Declarations
 		fprintf(c_file, 
-			"    uint32_t member_ptr = %s | %d;\n"
+			"    uint32_t member_ptr = %s | %d;\n",
+			member_ptr_type, idx);
+		if (single_pass)
+			fprintf(c_file, 
+			"    MtcDStreamChunks chunks;\n");
+		else
+			fprintf(c_file, 
 			"    MtcMsg *res;\n"
-			"    MtcDLen size = {%d, %d};\n"
+			"    MtcDLen size = {%d, %d, 0};\n",
+			(int) base_size.n_bytes + 4, 
+			(int) base_size.n_blocks);
+		fprintf(c_file, 
 			"    MtcSegment seg_v;\n"
 			"    MtcSegment *seg = &seg_v;\n"
 			"    MtcDStream dstream_v;\n"
-			"    MtcDStream *dstream = &dstream_v;\n\n", 
-			member_ptr_type, idx, 
-			(int) base_size.n_bytes + 4, 
-			(int) base_size.n_blocks);
-		
-		//Count size of the message
-		mtc_var_list_code_for_count(list, "args->", c_file);
+			"    MtcDStream *dstream = &dstream_v;\n\n");
 		
-		//Create a message
-		fprintf(c_file, 
+		if (single_pass)
+		{
+			//Write into growable storage
+			fprintf(c_file, 
+			"    mtc_dstream_init_growable(dstream, &chunks);\n");
+		}
+		else
+		{
+			//Count size of the message
+			mtc_var_list_code_for_count(list, "args->", c_file);
+			
+			//Create a message
+			if (mtc_type_builder)
+				fprintf(c_file, 
+			"    res = mtc_msg_new_with_heap(size, dstream);\n");
+			else
+				fprintf(c_file, 
 			"    res = mtc_msg_new"
 			"(size.n_bytes, size.n_blocks);\n"
-			"    mtc_msg_iter(res, dstream);\n"
+			"    mtc_msg_iter(res, dstream);\n");
+		}
+		fprintf(c_file, 
 			"    mtc_dstream_get_segment(dstream, %d, %d, seg);\n\n",
 			(int) base_size.n_bytes + 4, 
 			(int) base_size.n_blocks);
@@ -99,7 +122,12 @@ void mtc_write_one_way_serializers
 		mtc_var_list_code_for_write(list, "args->", c_file);
 		
 		//Write function return value
-		fprintf(c_file, "\n"
+		if (single_pass)
+			fprintf(c_file, "\n"
+			"    return mtc_dstream_finish_growable(dstream);\n"
+			"}\n\n");
+		else
+			fprintf(c_file, "\n"
 			"    return res;\n"
 			"}\n\n");
 		
@@ -350,3 +378,42 @@ void mtc_class_gen_code
 		klass->parent.name, i);
 	}
 }
+
+//Writes C++ code for the class: a descriptor for each function to use
+//with mtc::fc_start() and mtc::fc_return() from <mtc0/mtc.hpp>
+void mtc_class_gen_cxx(MtcSymbolClass *klass, FILE *output)
+{
+	MtcSymbolFunc *fn;
+	
+	for (fn = klass->funcs; fn; 
+		fn = (MtcSymbolFunc *) fn->parent.next)
+	{
+		fprintf(output, 
+			"//%s::%s\n"
+			"struct %s__%s__fn\n"
+			"{\n",
+			klass->parent.name, fn->parent.name,
+			klass->parent.name, fn->parent.name);
+		
+		if (fn->in_args)
+			fprintf(output, "    typedef %s__%s__in_args In;\n",
+				klass->parent.name, fn->parent.name);
+		else
+			fprintf(output, "    typedef void In;\n");
+		
+		if (fn->out_args)
+			fprintf(output, "    typedef %s__%s__out_args Out;\n",
+				klass->parent.name, fn->parent.name);
+		else
+			fprintf(output, "    typedef void Out;\n");
+		
+		fprintf(output, 
+			"    \n"
+			"    static MtcFCBinary *binary()\n"
+			"    {\n"
+			"        return &%s__%s;\n"
+			"    }\n"
+			"};\n\n",
+			klass->parent.name, fn->parent.name);
+	}
+}
@@ -20,3 +20,5 @@
 
 void mtc_class_gen_code
 		(MtcSymbolClass *klass, FILE *h_file, FILE *c_file);
+
+void mtc_class_gen_cxx(MtcSymbolClass *klass, FILE *output);
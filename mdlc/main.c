@@ -20,6 +20,7 @@
 #include "common.h"
 
 #include <string.h>
+#include <stdlib.h>
 #include <argp.h>
 
 #include <config.h>
@@ -28,6 +29,7 @@
 
 MtcSourceGenerator generator[1];
 int debug = 0;
+int cxx = 0;
 const char *version_str = PACKAGE_VERSION;
 
 error_t parser(int key, char *arg, struct argp_state *state)
@@ -48,6 +50,52 @@ error_t parser(int key, char *arg, struct argp_state *state)
 		
 		return 0;
 	}
+	if (key == 'i')
+	{
+		char *end;
+		long val = strtol(arg, &end, 10);
+		
+		if (*arg == '\0' || *end != '\0' || val < 0 || val > 0xffff)
+			mtc_error("Inline threshold must be between 0 and 65535");
+		
+		mtc_type_inline_threshold = val;
+		
+		return 0;
+	}
+	if (key == 'B')
+	{
+		mtc_type_builder = 1;
+		return 0;
+	}
+	if (key == 'b')
+	{
+		mtc_c_borrow_strings = 1;
+		return 0;
+	}
+	if (key == 'P')
+	{
+		if (strcmp(arg, "auto") == 0)
+			mtc_c_single_pass = MTC_C_SINGLE_PASS_AUTO;
+		else if (strcmp(arg, "always") == 0)
+			mtc_c_single_pass = MTC_C_SINGLE_PASS_ALWAYS;
+		else if (strcmp(arg, "never") == 0)
+			mtc_c_single_pass = MTC_C_SINGLE_PASS_NEVER;
+		else
+			mtc_error("Single pass mode must be one of "
+				"auto, always or never");
+		
+		return 0;
+	}
+	if (key == 'S')
+	{
+		mtc_c_static_inline = 1;
+		return 0;
+	}
+	if (key == 'C')
+	{
+		cxx = 1;
+		return 0;
+	}
 	if (key == 'X')
 	{
 		debug = 1;
@@ -57,9 +105,20 @@ error_t parser(int key, char *arg, struct argp_state *state)
 	return ARGP_ERR_UNKNOWN;
 }
 
+//Copies contents of src to the end of dest
+static void append_file(FILE *dest, FILE *src)
+{
+	char buf[4096];
+	size_t len;
+	
+	rewind(src);
+	while ((len = fread(buf, 1, sizeof(buf), src)) > 0)
+		fwrite(buf, 1, len, dest);
+}
+
 int main(int argc, char *argv[])
 {
-	FILE *c_file, *h_file;
+	FILE *c_file, *h_file, *hpp_file = NULL;
 	int file_len;
 	char *file = NULL;
 	char *buffer;
@@ -77,6 +136,39 @@ int main(int argc, char *argv[])
 		struct argp_option options[] = {
 			{"define", 'D', "name=value", 0, 
 				"Define a string macro with a given value.", 0},
+			{"inline-threshold", 'i', "N", 0,
+				"Store strings and raw values of upto N bytes inline "
+				"in the byte stream instead of separate blocks. "
+				"Both ends must use the same value. "
+				"Default is 0 (disabled).", 0},
+			{"borrow-strings", 'b', NULL, 0,
+				"Make generated serializers reference strings instead "
+				"of copying them. All strings passed to them must "
+				"then be in reference counted memory, "
+				"e.g. from mtc_rcmem_strdup().", 0},
+			{"builder", 'B', NULL, 0,
+				"Make generated serializers build each message in a "
+				"single allocation, copying strings into it. "
+				"Cannot be used with --borrow-strings.", 0},
+			{"single-pass", 'P', "WHEN", 0,
+				"Whether generated serializers write messages in "
+				"a single pass into growable storage instead of "
+				"counting their size first. WHEN is one of "
+				"auto (for variable sized types with nested "
+				"sequences, with --inline-threshold only), "
+				"always or never (default). "
+				"Single pass is faster for small messages and "
+				"slower for large ones. "
+				"Not used with --builder.", 0},
+			{"static-inline", 'S', NULL, 0,
+				"Write functions for structures as static inline "
+				"functions into the _declares.h file, along with "
+				"inline versions of helpers from <mtc0/inline.h>, "
+				"so that compilers can inline them into callers.", 0},
+			{"cxx", 'C', NULL, 0,
+				"Also write a C++ header with the extension .hpp, "
+				"with views and function call descriptors to use "
+				"with <mtc0/mtc.hpp>. Requires C++20.", 0},
 			{"debug", 'X', NULL, OPTION_HIDDEN, 
 				"Enable debugging", 0},
 			{0}};
@@ -95,6 +187,10 @@ int main(int argc, char *argv[])
 			mtc_error("Exactly one file name is expected.");
 		
 		file = argv[arg_index];
+		
+		if (mtc_type_builder && mtc_c_borrow_strings)
+			mtc_error("--builder and --borrow-strings "
+				"cannot be used together");
 	}
 	
 	file_len = strlen(file);
@@ -191,7 +287,29 @@ int main(int argc, char *argv[])
 		c_file = fopen(buffer, "w");
 		strcpy(buffer + filename_len - 4, "_declares.h");
 		h_file = fopen(buffer, "w");
+		if (cxx)
+		{
+			strcpy(buffer + filename_len - 4, ".hpp");
+			hpp_file = fopen(buffer, "w");
+			
+			//The C declarations go first
+			strcpy(buffer + filename_len - 4, "_declares.h");
+			fprintf(hpp_file, 
+				"#pragma once\n"
+				"\n"
+				"#include <mtc0/mtc.hpp>\n"
+				"\n"
+				"extern \"C\"\n"
+				"{\n"
+				"#include \"%s\"\n"
+				"}\n"
+				"\n",
+				buffer);
+		}
 		mtc_free(buffer);
+		
+		if (mtc_c_static_inline)
+			fprintf(h_file, "#include <mtc0/inline.h>\n\n");
 	}
 	
 	//Generate code
@@ -201,16 +319,47 @@ int main(int argc, char *argv[])
 		{
 			if (iter->reflevel == 0)
 			{
-				if (iter->gc == mtc_symbol_struct_gc)
+				if (iter->gc == mtc_symbol_struct_gc 
+					&& mtc_c_static_inline)
+				{
+					//Functions go after all declarations for the 
+					//structure, as they may call each other
+					FILE *tmp_file = tmpfile();
+					
+					if (! tmp_file)
+						mtc_error("Cannot create temporary file");
+					mtc_struct_gen_code
+						((MtcSymbolStruct *) iter, h_file, tmp_file);
+					append_file(h_file, tmp_file);
+					fclose(tmp_file);
+				}
+				else if (iter->gc == mtc_symbol_struct_gc)
 				{
 					mtc_struct_gen_code
 						((MtcSymbolStruct *) iter, h_file, c_file);
 				}
+				else if (iter->gc == mtc_symbol_enum_gc)
+				{
+					mtc_enum_gen_code
+						((MtcSymbolEnum *) iter, h_file, c_file);
+				}
 				else if (iter->gc == mtc_symbol_class_gc)
 				{
 					mtc_class_gen_code
 						((MtcSymbolClass *) iter, h_file, c_file);
 				}
+				
+				//C++ header
+				if (hpp_file && iter->gc == mtc_symbol_struct_gc)
+				{
+					mtc_struct_gen_cxx
+						((MtcSymbolStruct *) iter, hpp_file);
+				}
+				else if (hpp_file && iter->gc == mtc_symbol_class_gc)
+				{
+					mtc_class_gen_cxx
+						((MtcSymbolClass *) iter, hpp_file);
+				}
 			}
 		}
 	}
@@ -218,6 +367,8 @@ int main(int argc, char *argv[])
 	//Close files
 	fclose(c_file);
 	fclose(h_file);
+	if (hpp_file)
+		fclose(hpp_file);
 	
 	//Free all resources
 	mtc_source_unref(source);
@@ -83,6 +83,9 @@ static int mtc_mdl_read_type
 	(MtcSymbolDB *symbol_db, MtcTokenIter *iter, MtcType *res, 
 	MtcSourceMsgList *el)
 {
+	res->enum_symbol = NULL;
+	res->bit = 0;
+	
 	//Test for complexity
 	if (mtc_match_id(iter, "seq"))
 	{
@@ -149,8 +152,7 @@ static int mtc_mdl_read_type
 		symbol_name = iter->cur->str;
 		
 		//Fetch the symbol
-		res->base.symbol = mtc_symbol_list_find
-			(symbol_db->head, symbol_name);
+		res->base.symbol = mtc_symbol_db_find(symbol_db, symbol_name);
 		if (! res->base.symbol)
 		{
 			mtc_source_msg_list_add
@@ -159,6 +161,16 @@ static int mtc_mdl_read_type
 			return -1;
 		}
 		
+		//Enumerations are stored as fundamental types
+		if (res->base.symbol->gc == mtc_symbol_enum_gc)
+		{
+			mtc_token_iter_next(iter);
+			res->enum_symbol = res->base.symbol;
+			res->cat = MTC_TYPE_FUNDAMENTAL;
+			res->base.fid = ((MtcSymbolEnum *) res->enum_symbol)->fid;
+			return 0;
+		}
+		
 		//Check symbol type
 		if (res->base.symbol->gc != mtc_symbol_struct_gc)
 		{
@@ -195,8 +207,10 @@ static char *mtc_mdl_read_idfier
 	
 	res = iter->cur->str;
 	
-	//Check for duplicates
-	same_name = mtc_symbol_list_find(symbol_db->head, res);
+	//Check for duplicates, values of enumerations are global in C too
+	same_name = mtc_symbol_db_find(symbol_db, res);
+	if (! same_name)
+		same_name = mtc_symbol_db_find_enum_value(symbol_db, res);
 	if (same_name)
 	{
 		mtc_source_msg_list_add
@@ -277,7 +291,7 @@ static int mtc_mdl_read_vars
 	}
 	
 	//Return data
-	*res = (MtcSymbolVar *) vars.head;
+	*res = (MtcSymbolVar *) mtc_symbol_db_steal(&vars);
 	
 	return 0;
 }
@@ -331,6 +345,104 @@ static MtcSymbolStruct *mtc_mdl_read_struct
 	return res;
 }
 
+//Read an enumeration
+static MtcSymbolEnum *mtc_mdl_read_enum
+	(MtcSymbolDB *symbol_db, MtcTokenIter *iter, MtcSourceMsgList *el)
+{
+	char *name, *value_name;
+	MtcSymbolDB values = MTC_SYMBOL_DB_INIT;
+	MtcSymbol *same_name;
+	MtcSourcePtr *location;
+	
+	//Word 'enum' has already been read.
+	
+	//Note down the location
+	location = iter->prev->location;
+	
+	//Read identifier
+	name = mtc_mdl_read_idfier(iter, symbol_db, el);
+	if (! name)
+		return NULL;
+	
+	//Next character should be '{'
+	if (! mtc_match_sym(iter, MTC_SC_LC))
+	{
+		mtc_expect_error(el, iter, "'{'");
+		return NULL;
+	}
+	mtc_token_iter_next(iter);
+	
+	//A list of values separated by ','
+	while (1)
+	{
+		//Value names should be unique within the enumeration
+		value_name = mtc_mdl_read_idfier(iter, &values, el);
+		if (! value_name)
+			goto fail;
+		
+		//and among all enumerations and other symbols, as they share 
+		//a namespace in C
+		same_name = mtc_symbol_db_find_enum_value(symbol_db, value_name);
+		if (same_name)
+		{
+			mtc_source_msg_list_add
+				(el, iter->prev->location, MTC_SOURCE_MSG_ERROR, 
+				"Redefinition of enumeration value \'%s\'", 
+				value_name);
+			mtc_source_msg_list_add
+				(el, same_name->location, MTC_SOURCE_MSG_ERROR, 
+				"'%s' was defined here.", value_name);
+			goto fail;
+		}
+		same_name = mtc_symbol_db_find(symbol_db, value_name);
+		if (same_name)
+		{
+			mtc_source_msg_list_add
+				(el, iter->prev->location, MTC_SOURCE_MSG_ERROR, 
+				"Redefinition of identifier \'%s\'", value_name);
+			mtc_source_msg_list_add
+				(el, same_name->location, MTC_SOURCE_MSG_ERROR, 
+				"'%s' was defined here.", value_name);
+			goto fail;
+		}
+		
+		if (strcmp(value_name, name) == 0)
+		{
+			mtc_source_msg_list_add
+				(el, iter->prev->location, MTC_SOURCE_MSG_ERROR, 
+				"Enumeration value \'%s\' has the name of "
+				"its enumeration", value_name);
+			mtc_source_msg_list_add
+				(el, location, MTC_SOURCE_MSG_ERROR, 
+				"'%s' was defined here.", name);
+			goto fail;
+		}
+		
+		mtc_symbol_db_append(&values, mtc_symbol_enum_value_new
+			(value_name, iter->prev->location));
+		
+		if (! mtc_match_sym(iter, MTC_SC_COMMA))
+			break;
+		mtc_token_iter_next(iter);
+	}
+	
+	//Now we should get '}'
+	if (! mtc_match_sym(iter, MTC_SC_RC))
+	{
+		mtc_expect_error(el, iter, "',' or '}'");
+		goto fail;
+	}
+	mtc_token_iter_next(iter);
+	
+	//Create new symbol for enum
+	return mtc_symbol_enum_new
+		(name, location, mtc_symbol_db_steal(&values));
+	
+fail:
+	mtc_symbol_db_free(&values);
+	return NULL;
+}
+
 //Read a class
 static MtcSymbolClass *mtc_mdl_read_class
 	(MtcSymbolDB *symbol_db, MtcTokenIter *iter, MtcSourceMsgList *el)
@@ -364,8 +476,7 @@ static MtcSymbolClass *mtc_mdl_read_class
 		}
 		
 		//Check whether parent class exists
-		parent_class = mtc_symbol_list_find
-			(symbol_db->head, iter->cur->str);
+		parent_class = mtc_symbol_db_find(symbol_db, iter->cur->str);
 		if (! parent_class)
 		{
 			mtc_source_msg_list_add
@@ -482,7 +593,7 @@ static MtcSymbolClass *mtc_mdl_read_class
 	//Create new symbol for class
 	res = mtc_symbol_class_new
 		(name, location, (MtcSymbolClass *) parent_class, 
-		(MtcSymbolFunc *) funcs.head);
+		(MtcSymbolFunc *) mtc_symbol_db_steal(&funcs));
 	
 	//Done
 	return res;
@@ -512,6 +623,18 @@ int mtc_mdl_parser_parse
 				break;
 			}
 		}
+		//Check for enum
+		else if (mtc_match_id(iter, "enum"))
+		{
+			mtc_token_iter_next(iter);
+			symbol = (MtcSymbol *) mtc_mdl_read_enum
+				(symbol_db, iter, el);
+			if (! symbol)
+			{
+				res = -1;
+				break;
+			}
+		}
 		//Check for class
 		else if (mtc_match_id(iter, "class"))
 		{
@@ -559,7 +682,7 @@ int mtc_mdl_parser_parse
 		else 
 		{
 			mtc_expect_error(el, iter, 
-				"'struct' or 'class' or 'ref'");
+				"'struct' or 'enum' or 'class' or 'ref'");
 			res = -1;
 			break;
 		}
@@ -29,40 +29,93 @@ MtcMacroDB *mtc_macro_db_new()
 {
 	MtcMacroDB *self = (MtcMacroDB *) mtc_alloc(sizeof(MtcMacroDB));
 	
-	self->macros = NULL;
+	self->buckets = NULL;
+	self->n_buckets = self->n_macros = 0;
 	
 	return self;
 }
 
-//Adds a macro definition
+//Finds the entry for a macro
+static MtcMacroEntry *mtc_macro_db_lookup(MtcMacroDB *self, const char *name)
+{
+	MtcMacroEntry *iter;
+	uint32_t hash;
+	
+	if (! self->n_macros)
+		return NULL;
+	
+	hash = mtc_name_hash(name);
+	for (iter = self->buckets[hash & (self->n_buckets - 1)]; iter;
+		iter = iter->next)
+	{
+		if (iter->hash == hash && strcmp(iter->name, name) == 0)
+			break;
+	}
+	
+	return iter;
+}
+
+//Doubles the number of buckets
+static void mtc_macro_db_grow(MtcMacroDB *self)
+{
+	MtcMacroEntry **old = self->buckets;
+	uint32_t n_old = self->n_buckets, i;
+	MtcMacroEntry *iter, *next, **bucket;
+	
+	self->n_buckets = n_old ? n_old * 2 : 16;
+	self->buckets = (MtcMacroEntry **) mtc_alloc
+		(sizeof(MtcMacroEntry *) * self->n_buckets);
+	memset(self->buckets, 0, sizeof(MtcMacroEntry *) * self->n_buckets);
+	
+	for (i = 0; i < n_old; i++)
+	{
+		for (iter = old[i]; iter; iter = next)
+		{
+			next = iter->next;
+			bucket = self->buckets + (iter->hash & (self->n_buckets - 1));
+			iter->next = *bucket;
+			*bucket = iter;
+		}
+	}
+	
+	if (old)
+		mtc_free(old);
+}
+
+//Adds a macro definition, replacing any previous definition
 void mtc_macro_db_add
 	(MtcMacroDB *self, const char *name, MtcToken *def)
 {
-	MtcMacroEntry *new_entry;
+	MtcMacroEntry *new_entry, *old_entry, **bucket;
+	
+	old_entry = mtc_macro_db_lookup(self, name);
+	if (old_entry)
+	{
+		mtc_token_list_free(old_entry->def);
+		old_entry->def = def;
+		return;
+	}
+	
+	if (self->n_macros >= self->n_buckets)
+		mtc_macro_db_grow(self);
 	
 	new_entry = (MtcMacroEntry *) mtc_alloc
 		(sizeof(MtcMacroEntry) + strlen(name));
 	
-	new_entry->next = self->macros;
 	new_entry->def = def;
+	new_entry->hash = mtc_name_hash(name);
 	strcpy(new_entry->name, name);
 	
-	self->macros = new_entry;
+	bucket = self->buckets + (new_entry->hash & (self->n_buckets - 1));
+	new_entry->next = *bucket;
+	*bucket = new_entry;
+	self->n_macros++;
 }
 
 //Returns 1 if the macro exists in database. 0 otherwise
 int mtc_macro_db_exists(MtcMacroDB *self, const char *name)
 {
-	MtcMacroEntry *iter;
-	
-	//Find the given macro
-	for (iter = self->macros; iter; iter = iter->next)
-	{
-		if (strcmp(iter->name, name) == 0)
-			return 1;
-	}
-	
-	return 0;
+	return mtc_macro_db_lookup(self, name) ? 1 : 0;
 }
 
 //Fetches a copy of macro definition with location modified 
@@ -76,12 +129,7 @@ MtcToken *mtc_macro_db_fetch
 		MtcMacroEntry *iter;
 		
 		//Find the given macro
-		for (iter = self->macros; iter; iter = iter->next)
-		{
-			if (strcmp(iter->name, name) == 0)
-				break;
-		}
-		
+		iter = mtc_macro_db_lookup(self, name);
 		if (! iter)
 			return NULL;
 		
@@ -113,15 +161,21 @@ MtcToken *mtc_macro_db_fetch
 void mtc_macro_db_free(MtcMacroDB *self)
 {
 	MtcMacroEntry *iter, *bak;
+	uint32_t i;
 	
-	for (iter = self->macros; iter; iter = bak)
+	for (i = 0; i < self->n_buckets; i++)
 	{
-		bak = iter->next;
-		
-		mtc_token_list_free(iter->def);
-		mtc_free(iter);
+		for (iter = self->buckets[i]; iter; iter = bak)
+		{
+			bak = iter->next;
+			
+			mtc_token_list_free(iter->def);
+			mtc_free(iter);
+		}
 	}
 	
+	if (self->buckets)
+		mtc_free(self->buckets);
 	mtc_free(self);
 }
 
@@ -24,14 +24,18 @@
 typedef struct _MtcMacroEntry MtcMacroEntry;
 struct _MtcMacroEntry
 {
+	//Next macro in the same bucket
 	MtcMacroEntry *next;
 	MtcToken *def;
+	uint32_t hash;
 	char name[1];
 };
 
+//Hash table of macros by name
 typedef struct
 {
-	MtcMacroEntry *macros;
+	MtcMacroEntry **buckets;
+	uint32_t n_buckets, n_macros;
 } MtcMacroDB;
 
 
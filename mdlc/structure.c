@@ -22,6 +22,17 @@
 
 #include <stdarg.h>
 
+//Whether generated serializers reference strings instead of 
+//copying them
+int mtc_c_borrow_strings = 0;
+
+//When generated serializers write messages in a single pass
+MtcCSinglePass mtc_c_single_pass = MTC_C_SINGLE_PASS_NEVER;
+
+//Whether functions for structures are static inline functions 
+//in the header with declarations
+int mtc_c_static_inline = 0;
+
 //These have to be kept in sync with enum MtcTypeFundamentalID
 
 const char *mtc_c_names[] =
@@ -39,6 +50,11 @@ const char *mtc_c_names[] =
 	"char*",
 	"MtcMBlock",
 	"MtcMsg*",
+	"uint32_t",
+	"uint64_t",
+	"int32_t",
+	"int64_t",
+	"unsigned char",
 	NULL
 };
 
@@ -82,18 +98,184 @@ int mtc_c_type_read_can_fail(MtcType type)
 		return 1;
 	if (type.cat == MTC_TYPE_USERDEFINED)
 		return 1;
+	if (type.enum_symbol)
+		return 1;
 	if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
 		return 1;
 	if (type.base.fid == MTC_TYPE_FUNDAMENTAL_MSG)
 		return 1;
+	if (mtc_type_fundamental_is_inline(type.base.fid))
+		return 1;
+	if (mtc_type_fundamental_is_varint(type.base.fid))
+		return 1;
+	
+	return 0;
+}
+
+//Tells whether deserializing into an existing value of the base type
+//reuses memory of the old value
+int mtc_c_base_type_read_reuses(MtcType type)
+{
+	if (type.cat == MTC_TYPE_USERDEFINED)
+		return 1;
+	if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING
+		&& mtc_type_fundamental_is_inline(type.base.fid))
+		return 1;
+	
+	return 0;
+}
+
+//Tells whether arrays and sequences of the type are serialized
+//in bulk using mtc_segment_write/read_*_array()
+int mtc_c_type_is_bulk(MtcType type)
+{
+	if (type.cat != MTC_TYPE_FUNDAMENTAL)
+		return 0;
+	
+	//Values of enumerations have to be checked one by one
+	if (type.enum_symbol)
+		return 0;
+	
+	switch (type.base.fid)
+	{
+	case MTC_TYPE_FUNDAMENTAL_UCHAR:
+	case MTC_TYPE_FUNDAMENTAL_CHAR:
+	case MTC_TYPE_FUNDAMENTAL_UINT16:
+	case MTC_TYPE_FUNDAMENTAL_UINT32:
+	case MTC_TYPE_FUNDAMENTAL_UINT64:
+	case MTC_TYPE_FUNDAMENTAL_INT16:
+	case MTC_TYPE_FUNDAMENTAL_INT32:
+	case MTC_TYPE_FUNDAMENTAL_INT64:
+	case MTC_TYPE_FUNDAMENTAL_FLT32:
+	case MTC_TYPE_FUNDAMENTAL_FLT64:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+//Tells whether the type is a variable length integer. Arrays and
+//sequences of them are serialized in bulk using mtc_*_write/read_array()
+int mtc_c_type_is_varint(MtcType type)
+{
+	if (type.cat != MTC_TYPE_FUNDAMENTAL)
+		return 0;
+	
+	return mtc_type_fundamental_is_varint(type.base.fid);
+}
+
+//Tells whether the type is bool. Arrays and sequences of them are 
+//packed into bitsets using mtc_segment_write/read_bool_array()
+int mtc_c_type_is_bool(MtcType type)
+{
+	return (type.cat == MTC_TYPE_FUNDAMENTAL
+		&& type.base.fid == MTC_TYPE_FUNDAMENTAL_BOOL);
+}
+
+//Tells whether the type is uchar or char, so that arrays and
+//sequences of it are stored as contiguous bytes
+static int mtc_c_type_is_byte(MtcType type)
+{
+	if (type.cat != MTC_TYPE_FUNDAMENTAL || type.enum_symbol)
+		return 0;
+	
+	return (type.base.fid == MTC_TYPE_FUNDAMENTAL_UCHAR
+		|| type.base.fid == MTC_TYPE_FUNDAMENTAL_CHAR);
+}
+
+//Tells whether the type is a string stored in a block of its own. 
+//Arrays and sequences of them are checked all at once when reading.
+int mtc_c_type_is_block_string(MtcType type)
+{
+	if (type.cat != MTC_TYPE_FUNDAMENTAL)
+		return 0;
+	
+	return (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING
+		&& ! mtc_type_fundamental_is_inline(type.base.fid));
+}
+
+//Tells whether the structure is flat: of constant size and without 
+//blocks, so that all its members lie at fixed offsets in its bytes
+static int mtc_c_struct_is_flat(MtcSymbolStruct *value)
+{
+	return value->constsize && ! value->base_size.n_blocks;
+}
+
+//Tells whether counting size of a list of variables has to walk
+//each element of a sequence or array
+static int mtc_var_list_count_is_expensive(MtcSymbolVar *list)
+{
+	MtcSymbolVar *iter;
+	
+	for (iter = list; iter;
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		if (mtc_base_type_is_constsize(iter->type))
+			continue;
+		
+		if (iter->type.complexity == MTC_TYPE_SEQ
+			|| iter->type.complexity > 0)
+			return 1;
+		
+		if (iter->type.cat == MTC_TYPE_USERDEFINED
+			&& mtc_var_list_count_is_expensive
+				(((MtcSymbolStruct *) iter->type.base.symbol)->members))
+			return 1;
+	}
 	
 	return 0;
 }
 
+//Tells whether a list of variables is serialized in a single pass
+int mtc_var_list_use_single_pass(MtcSymbolVar *list)
+{
+	MtcSymbolVar *iter;
+	int constsize = 1;
+	
+	//Builder mode needs the size of the heap in advance
+	if (mtc_type_builder)
+		return 0;
+	
+	for (iter = list; iter;
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		if (! mtc_type_is_constsize(iter->type))
+			constsize = 0;
+	}
+	if (constsize)
+		return 0;
+	
+	switch (mtc_c_single_pass)
+	{
+	case MTC_C_SINGLE_PASS_ALWAYS:
+		return 1;
+	case MTC_C_SINGLE_PASS_NEVER:
+		return 0;
+	default:
+		//With strings and raw values in separate blocks, copying 
+		//chunks costs more than counting already from a few 
+		//tens of KiB
+		if (! mtc_type_inline_threshold)
+			return 0;
+		return mtc_var_list_count_is_expensive(list);
+	}
+}
+
+//Writes storage class of a generated function for structures
+static void mtc_c_gen_fn_storage(FILE *output)
+{
+	if (mtc_c_static_inline)
+		fprintf(output, "static inline ");
+}
+
 //Writes C base type for the type, ignoring complexity
 void mtc_gen_base_type(MtcType type, FILE *output)
 {	
-	if (type.cat == MTC_TYPE_FUNDAMENTAL)
+	if (type.enum_symbol)
+	{
+		fprintf(output, "%s", type.enum_symbol->name);
+	}
+	else if (type.cat == MTC_TYPE_FUNDAMENTAL)
 	{
 		fprintf(output, "%s", mtc_c_names[type.base.fid]);
 	}
@@ -204,6 +386,49 @@ void mtc_var_code_for_base_write
 			mtc_var_code_base_exp(var, prefix, c_file);
 			fprintf(c_file, ", %s, dstream);\n", segment);
 		}
+		else if (mtc_type_fundamental_is_varint(var->type.base.fid))
+		{
+			fprintf(c_file, "mtc_%s_write(",
+				mtc_type_fundamental_names[var->type.base.fid]);
+			mtc_var_code_base_exp(var, prefix, c_file);
+			fprintf(c_file, ", dstream);\n");
+		}
+		else if (mtc_c_borrow_strings
+			&& var->type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+		{
+			if (mtc_type_fundamental_is_inline(var->type.base.fid))
+				fprintf(c_file, "mtc_rcstring_write_inline(");
+			else
+				fprintf(c_file, "mtc_segment_write_rcstring(%s, ", 
+					segment);
+			mtc_var_code_base_exp(var, prefix, c_file);
+			if (mtc_type_fundamental_is_inline(var->type.base.fid))
+				fprintf(c_file, ", %d, %s, dstream);\n", 
+					(int) mtc_type_inline_threshold, segment);
+			else
+				fprintf(c_file, ");\n");
+		}
+		else if (mtc_type_fundamental_is_inline(var->type.base.fid))
+		{
+			fprintf(c_file, "mtc_%s_write_inline(",
+				mtc_type_fundamental_names[var->type.base.fid]);
+			mtc_var_code_base_exp(var, prefix, c_file);
+			fprintf(c_file, ", %d, %s, dstream);\n", 
+				(int) mtc_type_inline_threshold, segment);
+		}
+		else if (mtc_type_builder 
+			&& var->type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+		{
+			fprintf(c_file, "mtc_string_write_heap(");
+			mtc_var_code_base_exp(var, prefix, c_file);
+			fprintf(c_file, ", %s, dstream);\n", segment);
+		}
+		else if (var->type.bit)
+		{
+			fprintf(c_file, "mtc_segment_write_bit(%s, ", segment);
+			mtc_var_code_base_exp(var, prefix, c_file);
+			fprintf(c_file, ", %d);\n", var->type.bit);
+		}
 		else
 		{
 			fprintf(c_file, "mtc_segment_write_%s(%s, ",
@@ -229,9 +454,9 @@ void mtc_var_code_for_base_free
 	{
 		if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_RAW)
 		{
-			fprintf(c_file, "mtc_rcmem_unref(");
+			fprintf(c_file, "mtc_mblock_unref(");
 			mtc_var_code_base_exp(var, prefix, c_file);
-			fprintf(c_file, ".mem);\n");
+			fprintf(c_file, ");\n");
 		}
 		else if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
 		{
@@ -254,6 +479,23 @@ void mtc_var_code_for_base_free
 	}
 }
 
+//Writes code for freeing given base type unless it is unset, 
+//i.e. all zero. indent is the indentation of the code.
+void mtc_var_code_for_base_release
+	(MtcSymbolVar *var, const char *prefix, const char *indent,
+	 FILE *c_file)
+{
+	if (var->type.cat == MTC_TYPE_FUNDAMENTAL)
+	{
+		fprintf(c_file, "if (");
+		mtc_var_code_base_exp(var, prefix, c_file);
+		if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_RAW)
+			fprintf(c_file, ".mem");
+		fprintf(c_file, ")\n%s    ", indent);
+	}
+	mtc_var_code_for_base_free(var, prefix, c_file);
+}
+
 //Writes code for deserializing given base type. 
 //Returns 1 if the code is failable (we have to write {error handler} 
 //after that in that case)
@@ -265,7 +507,33 @@ int mtc_var_code_for_base_read
 	
 	if (var->type.cat == MTC_TYPE_FUNDAMENTAL)
 	{	
-		if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+		if (mtc_type_fundamental_is_inline(var->type.base.fid))
+		{
+			if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+			{
+				fprintf(c_file, "if (! (");
+				mtc_var_code_base_exp(var, prefix, c_file);
+				fprintf(c_file, 
+					" = mtc_string_read_inline(%s, dstream)))\n",
+					segment);
+			}
+			else
+			{
+				fprintf(c_file, "if (mtc_raw_read_inline(&(");
+				mtc_var_code_base_exp(var, prefix, c_file);
+				fprintf(c_file, "), %s, dstream) < 0)\n", segment);
+			}
+			failable = 1;
+		}
+		else if (mtc_type_fundamental_is_varint(var->type.base.fid))
+		{
+			fprintf(c_file, "if (mtc_%s_read(&(",
+				mtc_type_fundamental_names[var->type.base.fid]);
+			mtc_var_code_base_exp(var, prefix, c_file);
+			fprintf(c_file, "), dstream) < 0)\n");
+			failable = 1;
+		}
+		else if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
 		{
 			fprintf(c_file, "if (! (");
 			mtc_var_code_base_exp(var, prefix, c_file);
@@ -291,6 +559,23 @@ int mtc_var_code_for_base_read
 			        segment);
 			failable = 1;
 		}
+		else if (var->type.enum_symbol)
+		{
+			fprintf(c_file, "if (mtc_segment_read_enum%d(%s, &(",
+				(int) mtc_type_fundamental_sizes[var->type.base.fid].n_bytes
+					* 8, 
+				segment);
+			mtc_var_code_base_exp(var, prefix, c_file);
+			fprintf(c_file, "), %d) < 0)\n", 
+				(int) ((MtcSymbolEnum *) var->type.enum_symbol)->n_values);
+			failable = 1;
+		}
+		else if (var->type.bit)
+		{
+			fprintf(c_file, "mtc_segment_read_bit(%s, ", segment);
+			mtc_var_code_base_exp(var, prefix, c_file);
+			fprintf(c_file, ", %d);\n", var->type.bit);
+		}
 		else
 		{
 			fprintf(c_file, "mtc_segment_read_%s(%s, ",
@@ -319,8 +604,10 @@ void mtc_var_code_for_ref_null
 	if (var->type.cat == MTC_TYPE_FUNDAMENTAL)
 	{
 		if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_RAW)
-			fprintf(c_file, "(%s%s).mem = NULL; (%s%s).size = 0;\n",
-				prefix, var->parent.name, prefix, var->parent.name);
+			fprintf(c_file, "(%s%s).mem = NULL; (%s%s).size = 0; "
+				"(%s%s).parent = NULL;\n",
+				prefix, var->parent.name, prefix, var->parent.name,
+				prefix, var->parent.name);
 		else 
 			fprintf(c_file, "%s%s = NULL;\n", prefix, var->parent.name);
 	}
@@ -328,6 +615,47 @@ void mtc_var_code_for_ref_null
 		fprintf(c_file, "%s%s = NULL;\n", prefix, var->parent.name);
 }
 
+//Writes an expression that counts dynamic size of given base type.
+//Only for types which are not of constant size.
+void mtc_var_code_base_count_exp
+	(MtcSymbolVar *var, const char *prefix, FILE *c_file)
+{
+	if (var->type.cat == MTC_TYPE_USERDEFINED)
+	{
+		fprintf(c_file, "%s__count(&(", var->type.base.symbol->name);
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, "))");
+	}
+	else if (mtc_type_fundamental_is_inline(var->type.base.fid))
+	{
+		fprintf(c_file, "mtc_%s_count_inline(",
+			mtc_type_fundamental_names[var->type.base.fid]);
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, ", %d)", (int) mtc_type_inline_threshold);
+	}
+	else if (mtc_type_fundamental_is_varint(var->type.base.fid))
+	{
+		fprintf(c_file, "mtc_%s_count(",
+			mtc_type_fundamental_names[var->type.base.fid]);
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, ")");
+	}
+	else if (var->type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+	{
+		//Builder mode
+		fprintf(c_file, "mtc_string_count_heap(");
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, ")");
+	}
+	else
+	{
+		//Must be msg
+		fprintf(c_file, "mtc_msg_count(");
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, ")");
+	}
+}
+
 //Writes code to count dynamic size of a given list of variables
 void mtc_var_list_code_for_count
 	(MtcSymbolVar *list, const char *prefix, FILE *c_file)
@@ -337,65 +665,69 @@ void mtc_var_list_code_for_count
 	for (iter = list; iter;
 		iter = (MtcSymbolVar *) iter->parent.next)
 	{
-		const char *part1, *part2;
-		const char *parts[3] = {"", "mtc_msg_count((", "__count(&("};
-		
-		//Prepare counting function
-		if (iter->type.cat == MTC_TYPE_USERDEFINED)
-		{
-			part1 = iter->type.base.symbol->name;
-			part2 = parts[2];
-		}
-		else
-		{
-			//Must be msg
-			part1 = parts[0];
-			part2 = parts[1];
-		}
-		
 		fprintf(c_file,
 			"    //%s%s\n",  prefix, iter->parent.name);
 		if (iter->type.complexity == MTC_TYPE_NORMAL)
 		{
 			if (! mtc_base_type_is_constsize(iter->type))
 			{
-				//Only userdefined types
+				//Userdefined types, msg, inline fundamentals and varints
 				fprintf(c_file, 
 					"    {\n"
 					"        MtcDLen onesize;\n"
-					"        onesize = %s%s", 
-					part1, part2);
-				mtc_var_code_base_exp(iter, prefix, c_file);
+					"        onesize = "); 
+				mtc_var_code_base_count_exp(iter, prefix, c_file);
 				fprintf(c_file, 
-					"));\n"
+					";\n"
 					"        size.n_bytes += onesize.n_bytes;\n"
 					"        size.n_blocks += onesize.n_blocks;\n"
+					"        size.n_heap += onesize.n_heap;\n"
 					"    }\n");
 			}
 		}
+		else if (iter->type.complexity > 0
+			&& mtc_c_type_is_varint(iter->type))
+		{
+			fprintf(c_file, 
+				"    {\n"
+				"        MtcDLen onesize;\n"
+				"        onesize = mtc_%s_count_array(%s%s, %d);\n"
+				"        size.n_bytes += onesize.n_bytes;\n"
+				"    }\n",
+				mtc_type_fundamental_names[iter->type.base.fid],
+				prefix, iter->parent.name, iter->type.complexity);
+		}
 		else if (iter->type.complexity > 0)
 		{
 			if (! mtc_base_type_is_constsize(iter->type))
 			{
-				//Only userdefined types
+				//Userdefined types, msg and inline fundamentals
 				fprintf(c_file, 
 					"    {\n"
 					"        MtcDLen onesize;\n"
 					"        int _i;\n"
 					"        for (_i = 0; _i < %d; _i++)\n"
 					"        {\n"
-					"            onesize = %s%s",
-					iter->type.complexity, 
-					part1, part2);
-				mtc_var_code_base_exp(iter, prefix, c_file);
+					"            onesize = ",
+					iter->type.complexity);
+				mtc_var_code_base_count_exp(iter, prefix, c_file);
 				fprintf(c_file,
-					"));\n"
+					";\n"
 					"            size.n_bytes += onesize.n_bytes;\n"
 					"            size.n_blocks += onesize.n_blocks;\n"
+					"            size.n_heap += onesize.n_heap;\n"
 					"        }\n"
 					"    }\n");
 			}
 		}
+		else if (iter->type.complexity == MTC_TYPE_SEQ
+			&& mtc_c_type_is_bool(iter->type))
+		{
+			//Packed into a bitset
+			fprintf(c_file, 
+				"    size.n_bytes += ((size_t) %s%s.len + 7) / 8;\n",
+				prefix, iter->parent.name);
+		}
 		else if (iter->type.complexity == MTC_TYPE_SEQ)
 		{
 			//Find the base size
@@ -408,23 +740,36 @@ void mtc_var_list_code_for_count
 				(int) base_size.n_bytes, prefix, iter->parent.name,
 				(int) base_size.n_blocks, prefix, iter->parent.name);
 			
-			if (! mtc_base_type_is_constsize(iter->type))
+			if (mtc_c_type_is_varint(iter->type))
+			{
+				fprintf(c_file, 
+					"    {\n"
+					"        MtcDLen onesize;\n"
+					"        onesize = mtc_%s_count_array"
+					"(%s%s.data, %s%s.len);\n"
+					"        size.n_bytes += onesize.n_bytes;\n"
+					"    }\n",
+					mtc_type_fundamental_names[iter->type.base.fid],
+					prefix, iter->parent.name, 
+					prefix, iter->parent.name);
+			}
+			else if (! mtc_base_type_is_constsize(iter->type))
 			{
-				//Only userdefined types
+				//Userdefined types, msg and inline fundamentals
 				fprintf(c_file, 
 					"    {\n"
 					"        MtcDLen onesize;\n"
 					"        int _i;\n"
 					"        for (_i = 0; _i < %s%s.len; _i++)\n"
 					"        {\n"
-					"            onesize = %s%s",
-					prefix, iter->parent.name, 
-					part1, part2);
-				mtc_var_code_base_exp(iter, prefix, c_file);
+					"            onesize = ",
+					prefix, iter->parent.name);
+				mtc_var_code_base_count_exp(iter, prefix, c_file);
 				fprintf(c_file,
-					"));\n"
+					";\n"
 					"            size.n_bytes += onesize.n_bytes;\n"
 					"            size.n_blocks += onesize.n_blocks;\n"
+					"            size.n_heap += onesize.n_heap;\n"
 					"        }\n"
 					"    }\n");
 			}
@@ -447,18 +792,18 @@ void mtc_var_list_code_for_count
 			if (! mtc_base_type_is_constsize(iter->type))
 			{
 				
-				//Only userdefined types
+				//Userdefined types, msg, inline fundamentals and varints
 				
 				fprintf(c_file, 
 					"        {\n"
 					"            MtcDLen onesize;\n"
-					"            onesize = %s%s", 
-					part1, part2);
-				mtc_var_code_base_exp(iter, prefix, c_file);
+					"            onesize = "); 
+				mtc_var_code_base_count_exp(iter, prefix, c_file);
 				fprintf(c_file, 
-					"));\n"
+					";\n"
 					"            size.n_bytes += onesize.n_bytes;\n"
 					"            size.n_blocks += onesize.n_blocks;\n"
+					"            size.n_heap += onesize.n_heap;\n"
 					"        }\n");
 			}
 			fprintf(c_file, 
@@ -486,6 +831,32 @@ void mtc_var_list_code_for_write
 			fprintf(c_file, "    ");
 			mtc_var_code_for_base_write(iter, prefix, "seg", c_file);
 		}
+		//Arrays of integers and floating point values
+		else if (iter->type.complexity > 0 
+			&& mtc_c_type_is_bulk(iter->type))
+		{
+			fprintf(c_file, 
+				"    mtc_segment_write_%s_array(seg, %s%s, %d);\n",
+				mtc_type_fundamental_names[iter->type.base.fid],
+				prefix, iter->parent.name, iter->type.complexity);
+		}
+		//Arrays of bools
+		else if (iter->type.complexity > 0 
+			&& mtc_c_type_is_bool(iter->type))
+		{
+			fprintf(c_file, 
+				"    mtc_segment_write_bool_array(seg, %s%s, %d);\n",
+				prefix, iter->parent.name, iter->type.complexity);
+		}
+		//Arrays of variable length integers
+		else if (iter->type.complexity > 0 
+			&& mtc_c_type_is_varint(iter->type))
+		{
+			fprintf(c_file, 
+				"    mtc_%s_write_array(%s%s, %d, dstream);\n",
+				mtc_type_fundamental_names[iter->type.base.fid],
+				prefix, iter->parent.name, iter->type.complexity);
+		}
 		//Arrays
 		else if (iter->type.complexity > 0)
 		{
@@ -502,6 +873,35 @@ void mtc_var_list_code_for_write
 				"    }\n");
 				
 		}
+		//Sequences of variable length integers
+		else if (iter->type.complexity == MTC_TYPE_SEQ
+			&& mtc_c_type_is_varint(iter->type))
+		{
+			fprintf(c_file, 
+				"    mtc_segment_write_uint32(seg, %s%s.len);\n"
+				"    mtc_%s_write_array(%s%s.data, %s%s.len, dstream);\n",
+				prefix, iter->parent.name,
+				mtc_type_fundamental_names[iter->type.base.fid],
+				prefix, iter->parent.name, prefix, iter->parent.name);
+		}
+		//Sequences of bools
+		else if (iter->type.complexity == MTC_TYPE_SEQ
+			&& mtc_c_type_is_bool(iter->type))
+		{
+			fprintf(c_file, 
+				"    {\n"
+				"        MtcSegment sub_seg;\n"
+				"        \n"
+				"        mtc_segment_write_uint32(seg, %s%s.len);\n"
+				"        mtc_dstream_get_segment(dstream, "
+				"((size_t) %s%s.len + 7) / 8, 0, &sub_seg);\n"
+				"        mtc_segment_write_bool_array"
+				"(&sub_seg, %s%s.data, %s%s.len);\n"
+				"    }\n",
+				prefix, iter->parent.name, 
+				prefix, iter->parent.name, 
+				prefix, iter->parent.name, prefix, iter->parent.name);
+		}
 		//Sequences
 		else if (iter->type.complexity == MTC_TYPE_SEQ)
 		{
@@ -510,23 +910,39 @@ void mtc_var_list_code_for_write
 			
 			fprintf(c_file, 
 				"    {\n"
-				"        int _i;\n"
-				"        MtcSegment sub_seg;\n"
+				"        %s"
+				"MtcSegment sub_seg;\n"
 				"        \n"
 				"        mtc_segment_write_uint32(seg, %s%s.len);\n"
 				"        mtc_dstream_get_segment(dstream, "
-				"%d * %s%s.len, %d * %s%s.len, &sub_seg);\n"
+				"%d * %s%s.len, %d * %s%s.len, &sub_seg);\n",
+				mtc_c_type_is_bulk(iter->type) ? "" : "int _i;\n        ",
+				prefix, iter->parent.name, 
+				(int) base_size.n_bytes, prefix, iter->parent.name,
+				(int) base_size.n_blocks, prefix, iter->parent.name);
+			if (mtc_c_type_is_bulk(iter->type))
+			{
+				fprintf(c_file, 
+				"        mtc_segment_write_%s_array"
+				"(&sub_seg, %s%s.data, %s%s.len);\n"
+				"    }\n",
+					mtc_type_fundamental_names[iter->type.base.fid],
+					prefix, iter->parent.name, 
+					prefix, iter->parent.name);
+			}
+			else
+			{
+				fprintf(c_file, 
 				"        for (_i = 0; _i < %s%s.len; _i++)\n"
 				"        {\n"
 				"            ",
-				prefix, iter->parent.name, 
-				(int) base_size.n_bytes, prefix, iter->parent.name,
-				(int) base_size.n_blocks, prefix, iter->parent.name,
-				prefix, iter->parent.name);
-			mtc_var_code_for_base_write(iter, prefix, "&sub_seg", c_file);
-			fprintf(c_file,
+					prefix, iter->parent.name);
+				mtc_var_code_for_base_write
+					(iter, prefix, "&sub_seg", c_file);
+				fprintf(c_file,
 				"        }\n"
 				"    }\n");
+			}
 		}
 		//Reference
 		else if (iter->type.complexity == MTC_TYPE_REF)
@@ -559,198 +975,322 @@ void mtc_var_list_code_for_write
 	}
 }
 
-//Writes code to deserialize a given list of variables: main code
-void mtc_var_list_code_for_read
-	(MtcSymbolVar *list, const char *prefix, FILE *c_file)
+//Writes code to deserialize a variable
+void mtc_var_code_for_read
+	(MtcSymbolVar *var, const char *prefix, FILE *c_file)
 {
-	MtcSymbolVar *iter;
-	
-	for (iter = list; iter;
-			iter = (MtcSymbolVar *) iter->parent.next)
+	//Simple types
+	if (var->type.complexity == MTC_TYPE_NORMAL)
 	{
-		fprintf(c_file,
-			"    //%s%s\n",  prefix, iter->parent.name);
-		
-		//Simple types
-		if (iter->type.complexity == MTC_TYPE_NORMAL)
+		fprintf(c_file, 
+				"    ");
+		if (mtc_var_code_for_base_read(var, prefix, "seg", c_file))
+		{
+			fprintf(c_file,
+				"    {\n"
+				"        goto _mtc_fail_%s;\n"
+				"    }\n", var->parent.name);
+		}
+	}
+	//Arrays of integers and floating point values
+	else if (var->type.complexity > 0 
+		&& mtc_c_type_is_bulk(var->type))
+	{
+		fprintf(c_file, 
+			"    mtc_segment_read_%s_array(seg, %s%s, %d);\n",
+			mtc_type_fundamental_names[var->type.base.fid],
+			prefix, var->parent.name, var->type.complexity);
+	}
+	//Arrays of bools
+	else if (var->type.complexity > 0 
+		&& mtc_c_type_is_bool(var->type))
+	{
+		fprintf(c_file, 
+			"    mtc_segment_read_bool_array(seg, %s%s, %d);\n",
+			prefix, var->parent.name, var->type.complexity);
+	}
+	//Arrays of variable length integers
+	else if (var->type.complexity > 0 
+		&& mtc_c_type_is_varint(var->type))
+	{
+		fprintf(c_file, 
+			"    if (mtc_%s_read_array(%s%s, %d, dstream) < 0)\n"
+			"        goto _mtc_fail_%s;\n",
+			mtc_type_fundamental_names[var->type.base.fid],
+			prefix, var->parent.name, var->type.complexity,
+			var->parent.name);
+	}
+	//Arrays of strings
+	else if (var->type.complexity > 0 
+		&& mtc_c_type_is_block_string(var->type))
+	{
+		fprintf(c_file, 
+			"    if (mtc_segment_read_strings(seg, %s%s, %d) < 0)\n"
+			"        goto _mtc_fail_%s;\n",
+			prefix, var->parent.name, var->type.complexity,
+			var->parent.name);
+	}
+	//Arrays
+	else if (var->type.complexity > 0)
+	{
+		fprintf(c_file, 
+			"    {\n"
+			"        int _i;\n"
+			"        for (_i = 0; _i < %d; _i++)\n"
+			"        {\n"
+			"            ",
+			var->type.complexity);
+		if (mtc_var_code_for_base_read(var, prefix, "seg", c_file))
 		{
 			fprintf(c_file, 
-					"    ");
-			if (mtc_var_code_for_base_read(iter, prefix, "seg", c_file))
+			"            {\n");
+			if (mtc_c_base_type_requires_free(var->type))
 			{
-				fprintf(c_file,
-					"    {\n"
-					"        goto _mtc_fail_%s;\n"
-					"    }\n", iter->parent.name);
+				fprintf(c_file, 
+			"                for (_i--; _i >= 0; _i--)\n"
+			"                {\n"
+			"                    ");
+				mtc_var_code_for_base_free(var, prefix, c_file);
+				fprintf(c_file, 
+			"                }\n");
 			}
+			fprintf(c_file,
+			"                goto _mtc_fail_%s;\n"
+			"            }\n", var->parent.name);
 		}
-		//Arrays
-		else if (iter->type.complexity > 0)
+		fprintf(c_file,
+			"        }\n"
+			"    }\n");
+			
+	}
+	//Sequences of variable length integers
+	else if (var->type.complexity == MTC_TYPE_SEQ
+		&& mtc_c_type_is_varint(var->type))
+	{
+		//Every value takes at least one byte, so the length can be
+		//checked before allocating
+		fprintf(c_file, 
+			"    mtc_segment_read_uint32(seg, %s%s.len);\n"
+			"    if (mtc_dstream_bytes_left(dstream) < %s%s.len)\n"
+			"        goto _mtc_fail_%s;\n"
+			"    if (! (%s%s.data = (", 
+			prefix, var->parent.name, 
+			prefix, var->parent.name, 
+			var->parent.name, 
+			prefix, var->parent.name);
+		mtc_gen_base_type(var->type, c_file);
+		fprintf(c_file, " *) mtc_tryalloc(sizeof(");
+		mtc_gen_base_type(var->type, c_file);
+		fprintf(c_file, ") * %s%s.len)))\n"
+			"        goto _mtc_fail_%s;\n"
+			"    if (mtc_%s_read_array(%s%s.data, %s%s.len, dstream) < 0)\n"
+			"    {\n"
+			"        mtc_free(%s%s.data);\n"
+			"        goto _mtc_fail_%s;\n"
+			"    }\n",
+			prefix, var->parent.name, 
+			var->parent.name,
+			mtc_type_fundamental_names[var->type.base.fid],
+			prefix, var->parent.name, prefix, var->parent.name,
+			prefix, var->parent.name, 
+			var->parent.name);
+	}
+	//Sequences of bools
+	else if (var->type.complexity == MTC_TYPE_SEQ
+		&& mtc_c_type_is_bool(var->type))
+	{
+		fprintf(c_file, 
+			"    {\n"
+			"        MtcSegment sub_seg;\n"
+			"        mtc_segment_read_uint32(seg, %s%s.len);\n"
+			"        if (mtc_dstream_get_segment(dstream, "
+			"((size_t) %s%s.len + 7) / 8, 0, &sub_seg) < 0)\n"
+			"            goto _mtc_fail_%s;\n"
+			"        if (! (%s%s.data = (unsigned char *) "
+			"mtc_tryalloc(%s%s.len)))\n"
+			"            goto _mtc_fail_%s;\n"
+			"        mtc_segment_read_bool_array"
+			"(&sub_seg, %s%s.data, %s%s.len);\n"
+			"    }\n",
+			prefix, var->parent.name, 
+			prefix, var->parent.name, 
+			var->parent.name, 
+			prefix, var->parent.name, prefix, var->parent.name, 
+			var->parent.name, 
+			prefix, var->parent.name, prefix, var->parent.name);
+	}
+	//Sequences
+	else if (var->type.complexity == MTC_TYPE_SEQ)
+	{
+		//Find the base size
+		MtcDLen base_size = mtc_base_type_calc_base_size(var->type);
+		int bulk = (mtc_c_type_is_bulk(var->type)
+			|| mtc_c_type_is_block_string(var->type));
+			
+		fprintf(c_file, 
+			"    {\n"
+			"        %s"
+			"MtcSegment sub_seg;\n"
+			"        mtc_segment_read_uint32(seg, %s%s.len);\n"
+			"        if (mtc_dstream_get_segment(dstream, "
+			"(size_t) %d * %s%s.len, (size_t) %d * %s%s.len, &sub_seg) < 0)\n"
+			"            goto _mtc_fail_%s;\n"
+			"        if (! (%s%s.data = (", 
+			bulk ? "" : "int _i;\n        ",
+			prefix, var->parent.name, 
+			(int) base_size.n_bytes, prefix, var->parent.name,
+			(int) base_size.n_blocks, prefix, var->parent.name,
+			var->parent.name, 
+			prefix, var->parent.name);
+		mtc_gen_base_type(var->type, c_file);
+		fprintf(c_file, " *) mtc_tryalloc(sizeof(");
+		mtc_gen_base_type(var->type, c_file);
+		fprintf(c_file, ") * %s%s.len)))\n"
+			"            goto _mtc_fail_%s;\n",
+			prefix, var->parent.name, 
+			var->parent.name);
+		if (mtc_c_type_is_bulk(var->type))
 		{
 			fprintf(c_file, 
-				"    {\n"
-				"        int _i;\n"
-				"        for (_i = 0; _i < %d; _i++)\n"
-				"        {\n"
-				"            ",
-				iter->type.complexity);
-			if (mtc_var_code_for_base_read(iter, prefix, "seg", c_file))
-			{
-				fprintf(c_file, 
-				"            {\n");
-				if (mtc_c_base_type_requires_free(iter->type))
-				{
-					fprintf(c_file, 
-				"                for (_i--; _i >= 0; _i--)\n"
-				"                {\n"
-				"                    ");
-					mtc_var_code_for_base_free(iter, prefix, c_file);
-					fprintf(c_file, 
-				"                }\n");
-				}
-				fprintf(c_file,
-				"                goto _mtc_fail_%s;\n"
-				"            }\n", iter->parent.name);
-			}
-			fprintf(c_file,
-				"        }\n"
-				"    }\n");
-				
+			"        mtc_segment_read_%s_array"
+			"(&sub_seg, %s%s.data, %s%s.len);\n"
+			"    }\n",
+				mtc_type_fundamental_names[var->type.base.fid],
+				prefix, var->parent.name, 
+				prefix, var->parent.name);
 		}
-		//Sequences
-		else if (iter->type.complexity == MTC_TYPE_SEQ)
+		else if (mtc_c_type_is_block_string(var->type))
 		{
-			//Find the base size
-			MtcDLen base_size = mtc_base_type_calc_base_size(iter->type);
-				
 			fprintf(c_file, 
-				"    {\n"
-				"        int _i;\n"
-				"        MtcSegment sub_seg;\n"
-				"        mtc_segment_read_uint32(seg, %s%s.len);\n"
-				"        if (mtc_dstream_get_segment(dstream, "
-				"%d * %s%s.len, %d * %s%s.len, &sub_seg) < 0)\n"
-				"            goto _mtc_fail_%s;\n"
-				"        if (! (%s%s.data = (", 
-				prefix, iter->parent.name, 
-				(int) base_size.n_bytes, prefix, iter->parent.name,
-				(int) base_size.n_blocks, prefix, iter->parent.name,
-				iter->parent.name, 
-				prefix, iter->parent.name);
-			mtc_gen_base_type(iter->type, c_file);
-			fprintf(c_file, " *) mtc_tryalloc(sizeof(");
-			mtc_gen_base_type(iter->type, c_file);
-			fprintf(c_file, ") * %s%s.len)))\n"
-				"            goto _mtc_fail_%s;\n"
-				"        for (_i = 0; _i < %s%s.len; _i++)\n"
-				"        {\n"
-				"            ",
-				prefix, iter->parent.name, 
-				iter->parent.name, 
-				prefix, iter->parent.name);
-			if (mtc_var_code_for_base_read(iter, prefix, "&sub_seg", c_file))
+			"        if (mtc_segment_read_strings"
+			"(&sub_seg, %s%s.data, %s%s.len) < 0)\n"
+			"        {\n"
+			"            mtc_free(%s%s.data);\n"
+			"            goto _mtc_fail_%s;\n"
+			"        }\n"
+			"    }\n",
+				prefix, var->parent.name, 
+				prefix, var->parent.name, 
+				prefix, var->parent.name, 
+				var->parent.name);
+		}
+		else
+		{
+			fprintf(c_file, 
+			"        for (_i = 0; _i < %s%s.len; _i++)\n"
+			"        {\n"
+			"            ",
+				prefix, var->parent.name);
+			if (mtc_var_code_for_base_read
+				(var, prefix, "&sub_seg", c_file))
 			{
 				fprintf(c_file, 
-				"            {\n");
-				if (mtc_c_base_type_requires_free(iter->type))
+			"            {\n");
+				if (mtc_c_base_type_requires_free(var->type))
 				{
 					fprintf(c_file, 
-				"                for (_i--; _i >= 0; _i--)\n"
-				"                {\n"
-				"                    ");
-					mtc_var_code_for_base_free(iter, prefix, c_file);
+			"                for (_i--; _i >= 0; _i--)\n"
+			"                {\n"
+			"                    ");
+					mtc_var_code_for_base_free(var, prefix, c_file);
 					fprintf(c_file, 
-				"                }\n");
+			"                }\n");
 				}
 				fprintf(c_file,
-				"                free(%s%s.data);\n"
-				"                goto _mtc_fail_%s;\n"
-				"            }\n", prefix, iter->parent.name, 
-					iter->parent.name);
+			"                mtc_free(%s%s.data);\n"
+			"                goto _mtc_fail_%s;\n"
+			"            }\n", prefix, var->parent.name, 
+					var->parent.name);
 			}
 			fprintf(c_file,
-				"        }\n"
-				"    }\n");
-			
+			"        }\n"
+			"    }\n");
 		}
-		//Reference
-		else if (iter->type.complexity == MTC_TYPE_REF)
+	}
+	//Reference
+	else if (var->type.complexity == MTC_TYPE_REF)
+	{
+		//Find the base size
+		MtcDLen base_size = mtc_base_type_calc_base_size(var->type);
+		
+		fprintf(c_file, 
+			"    {\n"
+			"        MtcSegment sub_seg;\n"
+			"        char presence;\n"
+			"        mtc_segment_read_uchar(seg, presence);\n"
+			"        if (presence)\n"
+			"        {\n"
+			"            if (mtc_dstream_get_segment(dstream, "
+			"%d, %d, &sub_seg) < 0)\n"
+			"                goto _mtc_fail_%s;\n",
+			(int) base_size.n_bytes, 
+			(int) base_size.n_blocks, 
+			var->parent.name);
+		if (! mtc_c_ref_type_is_baseless(var->type))
 		{
-			//Find the base size
-			MtcDLen base_size = mtc_base_type_calc_base_size(iter->type);
-			
 			fprintf(c_file, 
-				"    {\n"
-				"        MtcSegment sub_seg;\n"
-				"        char presence;\n"
-				"        mtc_segment_read_uchar(seg, presence);\n"
-				"        if (presence)\n"
-				"        {\n"
-				"            if (mtc_dstream_get_segment(dstream, "
-				"%d, %d, &sub_seg) < 0)\n"
-				"                goto _mtc_fail_%s;\n",
-				(int) base_size.n_bytes, 
-				(int) base_size.n_blocks, 
-				iter->parent.name);
-			if (! mtc_c_ref_type_is_baseless(iter->type))
-			{
-				fprintf(c_file, 
-				"            if (! (%s%s = (",
-					prefix, iter->parent.name);
-				mtc_gen_base_type(iter->type, c_file);
-				fprintf(c_file, " *) mtc_tryalloc(sizeof(");
-				mtc_gen_base_type(iter->type, c_file);
-				fprintf(c_file, "))))\n"
-				"            goto _mtc_fail_%s;\n",
-					iter->parent.name);
-			}
+			"            if (! (%s%s = (",
+				prefix, var->parent.name);
+			mtc_gen_base_type(var->type, c_file);
+			fprintf(c_file, " *) mtc_tryalloc(sizeof(");
+			mtc_gen_base_type(var->type, c_file);
+			fprintf(c_file, "))))\n"
+			"            goto _mtc_fail_%s;\n",
+				var->parent.name);
+		}
+		fprintf(c_file, 
+			"            ");
+		if (mtc_var_code_for_base_read(var, prefix, "&sub_seg", c_file))
+		{
 			fprintf(c_file, 
-				"            ");
-			if (mtc_var_code_for_base_read(iter, prefix, "&sub_seg", c_file))
-			{
-				fprintf(c_file, 
-				"            {\n");
-				if (mtc_c_base_type_requires_free(iter->type))
-				{
-					fprintf(c_file, 
-				"                ");
-					mtc_var_code_for_base_free(iter, prefix, c_file);
-				}
-				if (! mtc_c_ref_type_is_baseless(iter->type))
-					fprintf(c_file,
-				"                free(%s%s);\n",
-						prefix, iter->parent.name);
-				
+			"            {\n");
+			if (! mtc_c_ref_type_is_baseless(var->type))
 				fprintf(c_file,
-				"                goto _mtc_fail_%s;\n"
-				"            }\n", iter->parent.name);
-			}
+			"                mtc_free(%s%s);\n",
+					prefix, var->parent.name);
+			
 			fprintf(c_file,
-				"        }\n"
-				"        else\n"
-				"        {\n"
-				"            ");
-			mtc_var_code_for_ref_null(iter, prefix, c_file);
-			fprintf(c_file, 
-				"        }\n"
-				"    }\n");
+			"                goto _mtc_fail_%s;\n"
+			"            }\n", var->parent.name);
 		}
+		fprintf(c_file,
+			"        }\n"
+			"        else\n"
+			"        {\n"
+			"            ");
+		mtc_var_code_for_ref_null(var, prefix, c_file);
+		fprintf(c_file, 
+			"        }\n"
+			"    }\n");
+	}
+}
+
+//Writes code to deserialize a given list of variables: main code
+void mtc_var_list_code_for_read
+	(MtcSymbolVar *list, const char *prefix, FILE *c_file)
+{
+	MtcSymbolVar *iter;
+	
+	for (iter = list; iter;
+			iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		fprintf(c_file,
+			"    //%s%s\n",  prefix, iter->parent.name);
+		mtc_var_code_for_read(iter, prefix, c_file);
 		fprintf(c_file, "\n");
 	}
 }
 
-//writes code to free a variable
-void mtc_var_code_for_free
+//Writes code to free a variable, without the comment
+static void mtc_var_code_for_release
 	(MtcSymbolVar *var, const char *prefix, FILE *c_file)
 {
-	fprintf(c_file, "    //%s\n", var->parent.name);
-	
 	if (var->type.complexity == MTC_TYPE_NORMAL)
 	{
 		if (mtc_c_base_type_requires_free(var->type))
 		{
 			fprintf(c_file, "    ");
-			mtc_var_code_for_base_free(var, prefix, c_file);
+			mtc_var_code_for_base_release(var, prefix, "    ", c_file);
 		}
 	}
 	else if (var->type.complexity > 0)
@@ -764,7 +1304,8 @@ void mtc_var_code_for_free
 		"        {\n"
 		"            ",
 				var->type.complexity);
-			mtc_var_code_for_base_free(var, prefix, c_file);
+			mtc_var_code_for_base_release
+				(var, prefix, "            ", c_file);
 			fprintf(c_file, 
 		"        }\n"
 		"    }\n");
@@ -781,7 +1322,8 @@ void mtc_var_code_for_free
 		"        {\n"
 		"            ",
 				prefix, var->parent.name);
-			mtc_var_code_for_base_free(var, prefix, c_file);
+			mtc_var_code_for_base_release
+				(var, prefix, "            ", c_file);
 			fprintf(c_file, 
 		"        }\n"
 		"    }\n");
@@ -807,69 +1349,1327 @@ void mtc_var_code_for_free
 				
 			if (requires_free)
 			{
-				mtc_var_code_for_base_free(var, prefix, c_file);
+				mtc_var_code_for_base_free(var, prefix, c_file);
+			}
+			if (! baseless)
+			{
+				fprintf(c_file, "        mtc_free(%s%s);\n",
+					prefix, var->parent.name);
+			}
+			
+			fprintf(c_file, "    }\n");
+		}
+	}
+}
+
+//writes code to free a variable
+void mtc_var_code_for_free
+	(MtcSymbolVar *var, const char *prefix, FILE *c_file)
+{
+	fprintf(c_file, "    //%s\n", var->parent.name);
+	mtc_var_code_for_release(var, prefix, c_file);
+	fprintf(c_file, "\n");
+}
+
+//Writes code to deserialize a given list of variables: 
+//error handling part
+void mtc_var_list_code_for_read_fail
+	(MtcSymbolVar *list, const char *prefix, FILE *c_file)
+{
+	MtcSymbolVar *iter, **start, **end, **iter_rev;
+	MtcVector reverser;
+	int free_required = 0;
+	
+	mtc_vector_init(&reverser);
+	for (iter = list; iter;
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		mtc_vector_grow(&reverser, sizeof(void *));
+		*(mtc_vector_last(&reverser, MtcSymbolVar *)) = iter;
+	}
+	
+	start = mtc_vector_first(&reverser, MtcSymbolVar *);
+	end = mtc_vector_last(&reverser, MtcSymbolVar *);
+	
+	
+	for (iter_rev = end; iter_rev >= start; iter_rev--)
+	{
+		iter = *iter_rev;
+		
+		if (free_required)
+			mtc_var_code_for_free(iter, prefix, c_file);
+		
+		if (mtc_c_type_read_can_fail(iter->type))
+		{
+			fprintf(c_file, 
+		"    _mtc_fail_%s:\n", iter->parent.name);
+			free_required = 1;
+		}
+	}
+	
+	mtc_vector_destroy(&reverser);
+}
+
+//Writes code to free a given list of variables
+void mtc_var_list_code_for_free
+	(MtcSymbolVar *list, const char *prefix, FILE *c_file)
+{
+	MtcSymbolVar *iter;
+	for (iter = list; iter;
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{	
+		mtc_var_code_for_free(iter, prefix, c_file);
+	}
+}
+
+//Writes code for deserializing given base type into a value that
+//is either valid or unset, reusing or freeing the old value. 
+//On failure the value is freed but not unset. 
+//Returns 1 if the code is failable, like mtc_var_code_for_base_read()
+int mtc_var_code_for_base_read_reuse
+	(MtcSymbolVar *var, const char *prefix, const char *segment, 
+	 const char *indent, FILE *c_file)
+{
+	if (var->type.cat == MTC_TYPE_USERDEFINED)
+	{
+		fprintf(c_file, "if (%s__read_reuse(&(", 
+			var->type.base.symbol->name);
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, "), %s, dstream) < 0)\n", segment);
+		return 1;
+	}
+	else if (mtc_c_base_type_read_reuses(var->type))
+	{
+		fprintf(c_file, "if (! (");
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, " = mtc_string_read_inline_reuse(%s, dstream, ",
+			segment);
+		mtc_var_code_base_exp(var, prefix, c_file);
+		fprintf(c_file, ")))\n");
+		return 1;
+	}
+	
+	if (mtc_c_base_type_requires_free(var->type))
+	{
+		mtc_var_code_for_base_release(var, prefix, indent, c_file);
+		fprintf(c_file, "%s", indent);
+	}
+	return mtc_var_code_for_base_read(var, prefix, segment, c_file);
+}
+
+//Writes code to deserialize a variable into its old value. 
+//Returns 0 if the code cannot fail, 1 if it jumps to _mtc_fail_<name>
+//leaving the variable freed, 2 if it jumps to _mtc_fail leaving the 
+//variable valid. 
+int mtc_var_code_for_read_reuse
+	(MtcSymbolVar *var, const char *prefix, FILE *c_file)
+{
+	//Simple types
+	if (var->type.complexity == MTC_TYPE_NORMAL)
+	{
+		fprintf(c_file, 
+				"    ");
+		if (mtc_var_code_for_base_read_reuse
+			(var, prefix, "seg", "    ", c_file))
+		{
+			fprintf(c_file,
+				"    {\n"
+				"        goto _mtc_fail_%s;\n"
+				"    }\n", var->parent.name);
+			return 1;
+		}
+		return 0;
+	}
+	//Arrays
+	else if (var->type.complexity > 0)
+	{
+		int failable;
+		
+		if (mtc_c_type_is_bulk(var->type) || mtc_c_type_is_bool(var->type))
+		{
+			mtc_var_code_for_read(var, prefix, c_file);
+			return 0;
+		}
+		if (mtc_c_type_is_varint(var->type))
+		{
+			mtc_var_code_for_read(var, prefix, c_file);
+			return 1;
+		}
+		if (mtc_c_type_is_block_string(var->type))
+		{
+			//Check all strings before releasing old ones
+			fprintf(c_file, 
+			"    {\n"
+			"        int _i;\n"
+			"        MtcSegment _check_seg = *seg;\n"
+			"        if (mtc_segment_check_strings(&_check_seg, %d) < 0)\n"
+			"            goto _mtc_fail;\n"
+			"        for (_i = 0; _i < %d; _i++)\n"
+			"        {\n"
+			"            ",
+				var->type.complexity, var->type.complexity);
+			mtc_var_code_for_base_release
+				(var, prefix, "            ", c_file);
+			fprintf(c_file, 
+			"            %s%s[_i] = mtc_segment_get_string(seg);\n"
+			"        }\n"
+			"    }\n",
+				prefix, var->parent.name);
+			return 2;
+		}
+		
+		fprintf(c_file, 
+			"    {\n"
+			"        int _i;\n"
+			"        for (_i = 0; _i < %d; _i++)\n"
+			"        {\n"
+			"            ",
+			var->type.complexity);
+		failable = mtc_var_code_for_base_read_reuse
+			(var, prefix, "seg", "            ", c_file);
+		if (failable)
+		{
+			fprintf(c_file,
+			"            {\n"
+			"                memset(&(%s%s[_i]), 0, "
+			"sizeof(%s%s[_i]));\n"
+			"                goto _mtc_fail;\n"
+			"            }\n",
+				prefix, var->parent.name, prefix, var->parent.name);
+		}
+		fprintf(c_file,
+			"        }\n"
+			"    }\n");
+		
+		return failable ? 2 : 0;
+	}
+	//Sequences
+	else if (var->type.complexity == MTC_TYPE_SEQ)
+	{
+		MtcDLen base_size = mtc_base_type_calc_base_size(var->type);
+		int bulk = mtc_c_type_is_bulk(var->type);
+		int varint = mtc_c_type_is_varint(var->type);
+		int bitset = mtc_c_type_is_bool(var->type);
+		int block_string = mtc_c_type_is_block_string(var->type);
+		int requires_free = mtc_c_base_type_requires_free(var->type);
+		
+		if (varint)
+		{
+			fprintf(c_file, 
+			"    {\n"
+			"        uint32_t _n;\n"
+			"        mtc_segment_read_uint32(seg, _n);\n"
+			"        if (mtc_dstream_bytes_left(dstream) < _n)\n"
+			"            goto _mtc_fail;\n");
+		}
+		else if (bitset)
+		{
+			fprintf(c_file, 
+			"    {\n"
+			"        uint32_t _n;\n"
+			"        MtcSegment sub_seg;\n"
+			"        mtc_segment_read_uint32(seg, _n);\n"
+			"        if (mtc_dstream_get_segment(dstream, "
+			"((size_t) _n + 7) / 8, 0, &sub_seg) < 0)\n"
+			"            goto _mtc_fail;\n");
+		}
+		else
+		{
+			fprintf(c_file, 
+			"    {\n"
+			"        %s"
+			"uint32_t _n;\n"
+			"        MtcSegment sub_seg;\n"
+			"        mtc_segment_read_uint32(seg, _n);\n"
+			"        if (mtc_dstream_get_segment(dstream, "
+			"(size_t) %d * _n, (size_t) %d * _n, &sub_seg) < 0)\n"
+			"            goto _mtc_fail;\n",
+			bulk ? "" : "int _i;\n        ",
+			(int) base_size.n_bytes, (int) base_size.n_blocks);
+		}
+		
+		//Check all strings before touching old ones
+		if (block_string)
+		{
+			fprintf(c_file, 
+			"        {\n"
+			"            MtcSegment _check_seg = sub_seg;\n"
+			"            if (mtc_segment_check_strings(&_check_seg, _n) < 0)\n"
+			"                goto _mtc_fail;\n"
+			"        }\n");
+		}
+		
+		//Free elements that are not reused, and make room for 
+		//the new ones
+		if (requires_free)
+		{
+			fprintf(c_file, 
+			"        for (_i = _n; _i < %s%s.len; _i++)\n"
+			"        {\n"
+			"            ",
+				prefix, var->parent.name);
+			mtc_var_code_for_base_release
+				(var, prefix, "            ", c_file);
+			fprintf(c_file, 
+			"        }\n");
+		}
+		fprintf(c_file, 
+			"        if (_n > %s%s.len || ! %s%s.data)\n"
+			"        {\n"
+			"            ",
+			prefix, var->parent.name, prefix, var->parent.name);
+		mtc_gen_base_type(var->type, c_file);
+		fprintf(c_file, " *_data = (");
+		mtc_gen_base_type(var->type, c_file);
+		fprintf(c_file, " *) mtc_tryrealloc\n"
+			"                (%s%s.data, sizeof(",
+			prefix, var->parent.name);
+		mtc_gen_base_type(var->type, c_file);
+		fprintf(c_file, ") * _n);\n"
+			"            if (! _data)\n"
+			"                goto _mtc_fail;\n");
+		if (requires_free)
+		{
+			fprintf(c_file, 
+			"            memset(_data + %s%s.len, 0, sizeof(",
+				prefix, var->parent.name);
+			mtc_gen_base_type(var->type, c_file);
+			fprintf(c_file, ") * (_n - %s%s.len));\n",
+				prefix, var->parent.name);
+		}
+		fprintf(c_file, 
+			"            %s%s.data = _data;\n"
+			"        }\n"
+			"        %s%s.len = _n;\n",
+			prefix, var->parent.name, 
+			prefix, var->parent.name);
+		
+		//Read the elements
+		if (varint)
+		{
+			fprintf(c_file, 
+			"        if (mtc_%s_read_array"
+			"(%s%s.data, %s%s.len, dstream) < 0)\n"
+			"            goto _mtc_fail;\n",
+				mtc_type_fundamental_names[var->type.base.fid],
+				prefix, var->parent.name, 
+				prefix, var->parent.name);
+		}
+		else if (bulk || bitset)
+		{
+			fprintf(c_file, 
+			"        mtc_segment_read_%s_array"
+			"(&sub_seg, %s%s.data, %s%s.len);\n",
+				mtc_type_fundamental_names[var->type.base.fid],
+				prefix, var->parent.name, 
+				prefix, var->parent.name);
+		}
+		else if (block_string)
+		{
+			fprintf(c_file, 
+			"        for (_i = 0; _i < %s%s.len; _i++)\n"
+			"        {\n"
+			"            ",
+				prefix, var->parent.name);
+			mtc_var_code_for_base_release
+				(var, prefix, "            ", c_file);
+			fprintf(c_file, 
+			"            %s%s.data[_i] = mtc_segment_get_string(&sub_seg);\n"
+			"        }\n",
+				prefix, var->parent.name);
+		}
+		else
+		{
+			fprintf(c_file, 
+			"        for (_i = 0; _i < %s%s.len; _i++)\n"
+			"        {\n"
+			"            ",
+				prefix, var->parent.name);
+			if (mtc_var_code_for_base_read_reuse
+				(var, prefix, "&sub_seg", "            ", c_file))
+			{
+				fprintf(c_file,
+			"            {\n"
+			"                memset(&(%s%s.data[_i]), 0, "
+			"sizeof(%s%s.data[_i]));\n"
+			"                goto _mtc_fail;\n"
+			"            }\n",
+					prefix, var->parent.name, 
+					prefix, var->parent.name);
+			}
+			fprintf(c_file, 
+			"        }\n");
+		}
+		fprintf(c_file, 
+			"    }\n");
+		
+		return 2;
+	}
+	//Reference
+	else
+	{
+		//Free the old value and read a new one
+		mtc_var_code_for_release(var, prefix, c_file);
+		mtc_var_code_for_read(var, prefix, c_file);
+		
+		return 1;
+	}
+}
+
+//Writes code to deserialize a given list of variables into their 
+//old values, with error handling. The code frees the structure 
+//value points to on failure. 
+void mtc_var_list_code_for_read_reuse
+	(MtcSymbolVar *list, const char *name, FILE *c_file)
+{
+	MtcSymbolVar *iter;
+	int *res, i, failable = 0;
+	
+	for (iter = list, i = 0; iter;
+		iter = (MtcSymbolVar *) iter->parent.next)
+		i++;
+	res = (int *) mtc_alloc(sizeof(int) * (i + 1));
+	
+	for (iter = list, i = 0; iter;
+		iter = (MtcSymbolVar *) iter->parent.next, i++)
+	{
+		fprintf(c_file,
+			"    //value->%s\n", iter->parent.name);
+		res[i] = mtc_var_code_for_read_reuse(iter, "value->", c_file);
+		if (res[i])
+			failable = 1;
+		fprintf(c_file, "\n");
+	}
+	
+	fprintf(c_file, "    return 0;\n");
+	
+	if (failable)
+	{
+		//Variables failing to read are unset so that the structure
+		//can be freed as a whole
+		fprintf(c_file, "\n");
+		for (iter = list, i = 0; iter;
+			iter = (MtcSymbolVar *) iter->parent.next, i++)
+		{
+			if (res[i] != 1)
+				continue;
+			fprintf(c_file, 
+			"    _mtc_fail_%s:\n"
+			"    memset(&(value->%s), 0, sizeof(value->%s));\n"
+			"    goto _mtc_fail;\n",
+				iter->parent.name, 
+				iter->parent.name, iter->parent.name);
+		}
+		fprintf(c_file, 
+			"    _mtc_fail:\n"
+			"    %s__free(value);\n"
+			"    return -1;\n",
+			name);
+	}
+	
+	mtc_free(res);
+}
+
+/* Read-only views
+ * 
+ * A view of a structure value points into the message holding it, 
+ * so that members can be decoded on demand without allocating memory.
+ * Creating a view checks the whole value upfront the way reading it 
+ * would. Dynamic parts of members are not at fixed positions, so the 
+ * view records where the dynamic part of each member starts.
+ */
+
+//Tells whether checking a value of the base type takes more than 
+//skipping its base part
+static int mtc_c_base_type_needs_check(MtcType type)
+{
+	MtcSymbolVar *iter;
+	
+	if (type.cat == MTC_TYPE_FUNDAMENTAL)
+	{
+		if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING
+			|| type.base.fid == MTC_TYPE_FUNDAMENTAL_MSG
+			|| mtc_type_fundamental_is_inline(type.base.fid)
+			|| mtc_type_fundamental_is_varint(type.base.fid)
+			|| type.enum_symbol)
+			return 1;
+		
+		return 0;
+	}
+	
+	for (iter = ((MtcSymbolStruct *) type.base.symbol)->members; iter;
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		if (iter->type.complexity == MTC_TYPE_SEQ
+			|| iter->type.complexity == MTC_TYPE_REF
+			|| mtc_c_base_type_needs_check(iter->type))
+			return 1;
+	}
+	
+	return 0;
+}
+
+//Tells whether values of the base type have a dynamic part in the 
+//message. Unlike mtc_base_type_is_constsize() this ignores the heap
+//used by builder mode.
+static int mtc_c_base_type_has_dynamic(MtcType type)
+{
+	if (type.cat == MTC_TYPE_FUNDAMENTAL 
+		&& type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING
+		&& ! mtc_type_fundamental_is_inline(type.base.fid))
+		return 0;
+	
+	return ! mtc_base_type_is_constsize(type);
+}
+
+//Tells whether the view records where the dynamic part of a 
+//variable of the type starts
+static int mtc_c_type_view_records(MtcType type)
+{
+	if (type.complexity == MTC_TYPE_SEQ 
+		|| type.complexity == MTC_TYPE_REF)
+		return 1;
+	
+	return mtc_c_base_type_has_dynamic(type);
+}
+
+//Tells whether the view of the structure records any positions
+static int mtc_c_struct_view_records(MtcSymbolStruct *value)
+{
+	MtcSymbolVar *iter;
+	
+	for (iter = value->members; iter; 
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		if (mtc_c_type_view_records(iter->type))
+			return 1;
+	}
+	
+	return 0;
+}
+
+//Writes code that checks a value of given base type without 
+//deserializing it, advancing segment and dstream past the value. 
+//fail is the statement run if the value is invalid, NULL if the value
+//has been checked before. The code is put in a block of its own 
+//unless in_block is set, in which case it starts a block. 
+//Writes nothing and returns 0 if there is nothing to check.
+static int mtc_var_code_for_base_check
+	(MtcSymbolVar *var, const char *segment, const char *dstream, 
+	 const char *fail, int in_block, const char *indent, FILE *c_file)
+{
+	MtcType type = var->type;
+	const char *inner = in_block ? "" : "    ";
+	
+	if (! mtc_c_base_type_needs_check(type))
+		return 0;
+	
+	if (type.cat == MTC_TYPE_USERDEFINED)
+	{
+		if (! in_block)
+			fprintf(c_file, "%s{\n", indent);
+		fprintf(c_file, 
+			"%s%s%s__view _view;\n",
+			indent, inner, type.base.symbol->name);
+		if (fail)
+			fprintf(c_file, 
+			"%s%sif (%s__view_read(&_view, %s, %s) < 0)\n"
+			"%s%s    %s\n",
+				indent, inner, type.base.symbol->name, segment, dstream, 
+				indent, inner, fail);
+		else
+			fprintf(c_file, 
+			"%s%s%s__view_read(&_view, %s, %s);\n",
+				indent, inner, type.base.symbol->name, segment, dstream);
+		if (! in_block)
+			fprintf(c_file, "%s}\n", indent);
+		
+		return 1;
+	}
+	
+	fprintf(c_file, fail ? "%sif (" : "%s", indent);
+	if (mtc_type_fundamental_is_inline(type.base.fid))
+		fprintf(c_file, "mtc_%s_check_inline(%s, %s)",
+			mtc_type_fundamental_names[type.base.fid], segment, dstream);
+	else if (mtc_type_fundamental_is_varint(type.base.fid))
+		fprintf(c_file, "mtc_%s_check(%s)",
+			mtc_type_fundamental_names[type.base.fid], dstream);
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+		fprintf(c_file, "mtc_segment_check_string(%s)", segment);
+	else if (type.enum_symbol)
+		fprintf(c_file, "mtc_segment_check_enum%d(%s, %d)", 
+			(int) mtc_type_fundamental_sizes[type.base.fid].n_bytes * 8, 
+			segment, 
+			(int) ((MtcSymbolEnum *) type.enum_symbol)->n_values);
+	else
+		fprintf(c_file, "mtc_msg_check(%s, %s)", segment, dstream);
+	if (fail)
+		fprintf(c_file, " < 0)\n%s    %s\n", indent, fail);
+	else
+		fprintf(c_file, ";\n");
+	
+	return 1;
+}
+
+//Writes the size of n elements of given size
+static void mtc_code_view_size(int size, const char *n, FILE *c_file)
+{
+	if (size)
+		fprintf(c_file, "(size_t) %d * %s", size, n);
+	else
+		fprintf(c_file, "0");
+}
+
+//Writes code advancing the segment of a view being read past 
+//members that need no checking, and resets skip
+static void mtc_code_for_view_skip(MtcDLen *skip, FILE *c_file)
+{
+	if (skip->n_bytes)
+		fprintf(c_file, "    seg->bytes += %d;\n", (int) skip->n_bytes);
+	if (skip->n_blocks)
+		fprintf(c_file, "    seg->blocks += %d;\n", (int) skip->n_blocks);
+	if (skip->n_bytes || skip->n_blocks)
+		fprintf(c_file, "\n");
+	
+	skip->n_bytes = skip->n_blocks = 0;
+}
+
+//Writes code that checks a given list of variables and records 
+//positions of their dynamic parts in a view
+static void mtc_var_list_code_for_view_read
+	(MtcSymbolVar *list, FILE *c_file)
+{
+	MtcSymbolVar *iter;
+	MtcDLen skip = {0, 0, 0};
+	
+	for (iter = list; iter;
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		MtcDLen base_size = mtc_base_type_calc_base_size(iter->type);
+		int check = mtc_c_base_type_needs_check(iter->type);
+		
+		//Members only to be skipped are skipped together
+		if (iter->type.complexity >= 0 && ! check)
+		{
+			MtcDLen size = mtc_type_calc_base_size(iter->type);
+			
+			skip.n_bytes += size.n_bytes;
+			skip.n_blocks += size.n_blocks;
+			continue;
+		}
+		mtc_code_for_view_skip(&skip, c_file);
+		
+		fprintf(c_file,
+			"    //%s\n", iter->parent.name);
+		if (mtc_c_type_view_records(iter->type))
+			fprintf(c_file, 
+			"    view->dyn.%s.bytes = dstream->bytes;\n"
+			"    view->dyn.%s.blocks = dstream->blocks;\n",
+				iter->parent.name, iter->parent.name);
+		
+		//Simple types
+		if (iter->type.complexity == MTC_TYPE_NORMAL)
+		{
+			mtc_var_code_for_base_check
+				(iter, "seg", "dstream", "return -1;", 0, "    ", c_file);
+		}
+		//Arrays of strings
+		else if (iter->type.complexity > 0
+			&& mtc_c_type_is_block_string(iter->type))
+		{
+			fprintf(c_file, 
+				"    if (mtc_segment_check_strings(seg, %d) < 0)\n"
+				"        return -1;\n",
+				iter->type.complexity);
+		}
+		//Arrays
+		else if (iter->type.complexity > 0)
+		{
+			fprintf(c_file, 
+				"    {\n"
+				"        int _i;\n"
+				"        for (_i = 0; _i < %d; _i++)\n"
+				"        {\n",
+				iter->type.complexity);
+			mtc_var_code_for_base_check(iter, "seg", "dstream", 
+				"return -1;", 1, "            ", c_file);
+			fprintf(c_file, 
+				"        }\n"
+				"    }\n");
+		}
+		//Sequences of variable length integers
+		else if (iter->type.complexity == MTC_TYPE_SEQ
+			&& mtc_c_type_is_varint(iter->type))
+		{
+			fprintf(c_file, 
+				"    {\n"
+				"        uint32_t _n, _i;\n"
+				"        mtc_segment_read_uint32(seg, _n);\n"
+				"        if (mtc_dstream_bytes_left(dstream) < _n)\n"
+				"            return -1;\n"
+				"        for (_i = 0; _i < _n; _i++)\n"
+				"        {\n");
+			mtc_var_code_for_base_check(iter, "seg", "dstream", 
+				"return -1;", 1, "            ", c_file);
+			fprintf(c_file, 
+				"        }\n"
+				"    }\n");
+		}
+		//Sequences
+		else if (iter->type.complexity == MTC_TYPE_SEQ)
+		{
+			int block_string = mtc_c_type_is_block_string(iter->type);
+			
+			fprintf(c_file, 
+				"    {\n"
+				"        uint32_t _n%s;\n"
+				"        MtcSegment sub_seg;\n"
+				"        mtc_segment_read_uint32(seg, _n);\n"
+				"        if (mtc_dstream_get_segment(dstream, ",
+				check && ! block_string ? ", _i" : "");
+			if (mtc_c_type_is_bool(iter->type))
+				fprintf(c_file, "((size_t) _n + 7) / 8");
+			else
+				mtc_code_view_size(base_size.n_bytes, "_n", c_file);
+			fprintf(c_file, ", ");
+			mtc_code_view_size(base_size.n_blocks, "_n", c_file);
+			fprintf(c_file, ", &sub_seg) < 0)\n"
+				"            return -1;\n");
+			if (block_string)
+			{
+				fprintf(c_file, 
+				"        if (mtc_segment_check_strings(&sub_seg, _n) < 0)\n"
+				"            return -1;\n");
+			}
+			else if (check)
+			{
+				fprintf(c_file, 
+				"        for (_i = 0; _i < _n; _i++)\n"
+				"        {\n");
+				mtc_var_code_for_base_check(iter, "&sub_seg", "dstream", 
+					"return -1;", 1, "            ", c_file);
+				fprintf(c_file, 
+				"        }\n");
+			}
+			fprintf(c_file, 
+				"    }\n");
+		}
+		//Reference
+		else
+		{
+			fprintf(c_file, 
+				"    {\n"
+				"        char presence;\n"
+				"        mtc_segment_read_uchar(seg, presence);\n"
+				"        if (presence)\n"
+				"        {\n"
+				"            MtcSegment sub_seg;\n"
+				"            if (mtc_dstream_get_segment(dstream, "
+				"%d, %d, &sub_seg) < 0)\n"
+				"                return -1;\n",
+				(int) base_size.n_bytes, (int) base_size.n_blocks);
+			mtc_var_code_for_base_check(iter, "&sub_seg", "dstream", 
+				"return -1;", 0, "            ", c_file);
+			fprintf(c_file, 
+				"        }\n"
+				"    }\n");
+		}
+		fprintf(c_file, "\n");
+	}
+	mtc_code_for_view_skip(&skip, c_file);
+}
+
+//Writes the prototype of the function that gets a member from a view
+static void mtc_var_gen_view_get
+	(MtcSymbolVar *var, const char *name, FILE *output)
+{
+	MtcType type = var->type;
+	
+	mtc_c_gen_fn_storage(output);
+	if (type.cat == MTC_TYPE_USERDEFINED)
+		fprintf(output, "void ");
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+		fprintf(output, "const char *");
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_MSG)
+		fprintf(output, "MtcMsg *");
+	else
+	{
+		mtc_gen_base_type(type, output);
+		fprintf(output, " ");
+	}
+	
+	fprintf(output, "%s__view_get__%s\n    (const %s__view *view",
+		name, var->parent.name, name);
+	if (type.complexity > 0 || type.complexity == MTC_TYPE_SEQ)
+		fprintf(output, ", uint32_t i");
+	if (type.cat == MTC_TYPE_USERDEFINED)
+		fprintf(output, ", %s__view *res", type.base.symbol->name);
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+		fprintf(output, ", size_t *len");
+	fprintf(output, ")");
+}
+
+//Writes the rest of an offset from a position in a view: a constant, 
+//and the size of an element times i if indexed
+static void mtc_code_view_offset
+	(int offset, int size, int indexed, FILE *c_file)
+{
+	if (offset)
+		fprintf(c_file, " + %d", offset);
+	if (indexed && size)
+		fprintf(c_file, " + (size_t) %d * i", size);
+	fprintf(c_file, ";\n");
+}
+
+//Writes the function that gets a member from a view. offset is 
+//the position of the member in the base part of the structure.
+static void mtc_var_code_for_view_get
+	(MtcSymbolVar *var, MtcDLen offset, const char *name, FILE *c_file)
+{
+	MtcType type = var->type;
+	MtcDLen base_size = mtc_base_type_calc_base_size(type);
+	int userdefined = (type.cat == MTC_TYPE_USERDEFINED);
+	int dynamic = mtc_c_base_type_has_dynamic(type);
+	int varint = mtc_c_type_is_varint(type);
+	int in_base = (type.complexity >= 0);
+	int indexed = (type.complexity > 0 || type.complexity == MTC_TYPE_SEQ);
+	int bitset = (indexed && mtc_c_type_is_bool(type));
+	int has_dstream = (dynamic || userdefined);
+	int has_res = (! userdefined 
+		&& type.base.fid != MTC_TYPE_FUNDAMENTAL_STRING
+		&& type.base.fid != MTC_TYPE_FUNDAMENTAL_MSG);
+	
+	mtc_var_gen_view_get(var, name, c_file);
+	fprintf(c_file, "\n{\n");
+	if (! varint)
+		fprintf(c_file, "    MtcSegment seg;\n");
+	if (has_dstream)
+		fprintf(c_file, "    MtcDStream dstream;\n");
+	if (has_res)
+	{
+		fprintf(c_file, "    ");
+		mtc_gen_base_type(type, c_file);
+		fprintf(c_file, " res;\n");
+	}
+	if (indexed && dynamic)
+		fprintf(c_file, "    uint32_t _i;\n");
+	fprintf(c_file, "    \n");
+	
+	//Find the base part, it is in the dynamic part for sequences and
+	//references. Elements of variable size are found by skipping
+	//preceding ones.
+	if (! varint && (base_size.n_bytes || has_dstream || type.bit))
+	{
+		if (in_base)
+			fprintf(c_file, "    seg.bytes = view->seg.bytes");
+		else
+			fprintf(c_file, "    seg.bytes = view->dyn.%s.bytes",
+				var->parent.name);
+		if (bitset)
+		{
+			//Elements are packed 8 to a byte
+			if (in_base && offset.n_bytes)
+				fprintf(c_file, " + %d", (int) offset.n_bytes);
+			fprintf(c_file, " + (i >> 3);\n");
+		}
+		else
+		{
+			mtc_code_view_offset(in_base ? offset.n_bytes : 0, 
+				base_size.n_bytes, ! dynamic && indexed, c_file);
+		}
+	}
+	if (! varint && (base_size.n_blocks || has_dstream))
+	{
+		if (in_base)
+			fprintf(c_file, "    seg.blocks = view->seg.blocks");
+		else
+			fprintf(c_file, "    seg.blocks = view->dyn.%s.blocks",
+				var->parent.name);
+		mtc_code_view_offset(in_base ? offset.n_blocks : 0, 
+			base_size.n_blocks, ! dynamic && indexed, c_file);
+	}
+	
+	//Find the dynamic part
+	if (has_dstream)
+	{
+		fprintf(c_file, "    dstream = view->dstream;\n");
+	}
+	if (dynamic)
+	{
+		if (type.complexity == MTC_TYPE_SEQ && ! varint)
+		{
+			fprintf(c_file, "    dstream.bytes = seg.bytes");
+			if (base_size.n_bytes)
+				fprintf(c_file, " + (size_t) %d * %s__view_len__%s(view)",
+					(int) base_size.n_bytes, name, var->parent.name);
+			fprintf(c_file, ";\n    dstream.blocks = seg.blocks");
+			if (base_size.n_blocks)
+				fprintf(c_file, " + (size_t) %d * %s__view_len__%s(view)",
+					(int) base_size.n_blocks, name, var->parent.name);
+			fprintf(c_file, ";\n");
+		}
+		else if (type.complexity == MTC_TYPE_REF && ! varint)
+		{
+			fprintf(c_file, "    dstream.bytes = seg.bytes");
+			mtc_code_view_offset(base_size.n_bytes, 0, 0, c_file);
+			fprintf(c_file, "    dstream.blocks = seg.blocks");
+			mtc_code_view_offset(base_size.n_blocks, 0, 0, c_file);
+		}
+		else
+		{
+			fprintf(c_file, 
+				"    dstream.bytes = view->dyn.%s.bytes;\n"
+				"    dstream.blocks = view->dyn.%s.blocks;\n",
+				var->parent.name, var->parent.name);
+		}
+	}
+	if (indexed && dynamic)
+	{
+		fprintf(c_file, 
+			"    for (_i = 0; _i < i; _i++)\n"
+			"    {\n");
+		mtc_var_code_for_base_check
+			(var, "&seg", "&dstream", NULL, 1, "        ", c_file);
+		fprintf(c_file, 
+			"    }\n");
+	}
+	fprintf(c_file, "    \n");
+	
+	//Decode the value
+	if (userdefined)
+	{
+		//A view that records nothing needs no walk, and the value
+		//has been checked when the outer view was created
+		if (mtc_c_struct_view_records
+			((MtcSymbolStruct *) type.base.symbol))
+			fprintf(c_file, "    %s__view_read(res, &seg, &dstream);\n",
+				type.base.symbol->name);
+		else
+			fprintf(c_file, 
+				"    res->seg = seg;\n"
+				"    res->dstream = dstream;\n");
+	}
+	else if (varint)
+	{
+		fprintf(c_file, 
+			"    mtc_%s_read(&res, &dstream);\n"
+			"    return res;\n",
+			mtc_type_fundamental_names[type.base.fid]);
+	}
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+	{
+		if (mtc_type_fundamental_is_inline(type.base.fid))
+			fprintf(c_file, 
+			"    return mtc_string_view_inline(&seg, &dstream, len);\n");
+		else
+			fprintf(c_file, 
+			"    return mtc_segment_view_string(&seg, len);\n");
+	}
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_RAW)
+	{
+		if (mtc_type_fundamental_is_inline(type.base.fid))
+			fprintf(c_file, 
+			"    mtc_raw_view_inline(&res, &seg, &dstream);\n");
+		else
+			fprintf(c_file, 
+			"    mtc_segment_view_raw(&seg, &res);\n");
+		fprintf(c_file, 
+			"    return res;\n");
+	}
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_MSG)
+	{
+		fprintf(c_file, 
+			"    return mtc_msg_read(&seg, &dstream);\n");
+	}
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_FLT32
+		|| type.base.fid == MTC_TYPE_FUNDAMENTAL_FLT64)
+	{
+		fprintf(c_file, 
+			"    mtc_segment_read_%s(&seg, &res);\n"
+			"    return res;\n",
+			mtc_type_fundamental_names[type.base.fid]);
+	}
+	else if (bitset)
+	{
+		fprintf(c_file, 
+			"    res = (((unsigned char *) seg.bytes)[0] >> (i & 7)) & 1;\n"
+			"    return res;\n");
+	}
+	else if (type.bit)
+	{
+		fprintf(c_file, 
+			"    mtc_segment_read_bit(&seg, res, %d);\n"
+			"    return res;\n",
+			type.bit);
+	}
+	else
+	{
+		fprintf(c_file, 
+			"    mtc_segment_read_%s(&seg, res);\n"
+			"    return res;\n",
+			mtc_type_fundamental_names[type.base.fid]);
+	}
+	fprintf(c_file, "}\n\n");
+}
+
+//Writes C code for the view of given structure
+static void mtc_struct_gen_view_code
+	(MtcSymbolStruct *value, FILE *h_file, FILE *c_file)
+{
+	MtcSymbolVar *iter;
+	MtcDLen offset = {0, 0, 0};
+	const char *name = value->parent.name;
+	
+	//Type of the view
+	fprintf(h_file, 
+		"typedef struct\n"
+		"{\n"
+		"\tMtcSegment seg;\n"
+		"\tMtcDStream dstream;\n");
+	if (mtc_c_struct_view_records(value))
+	{
+		fprintf(h_file, "\tstruct\n\t{\n");
+		for (iter = value->members; iter; 
+			iter = (MtcSymbolVar *) iter->parent.next)
+		{
+			if (mtc_c_type_view_records(iter->type))
+				fprintf(h_file, "\t\tMtcSegment %s;\n", iter->parent.name);
+		}
+		fprintf(h_file, "\t} dyn;\n");
+	}
+	fprintf(h_file, "} %s__view;\n\n", name);
+	
+	//Function to check a value and create its view
+	mtc_c_gen_fn_storage(h_file);
+	fprintf(h_file, 
+		"int %s__view_read\n"
+		"    (%s__view *view, MtcSegment *seg, MtcDStream *dstream);\n\n",
+		name, name);
+	mtc_c_gen_fn_storage(c_file);
+	fprintf(c_file, 
+		"int %s__view_read\n"
+		"    (%s__view *view, MtcSegment *seg, MtcDStream *dstream)\n"
+		"{\n"
+		"    view->seg = *seg;\n"
+		"    view->dstream = *dstream;\n"
+		"    \n",
+		name, name);
+	mtc_var_list_code_for_view_read(value->members, c_file);
+	fprintf(c_file, 
+		"    return 0;\n"
+		"}\n\n");
+	
+	//Function to create a view of a message
+	mtc_c_gen_fn_storage(h_file);
+	fprintf(h_file, 
+		"int %s__view_init(MtcMsg *msg, %s__view *view);\n\n",
+		name, name);
+	mtc_c_gen_fn_storage(c_file);
+	fprintf(c_file, 
+		"int %s__view_init(MtcMsg *msg, %s__view *view)\n"
+		"{\n"
+		"    MtcSegment seg;\n"
+		"    MtcDStream dstream;\n"
+		"    \n"
+		"    mtc_msg_iter(msg, &dstream);\n"
+		"    if (mtc_dstream_get_segment(&dstream, %d, %d, &seg) < 0)\n"
+		"        return -1;\n"
+		"    if (%s__view_read(view, &seg, &dstream) < 0)\n"
+		"        return -1;\n"
+		"    if (! mtc_dstream_is_empty(&dstream))\n"
+		"        return -1;\n"
+		"    \n"
+		"    return 0;\n"
+		"}\n\n",
+		name, name, 
+		(int) value->base_size.n_bytes, (int) value->base_size.n_blocks,
+		name);
+	
+	//Functions to get members
+	for (iter = value->members; iter; 
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		if (iter->type.complexity == MTC_TYPE_SEQ)
+		{
+			mtc_c_gen_fn_storage(h_file);
+			fprintf(h_file, 
+				"uint32_t %s__view_len__%s(const %s__view *view);\n\n",
+				name, iter->parent.name, name);
+			mtc_c_gen_fn_storage(c_file);
+			fprintf(c_file, 
+				"uint32_t %s__view_len__%s(const %s__view *view)\n"
+				"{\n"
+				"    MtcSegment seg;\n"
+				"    uint32_t res;\n"
+				"    \n"
+				"    seg.bytes = view->seg.bytes + %d;\n"
+				"    mtc_segment_read_uint32(&seg, res);\n"
+				"    return res;\n"
+				"}\n\n",
+				name, iter->parent.name, name, (int) offset.n_bytes);
+		}
+		else if (iter->type.complexity == MTC_TYPE_REF)
+		{
+			mtc_c_gen_fn_storage(h_file);
+			fprintf(h_file, 
+				"int %s__view_has__%s(const %s__view *view);\n\n",
+				name, iter->parent.name, name);
+			mtc_c_gen_fn_storage(c_file);
+			fprintf(c_file, 
+				"int %s__view_has__%s(const %s__view *view)\n"
+				"{\n"
+				"    return view->seg.bytes[%d] ? 1 : 0;\n"
+				"}\n\n",
+				name, iter->parent.name, name, (int) offset.n_bytes);
+		}
+		
+		//Arrays and sequences of bytes can be returned in one piece
+		if (mtc_c_type_is_byte(iter->type)
+			&& (iter->type.complexity > 0
+				|| iter->type.complexity == MTC_TYPE_SEQ))
+		{
+			const char *c_name = mtc_c_names[iter->type.base.fid];
+			
+			mtc_c_gen_fn_storage(h_file);
+			fprintf(h_file,
+				"const %s *%s__view_data__%s(const %s__view *view);\n\n",
+				c_name, name, iter->parent.name, name);
+			mtc_c_gen_fn_storage(c_file);
+			fprintf(c_file,
+				"const %s *%s__view_data__%s(const %s__view *view)\n"
+				"{\n",
+				c_name, name, iter->parent.name, name);
+			if (iter->type.complexity > 0)
+				fprintf(c_file,
+				"    return (const %s *) view->seg.bytes + %d;\n",
+				c_name, (int) offset.n_bytes);
+			else
+				fprintf(c_file,
+				"    return (const %s *) view->dyn.%s.bytes;\n",
+				c_name, iter->parent.name);
+			fprintf(c_file, "}\n\n");
+		}
+		
+		mtc_var_gen_view_get(iter, name, h_file);
+		fprintf(h_file, ";\n\n");
+		mtc_var_code_for_view_get(iter, offset, name, c_file);
+		
+		{
+			MtcDLen size = mtc_type_calc_base_size(iter->type);
+			
+			offset.n_bytes += size.n_bytes;
+			offset.n_blocks += size.n_blocks;
+		}
+	}
+}
+
+//Writes code to serialize members of a flat structure 
+//at fixed offsets from bytes
+static void mtc_var_list_code_for_pack(MtcSymbolVar *list, FILE *c_file)
+{
+	MtcSymbolVar *iter;
+	int offset = 0;
+	
+	for (iter = list; iter;
+			iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		MtcDLen size = mtc_type_calc_base_size(iter->type);
+		
+		fprintf(c_file,
+			"    //value->%s\n", iter->parent.name);
+		
+		//Flat structures
+		if (iter->type.cat == MTC_TYPE_USERDEFINED)
+		{
+			MtcDLen base_size = mtc_base_type_calc_base_size(iter->type);
+			
+			if (iter->type.complexity == MTC_TYPE_NORMAL)
+				fprintf(c_file, 
+				"    %s__pack(&(value->%s), bytes + %d);\n",
+					iter->type.base.symbol->name, iter->parent.name,
+					offset);
+			else
+				fprintf(c_file, 
+				"    {\n"
+				"        int _i;\n"
+				"        for (_i = 0; _i < %d; _i++)\n"
+				"            %s__pack(&(value->%s[_i]), "
+				"bytes + %d + %d * _i);\n"
+				"    }\n",
+					iter->type.complexity, 
+					iter->type.base.symbol->name, iter->parent.name,
+					offset, (int) base_size.n_bytes);
+		}
+		else
+		{
+			fprintf(c_file, 
+				"    seg.bytes = bytes + %d;\n", offset);
+			
+			//Simple types
+			if (iter->type.complexity == MTC_TYPE_NORMAL)
+			{
+				fprintf(c_file, "    ");
+				mtc_var_code_for_base_write
+					(iter, "value->", "&seg", c_file);
 			}
-			if (! baseless)
+			//Arrays of bools
+			else if (mtc_c_type_is_bool(iter->type))
 			{
-				fprintf(c_file, "        mtc_free(%s%s);\n",
-					prefix, var->parent.name);
+				fprintf(c_file, 
+				"    mtc_segment_write_bool_array(&seg, value->%s, %d);\n",
+					iter->parent.name, iter->type.complexity);
+			}
+			//Arrays of integers and floating point values
+			else if (mtc_c_type_is_bulk(iter->type))
+			{
+				fprintf(c_file, 
+				"    mtc_segment_write_%s_array(&seg, value->%s, %d);\n",
+					mtc_type_fundamental_names[iter->type.base.fid],
+					iter->parent.name, iter->type.complexity);
+			}
+			//Arrays
+			else
+			{
+				fprintf(c_file, 
+				"    {\n"
+				"        int _i;\n"
+				"        for (_i = 0; _i < %d; _i++)\n"
+				"        {\n"
+				"            ",
+					iter->type.complexity);
+				mtc_var_code_for_base_write
+					(iter, "value->", "&seg", c_file);
+				fprintf(c_file,
+				"        }\n"
+				"    }\n");
 			}
-			
-			fprintf(c_file, "    }\n");
 		}
+		fprintf(c_file, "\n");
+		
+		offset += size.n_bytes;
 	}
-	fprintf(c_file, "\n");
 }
 
-//Writes code to deserialize a given list of variables: 
-//error handling part
-void mtc_var_list_code_for_read_fail
-	(MtcSymbolVar *list, const char *prefix, FILE *c_file)
+//Writes code to deserialize members of a flat structure 
+//at fixed offsets from bytes
+static void mtc_var_list_code_for_unpack
+	(MtcSymbolVar *list, FILE *c_file)
 {
-	MtcSymbolVar *iter, **start, **end, **iter_rev;
-	MtcVector reverser;
-	int free_required = 0;
+	MtcSymbolVar *iter;
+	int offset = 0;
 	
-	mtc_vector_init(&reverser);
 	for (iter = list; iter;
-		iter = (MtcSymbolVar *) iter->parent.next)
-	{
-		mtc_vector_grow(&reverser, sizeof(void *));
-		*(mtc_vector_last(&reverser, MtcSymbolVar *)) = iter;
-	}
-	
-	start = mtc_vector_first(&reverser, MtcSymbolVar *);
-	end = mtc_vector_last(&reverser, MtcSymbolVar *);
-	
-	
-	for (iter_rev = end; iter_rev >= start; iter_rev--)
+			iter = (MtcSymbolVar *) iter->parent.next)
 	{
-		iter = *iter_rev;
+		MtcDLen size = mtc_type_calc_base_size(iter->type);
 		
-		if (free_required)
-			mtc_var_code_for_free(iter, prefix, c_file);
+		fprintf(c_file,
+			"    //value->%s\n", iter->parent.name);
 		
-		if (mtc_c_type_read_can_fail(iter->type))
+		//Flat structures
+		if (iter->type.cat == MTC_TYPE_USERDEFINED)
+		{
+			MtcDLen base_size = mtc_base_type_calc_base_size(iter->type);
+			
+			if (iter->type.complexity == MTC_TYPE_NORMAL)
+				fprintf(c_file, 
+				"    if (%s__unpack(&(value->%s), bytes + %d) < 0)\n"
+				"        return -1;\n",
+					iter->type.base.symbol->name, iter->parent.name,
+					offset);
+			else
+				fprintf(c_file, 
+				"    {\n"
+				"        int _i;\n"
+				"        for (_i = 0; _i < %d; _i++)\n"
+				"            if (%s__unpack(&(value->%s[_i]), "
+				"bytes + %d + %d * _i) < 0)\n"
+				"                return -1;\n"
+				"    }\n",
+					iter->type.complexity, 
+					iter->type.base.symbol->name, iter->parent.name,
+					offset, (int) base_size.n_bytes);
+		}
+		else
 		{
 			fprintf(c_file, 
-		"    _mtc_fail_%s:\n", iter->parent.name);
-			free_required = 1;
+				"    seg.bytes = (char *) bytes + %d;\n", offset);
+			
+			//Simple types
+			if (iter->type.complexity == MTC_TYPE_NORMAL)
+			{
+				fprintf(c_file, "    ");
+				if (mtc_var_code_for_base_read
+					(iter, "value->", "&seg", c_file))
+				{
+					fprintf(c_file, 
+				"        return -1;\n");
+				}
+			}
+			//Arrays of bools
+			else if (mtc_c_type_is_bool(iter->type))
+			{
+				fprintf(c_file, 
+				"    mtc_segment_read_bool_array(&seg, value->%s, %d);\n",
+					iter->parent.name, iter->type.complexity);
+			}
+			//Arrays of integers and floating point values
+			else if (mtc_c_type_is_bulk(iter->type))
+			{
+				fprintf(c_file, 
+				"    mtc_segment_read_%s_array(&seg, value->%s, %d);\n",
+					mtc_type_fundamental_names[iter->type.base.fid],
+					iter->parent.name, iter->type.complexity);
+			}
+			//Arrays
+			else
+			{
+				fprintf(c_file, 
+				"    {\n"
+				"        int _i;\n"
+				"        for (_i = 0; _i < %d; _i++)\n"
+				"        {\n"
+				"            ",
+					iter->type.complexity);
+				if (mtc_var_code_for_base_read
+					(iter, "value->", "&seg", c_file))
+				{
+					fprintf(c_file, 
+				"                return -1;\n");
+				}
+				fprintf(c_file,
+				"        }\n"
+				"    }\n");
+			}
 		}
+		fprintf(c_file, "\n");
+		
+		offset += size.n_bytes;
 	}
-	
-	mtc_vector_destroy(&reverser);
 }
 
-//Writes code to free a given list of variables
-void mtc_var_list_code_for_free
-	(MtcSymbolVar *list, const char *prefix, FILE *c_file)
+//Writes C code for given enumeration
+void mtc_enum_gen_code
+	(MtcSymbolEnum *value, FILE *h_file, FILE *c_file)
 {
-	MtcSymbolVar *iter;
-	for (iter = list; iter;
-		iter = (MtcSymbolVar *) iter->parent.next)
-	{	
-		mtc_var_code_for_free(iter, prefix, c_file);
+	MtcSymbol *iter;
+	int i;
+	
+	//Separator comment
+	fprintf(h_file, "//%s\n", value->parent.name);
+	
+	//Values are stored in the smallest unsigned integer type 
+	//holding all of them
+	fprintf(h_file, "typedef %s %s;\n\n", 
+		mtc_c_names[value->fid], value->parent.name);
+	
+	fprintf(h_file, "enum\n{\n");
+	for (iter = value->values, i = 0; iter; iter = iter->next, i++)
+	{
+		fprintf(h_file, "\t%s = %d%s\n", 
+			iter->name, i, iter->next ? "," : "");
 	}
+	fprintf(h_file, "};\n\n");
 }
 
 //Writes C code for given structure
@@ -878,7 +2678,7 @@ void mtc_struct_gen_code
 {
 	MtcSymbolVar *iter;
 	MtcDLen base_size;
-	int constsize;
+	int constsize, flat;
 	
 	//Separator comment
 	fprintf(h_file, "//%s\n", value->parent.name);
@@ -900,17 +2700,90 @@ void mtc_struct_gen_code
 	//Size calculation function
 	base_size = value->base_size;
 	constsize = value->constsize;
+	flat = mtc_c_struct_is_flat(value);
+	
+	if (flat)
+	{
+		//Structure is flat, so it is written and read at fixed 
+		//offsets without going through the dual stream
+		int use_seg = 0;
+		
+		for (iter = value->members; iter; 
+			iter = (MtcSymbolVar *) iter->parent.next)
+		{
+			if (iter->type.cat == MTC_TYPE_FUNDAMENTAL)
+				use_seg = 1;
+		}
+		
+		fprintf(h_file, 
+			"#define %s__WIRE_SIZE %d\n\n",
+			value->parent.name, (int) base_size.n_bytes);
+		
+		//Serialization at fixed offsets
+		mtc_c_gen_fn_storage(h_file);
+		fprintf(h_file, 
+			"void %s__pack(%s *value, char *bytes);\n\n",
+			value->parent.name, value->parent.name);
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"void %s__pack(%s *value, char *bytes)\n"
+			"{\n"
+			"%s",
+			value->parent.name, value->parent.name,
+			use_seg ? "    MtcSegment seg;\n\n" : "");
+		
+		mtc_var_list_code_for_pack(value->members, c_file);
+		
+		fprintf(c_file, "}\n\n");
+		
+		//Deserialization at fixed offsets
+		mtc_c_gen_fn_storage(h_file);
+		fprintf(h_file, 
+			"int %s__unpack(%s *value, const char *bytes);\n\n",
+			value->parent.name, value->parent.name);
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"int %s__unpack(%s *value, const char *bytes)\n"
+			"{\n"
+			"%s",
+			value->parent.name, value->parent.name,
+			use_seg ? "    MtcSegment seg;\n\n" : "");
+		
+		mtc_var_list_code_for_unpack(value->members, c_file);
+		
+		fprintf(c_file, "    return 0;\n}\n\n");
+		
+		//Allocation of a message of the right size
+		mtc_c_gen_fn_storage(h_file);
+		fprintf(h_file, 
+			"MtcMsg *%s__msg_new(char **bytes);\n\n",
+			value->parent.name);
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"MtcMsg *%s__msg_new(char **bytes)\n"
+			"{\n"
+			"    MtcMsg *msg;\n"
+			"    \n"
+			"    msg = mtc_msg_new(%s__WIRE_SIZE, 0);\n"
+			"    *bytes = (char *) msg->blocks[0].mem;\n"
+			"    \n"
+			"    return msg;\n"
+			"}\n\n",
+			value->parent.name, value->parent.name);
+	}
 	
 	if (! constsize)
 	{
 		//Structure is not of constant size, have to write functions
+		mtc_c_gen_fn_storage(h_file);
 		fprintf(h_file, 
 			"MtcDLen %s__count(%s *value);\n\n",
 			value->parent.name, value->parent.name);
+		mtc_c_gen_fn_storage(c_file);
 		fprintf(c_file, 
 			"MtcDLen %s__count(%s *value)\n"
 			"{\n"
-			"    MtcDLen size = {0, 0};\n\n",
+			"    MtcDLen size = {0, 0, 0};\n\n",
 			value->parent.name, value->parent.name);
 		
 		mtc_var_list_code_for_count(value->members, "value->", c_file);
@@ -921,41 +2794,89 @@ void mtc_struct_gen_code
 	}
 	
 	//Serialization function
+	mtc_c_gen_fn_storage(h_file);
 	fprintf(h_file, 
 		"void %s__write\n"
 		"    (%s *value, MtcSegment *seg, MtcDStream *dstream);\n\n",
 		value->parent.name, value->parent.name);
+	mtc_c_gen_fn_storage(c_file);
 	fprintf(c_file, 
 		"void %s__write\n"
 		"    (%s *value, MtcSegment *seg, MtcDStream *dstream)\n"
 		"{\n",
 		value->parent.name, value->parent.name);
 	
-	mtc_var_list_code_for_write(value->members, "value->", c_file);
+	if (flat)
+		fprintf(c_file, 
+			"    %s__pack(value, seg->bytes);\n"
+			"    seg->bytes += %s__WIRE_SIZE;\n",
+			value->parent.name, value->parent.name);
+	else
+		mtc_var_list_code_for_write(value->members, "value->", c_file);
 	
 	fprintf(c_file, "}\n\n");
 	
 	//Deserialization function
+	mtc_c_gen_fn_storage(h_file);
 	fprintf(h_file, 
 		"int %s__read\n"
 		"    (%s *value, MtcSegment *seg, MtcDStream *dstream);\n\n",
 		value->parent.name, value->parent.name);
+	mtc_c_gen_fn_storage(c_file);
 	fprintf(c_file, 
 		"int %s__read\n"
 		"    (%s *value, MtcSegment *seg, MtcDStream *dstream)\n"
 		"{\n",
 		value->parent.name, value->parent.name);
 	
-	mtc_var_list_code_for_read
-		(value->members, "value->", c_file);
-	fprintf(c_file, "\n    return 0;\n\n");
-	mtc_var_list_code_for_read_fail(value->members, "value->", c_file);
-	fprintf(c_file, "\n    return -1;\n}\n\n");
+	if (flat)
+	{
+		fprintf(c_file, 
+			"    if (%s__unpack(value, seg->bytes) < 0)\n"
+			"        return -1;\n"
+			"    seg->bytes += %s__WIRE_SIZE;\n"
+			"\n    return 0;\n}\n\n",
+			value->parent.name, value->parent.name);
+	}
+	else
+	{
+		mtc_var_list_code_for_read
+			(value->members, "value->", c_file);
+		fprintf(c_file, "\n    return 0;\n\n");
+		mtc_var_list_code_for_read_fail
+			(value->members, "value->", c_file);
+		fprintf(c_file, "\n    return -1;\n}\n\n");
+	}
+	
+	//Deserialization function reusing an old value
+	mtc_c_gen_fn_storage(h_file);
+	fprintf(h_file, 
+		"int %s__read_reuse\n"
+		"    (%s *value, MtcSegment *seg, MtcDStream *dstream);\n\n",
+		value->parent.name, value->parent.name);
+	mtc_c_gen_fn_storage(c_file);
+	fprintf(c_file, 
+		"int %s__read_reuse\n"
+		"    (%s *value, MtcSegment *seg, MtcDStream *dstream)\n"
+		"{\n",
+		value->parent.name, value->parent.name);
+	
+	//Flat structures have nothing to free
+	if (flat)
+		fprintf(c_file, 
+			"    return %s__read(value, seg, dstream);\n",
+			value->parent.name);
+	else
+		mtc_var_list_code_for_read_reuse
+			(value->members, value->parent.name, c_file);
+	fprintf(c_file, "}\n\n");
 	
 	//Function to free the structure
+	mtc_c_gen_fn_storage(h_file);
 	fprintf(h_file, 
 		"void %s__free(%s *value);\n\n",
 		value->parent.name, value->parent.name);
+	mtc_c_gen_fn_storage(c_file);
 	fprintf(c_file, 
 		"void %s__free(%s *value)\n"
 		"{\n",
@@ -966,16 +2887,106 @@ void mtc_struct_gen_code
 	fprintf(c_file, "}\n\n");
 	
 	//Function to serialize a structure into a message
+	mtc_c_gen_fn_storage(h_file);
 	fprintf(h_file, 
 		"MtcMsg *%s__serialize(%s *value);\n\n",
 		value->parent.name, value->parent.name);
+	if (flat)
+	{
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"MtcMsg *%s__serialize(%s *value)\n"
+			"{\n"
+			"    MtcMsg *msg;\n"
+			"    char *bytes;\n"
+			"    \n"
+			"    msg = %s__msg_new(&bytes);\n"
+			"    %s__pack(value, bytes);\n"
+			"    \n"
+			"    return msg;\n"
+			"}\n\n",
+			value->parent.name, value->parent.name, 
+			value->parent.name, value->parent.name);
+	}
+	else if (mtc_var_list_use_single_pass(value->members))
+	{
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"MtcMsg *%s__serialize(%s *value)\n"
+			"{\n"
+			"    MtcSegment seg;\n"
+			"    MtcDStream dstream;\n"
+			"    MtcDStreamChunks chunks;\n"
+			"    \n"
+			"    mtc_dstream_init_growable(&dstream, &chunks);\n"
+			"    mtc_dstream_get_segment(&dstream, %d, %d, &seg);\n"
+			"    \n"
+			"    %s__write(value, &seg, &dstream);\n"
+			"    \n"
+			"    return mtc_dstream_finish_growable(&dstream);\n"
+			"}\n\n",
+			value->parent.name, value->parent.name, 
+			(int) base_size.n_bytes, (int) base_size.n_blocks, 
+			value->parent.name);
+	}
+	else
+	{
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"MtcMsg *%s__serialize(%s *value)\n"
+			"{\n"
+			"    MtcSegment seg;\n"
+			"    MtcDStream dstream;\n"
+			"    MtcDLen dlen = {%d, %d, 0};\n"
+			"    MtcMsg *msg;\n"
+			"    \n",
+			value->parent.name, value->parent.name, 
+			(int) base_size.n_bytes, (int) base_size.n_blocks);
+		if (! constsize)
+		{
+			fprintf(c_file, 
+			"    //Size computation\n"
+			"    {\n"
+			"        MtcDLen dynamic;\n"
+			"        dynamic = %s__count(value);\n"
+			"        dlen.n_bytes += dynamic.n_bytes;\n"
+			"        dlen.n_blocks += dynamic.n_blocks;\n"
+			"        dlen.n_heap += dynamic.n_heap;\n"
+			"    }\n"
+			"    \n",
+			value->parent.name);
+		}
+		if (mtc_type_builder)
+			fprintf(c_file, 
+			"    msg = mtc_msg_new_with_heap(dlen, &dstream);\n");
+		else
+			fprintf(c_file, 
+			"    msg = mtc_msg_new(dlen.n_bytes, dlen.n_blocks);\n"
+			"    \n"
+			"    mtc_msg_iter(msg, &dstream);\n");
+		fprintf(c_file, 
+			"    mtc_dstream_get_segment(&dstream, %d, %d, &seg);\n"
+			"    \n"
+			"    %s__write(value, &seg, &dstream);\n"
+			"    \n"
+			"    return msg;\n"
+			"}\n\n",
+			(int) base_size.n_bytes, (int) base_size.n_blocks, 
+			value->parent.name);
+	}
+	
+	//Function to serialize a structure into an existing message
+	mtc_c_gen_fn_storage(h_file);
+	fprintf(h_file, 
+		"int %s__serialize_into(%s *value, MtcMsg *msg, MtcDLen *size);\n\n",
+		value->parent.name, value->parent.name);
+	mtc_c_gen_fn_storage(c_file);
 	fprintf(c_file, 
-		"MtcMsg *%s__serialize(%s *value)\n"
+		"int %s__serialize_into(%s *value, MtcMsg *msg, MtcDLen *size)\n"
 		"{\n"
 		"    MtcSegment seg;\n"
 		"    MtcDStream dstream;\n"
-		"    MtcDLen dlen = {%d, %d};\n"
-		"    MtcMsg *msg;\n"
+		"    MtcDLen dlen = {%d, %d, 0};\n"
 		"    \n",
 		value->parent.name, value->parent.name, 
 		(int) base_size.n_bytes, (int) base_size.n_blocks);
@@ -988,38 +2999,98 @@ void mtc_struct_gen_code
 		"        dynamic = %s__count(value);\n"
 		"        dlen.n_bytes += dynamic.n_bytes;\n"
 		"        dlen.n_blocks += dynamic.n_blocks;\n"
-		"    }\n"
-		"    \n",
-		value->parent.name);
+		"        dlen.n_heap += dynamic.n_heap;\n"
+		"    }\n",
+			value->parent.name);
+		if (! mtc_type_builder)
+			fprintf(c_file, 
+		"    dlen.n_heap = 0;\n");
+		fprintf(c_file, 
+		"    \n");
 	}
 	fprintf(c_file, 
-		"    msg = mtc_msg_new(dlen.n_bytes, dlen.n_blocks);\n"
-		"    \n"
-		"    mtc_msg_iter(msg, &dstream);\n"
+		"    if (size)\n"
+		"        *size = dlen;\n"
+		"    if (mtc_msg_reuse(msg, dlen, &dstream) < 0)\n"
+		"        return -1;\n"
 		"    mtc_dstream_get_segment(&dstream, %d, %d, &seg);\n"
 		"    \n"
 		"    %s__write(value, &seg, &dstream);\n"
 		"    \n"
-		"    return msg;\n"
+		"    return 0;\n"
 		"}\n\n",
 		(int) base_size.n_bytes, (int) base_size.n_blocks, 
 		value->parent.name);
 	
 	//Function to deserialize a message to get back structure
+	mtc_c_gen_fn_storage(h_file);
 	fprintf(h_file, 
 		"int %s__deserialize(MtcMsg *msg, %s *value);\n\n",
 		value->parent.name, value->parent.name);
+	if (flat)
+	{
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"int %s__deserialize(MtcMsg *msg, %s *value)\n"
+			"{\n"
+			"    if (msg->n_blocks != 1 \n"
+			"        || msg->blocks[0].size != %s__WIRE_SIZE)\n"
+			"        return -1;\n"
+			"    \n"
+			"    return %s__unpack(value, (char *) msg->blocks[0].mem);\n"
+			"}\n\n",
+			value->parent.name, value->parent.name,
+			value->parent.name, value->parent.name);
+	}
+	else
+	{
+		mtc_c_gen_fn_storage(c_file);
+		fprintf(c_file, 
+			"int %s__deserialize(MtcMsg *msg, %s *value)\n"
+			"{\n"
+			"    MtcSegment seg;\n"
+			"    MtcDStream dstream;\n"
+			"    \n"
+			"    mtc_msg_iter(msg, &dstream);\n"
+			"    if (mtc_dstream_get_segment(&dstream, %d, %d, &seg) < 0)\n"
+			"        goto _mtc_return;\n"
+			"    \n"
+			"    if (%s__read(value, &seg, &dstream) < 0)\n"
+			"        goto _mtc_return;\n"
+			"    \n"
+			"    if (! mtc_dstream_is_empty(&dstream))\n"
+			"        goto _mtc_destroy_n_return;\n"
+			"    \n"
+			"    return 0;\n"
+			"    \n"
+			"_mtc_destroy_n_return:\n"
+			"    %s__free(value);\n"
+			"_mtc_return:\n"
+			"    return -1;\n"
+			"}\n\n",
+			value->parent.name, value->parent.name,
+			(int) base_size.n_bytes, (int) base_size.n_blocks,
+			value->parent.name,
+			value->parent.name);
+	}
+	
+	//Function to deserialize a message into an old structure value
+	mtc_c_gen_fn_storage(h_file);
+	fprintf(h_file, 
+		"int %s__deserialize_reuse(MtcMsg *msg, %s *value);\n\n",
+		value->parent.name, value->parent.name);
+	mtc_c_gen_fn_storage(c_file);
 	fprintf(c_file, 
-		"int %s__deserialize(MtcMsg *msg, %s *value)\n"
+		"int %s__deserialize_reuse(MtcMsg *msg, %s *value)\n"
 		"{\n"
 		"    MtcSegment seg;\n"
 		"    MtcDStream dstream;\n"
 		"    \n"
 		"    mtc_msg_iter(msg, &dstream);\n"
 		"    if (mtc_dstream_get_segment(&dstream, %d, %d, &seg) < 0)\n"
-		"        goto _mtc_return;\n"
+		"        goto _mtc_destroy_n_return;\n"
 		"    \n"
-		"    if (%s__read(value, &seg, &dstream) < 0)\n"
+		"    if (%s__read_reuse(value, &seg, &dstream) < 0)\n"
 		"        goto _mtc_return;\n"
 		"    \n"
 		"    if (! mtc_dstream_is_empty(&dstream))\n"
@@ -1030,10 +3101,194 @@ void mtc_struct_gen_code
 		"_mtc_destroy_n_return:\n"
 		"    %s__free(value);\n"
 		"_mtc_return:\n"
+		"    memset(value, 0, sizeof(%s));\n"
 		"    return -1;\n"
 		"}\n\n",
 		value->parent.name, value->parent.name,
 		(int) base_size.n_bytes, (int) base_size.n_blocks,
 		value->parent.name,
-		value->parent.name);
+		value->parent.name, value->parent.name);
+	
+	//Read-only view of the structure
+	mtc_struct_gen_view_code(value, h_file, c_file);
+}
+
+//Writes the C++ accessor of a member for the view of given structure
+static void mtc_var_gen_cxx_view_get
+	(MtcSymbolVar *var, const char *name, FILE *output)
+{
+	MtcType type = var->type;
+	const char *m = var->parent.name;
+	int indexed = (type.complexity > 0 || type.complexity == MTC_TYPE_SEQ);
+	const char *param = indexed ? "uint32_t i" : "";
+	const char *arg = indexed ? ", i" : "";
+	
+	//Length and presence
+	if (type.complexity == MTC_TYPE_SEQ)
+		fprintf(output, 
+			"    uint32_t %s_len() const\n"
+			"    {\n"
+			"        return %s__view_len__%s(&view_);\n"
+			"    }\n"
+			"    \n",
+			m, name, m);
+	else if (type.complexity > 0)
+		fprintf(output, 
+			"    static constexpr uint32_t %s_len()\n"
+			"    {\n"
+			"        return %d;\n"
+			"    }\n"
+			"    \n",
+			m, type.complexity);
+	else if (type.complexity == MTC_TYPE_REF)
+		fprintf(output, 
+			"    bool has_%s() const\n"
+			"    {\n"
+			"        return %s__view_has__%s(&view_);\n"
+			"    }\n"
+			"    \n",
+			m, name, m);
+	
+	//All bytes at once
+	if (indexed && mtc_c_type_is_byte(type))
+	{
+		if (type.base.fid == MTC_TYPE_FUNDAMENTAL_CHAR)
+			fprintf(output, 
+			"    std::string_view %s() const\n"
+			"    {\n"
+			"        return std::string_view\n"
+			"            (%s__view_data__%s(&view_), %s_len());\n"
+			"    }\n"
+			"    \n",
+			m, name, m, m);
+		else
+			fprintf(output, 
+			"    std::span<const unsigned char> %s() const\n"
+			"    {\n"
+			"        return std::span<const unsigned char>\n"
+			"            (%s__view_data__%s(&view_), %s_len());\n"
+			"    }\n"
+			"    \n",
+			m, name, m, m);
+	}
+	
+	//The value
+	if (type.cat == MTC_TYPE_USERDEFINED)
+	{
+		fprintf(output, 
+			"    View< ::%s> %s(%s) const\n"
+			"    {\n"
+			"        ::%s__view res;\n"
+			"        \n"
+			"        %s__view_get__%s(&view_%s, &res);\n"
+			"        return View< ::%s>(msg_.ref(), res);\n"
+			"    }\n",
+			type.base.symbol->name, m, param,
+			type.base.symbol->name,
+			name, m, arg,
+			type.base.symbol->name);
+	}
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+	{
+		fprintf(output, 
+			"    std::string_view %s(%s) const\n"
+			"    {\n"
+			"        size_t len;\n"
+			"        const char *str = %s__view_get__%s(&view_%s, &len);\n"
+			"        \n"
+			"        return std::string_view(str, len);\n"
+			"    }\n",
+			m, param, name, m, arg);
+	}
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_RAW)
+	{
+		fprintf(output, 
+			"    std::span<const unsigned char> %s(%s) const\n"
+			"    {\n"
+			"        MtcMBlock res = %s__view_get__%s(&view_%s);\n"
+			"        \n"
+			"        return std::span<const unsigned char>\n"
+			"            ((const unsigned char *) res.mem, res.size);\n"
+			"    }\n",
+			m, param, name, m, arg);
+	}
+	else if (type.base.fid == MTC_TYPE_FUNDAMENTAL_MSG)
+	{
+		fprintf(output, 
+			"    Msg %s(%s) const\n"
+			"    {\n"
+			"        return Msg(%s__view_get__%s(&view_%s));\n"
+			"    }\n",
+			m, param, name, m, arg);
+	}
+	else
+	{
+		fprintf(output, "    ");
+		mtc_gen_base_type(type, output);
+		fprintf(output, 
+			" %s(%s) const\n"
+			"    {\n"
+			"        return %s__view_get__%s(&view_%s);\n"
+			"    }\n",
+			m, param, name, m, arg);
+	}
+}
+
+//Writes C++ code for given structure
+void mtc_struct_gen_cxx(MtcSymbolStruct *value, FILE *output)
+{
+	MtcSymbolVar *iter;
+	const char *name = value->parent.name;
+	
+	fprintf(output, 
+		"//%s\n"
+		"namespace mtc\n"
+		"{\n"
+		"\n"
+		"template <>\n"
+		"struct Traits< ::%s>\n"
+		"{\n"
+		"    typedef ::%s__view CView;\n"
+		"    \n"
+		"    static MtcMsg *serialize(::%s *value)\n"
+		"    {\n"
+		"        return %s__serialize(value);\n"
+		"    }\n"
+		"    \n"
+		"    static int deserialize_reuse(MtcMsg *msg, ::%s *value)\n"
+		"    {\n"
+		"        return %s__deserialize_reuse(msg, value);\n"
+		"    }\n"
+		"    \n"
+		"    static void free(::%s *value)\n"
+		"    {\n"
+		"        %s__free(value);\n"
+		"    }\n"
+		"    \n"
+		"    static int view_init(MtcMsg *msg, CView *view)\n"
+		"    {\n"
+		"        return %s__view_init(msg, view);\n"
+		"    }\n"
+		"};\n"
+		"\n"
+		"template <>\n"
+		"class View< ::%s> : public ViewBase< ::%s>\n"
+		"{\n"
+		"public:\n"
+		"    using ViewBase< ::%s>::ViewBase;\n",
+		name, name, name, name, name, name, name, name, name, name, 
+		name, name, name);
+	
+	for (iter = value->members; iter; 
+		iter = (MtcSymbolVar *) iter->parent.next)
+	{
+		fprintf(output, "    \n");
+		mtc_var_gen_cxx_view_get(iter, name, output);
+	}
+	
+	fprintf(output, 
+		"};\n"
+		"\n"
+		"} //namespace mtc\n"
+		"\n");
 }
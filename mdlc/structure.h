@@ -18,6 +18,31 @@
  * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+//Whether generated serializers reference strings instead of 
+//copying them. Strings must then be in reference counted memory.
+extern int mtc_c_borrow_strings;
+
+//When generated serializers write messages in a single pass into
+//growable storage instead of counting their size first
+typedef enum
+{
+	//Only for types where counting walks each element of sequences
+	//or arrays, and only when strings and raw values are inlined
+	MTC_C_SINGLE_PASS_AUTO,
+	MTC_C_SINGLE_PASS_ALWAYS,
+	MTC_C_SINGLE_PASS_NEVER
+} MtcCSinglePass;
+
+extern MtcCSinglePass mtc_c_single_pass;
+
+//Whether functions for structures are written as static inline 
+//functions into the header with declarations, so that compilers can 
+//inline them into callers in every translation unit
+extern int mtc_c_static_inline;
+
+//Tells whether a list of variables is serialized in a single pass
+int mtc_var_list_use_single_pass(MtcSymbolVar *list);
+
 //Writes C base type for the type, ignoring complexity
 void mtc_gen_base_type(MtcType type, FILE *output);
 
@@ -41,10 +66,23 @@ void mtc_var_list_code_for_read
 void mtc_var_list_code_for_read_fail
 	(MtcSymbolVar *list, const char *prefix, FILE *c_file);
 
+//Writes code to deserialize a given list of variables into their 
+//old values, with error handling
+void mtc_var_list_code_for_read_reuse
+	(MtcSymbolVar *list, const char *name, FILE *c_file);
+
 //Writes code to free a given list of variables
 void mtc_var_list_code_for_free
 	(MtcSymbolVar *list, const char *prefix, FILE *c_file);
 	
+//Writes C code for given enumeration
+void mtc_enum_gen_code
+	(MtcSymbolEnum *value, FILE *h_file, FILE *c_file);
+
 //Writes C code for given structure
 void mtc_struct_gen_code
 	(MtcSymbolStruct *value, FILE *h_file, FILE *c_file);
+
+//Writes C++ code for given structure: specializations of mtc::Traits 
+//and mtc::View from <mtc0/mtc.hpp>
+void mtc_struct_gen_cxx(MtcSymbolStruct *value, FILE *output);
@@ -25,6 +25,18 @@
 
 #undef MTC_SYMBOL_C
 
+//Returns hash of a name, used to index symbols and macros (FNV-1a)
+uint32_t mtc_name_hash(const char *name)
+{
+	const unsigned char *iter;
+	uint32_t res = 2166136261u;
+	
+	for (iter = (const unsigned char *) name; *iter; iter++)
+		res = (res ^ *iter) * 16777619u;
+	
+	return res;
+}
+
 //Creates a new symbol
 static MtcSymbol *mtc_symbol_new
 	(size_t len, const char *name, const MtcSourcePtr *location)
@@ -35,6 +47,8 @@ static MtcSymbol *mtc_symbol_new
 	res->location = mtc_source_ptr_copy(location);
 	res->next = NULL;
 	res->reflevel = 0;
+	res->hash = mtc_name_hash(name);
+	res->hash_next = NULL;
 	
 	return res;
 }
@@ -77,13 +91,91 @@ MtcSymbol *mtc_symbol_list_find(MtcSymbol *list, const char *name)
 	return iter;
 }
 
+//Hash tables of symbols
+
+//Adds a symbol to the end of its bucket, so that of symbols with 
+//the same name the first one added is found
+static void mtc_symbol_table_link(MtcSymbolTable *self, MtcSymbol *symbol)
+{
+	MtcSymbol **pos;
+	
+	symbol->hash_next = NULL;
+	pos = self->buckets + (symbol->hash & (self->n_buckets - 1));
+	while (*pos)
+		pos = &((*pos)->hash_next);
+	*pos = symbol;
+}
+
+//Adds a symbol to the table, growing it when there are more 
+//symbols than buckets
+static void mtc_symbol_table_add(MtcSymbolTable *self, MtcSymbol *symbol)
+{
+	if (self->n_symbols >= self->n_buckets)
+	{
+		MtcSymbol **old = self->buckets;
+		uint32_t n_old = self->n_buckets, i;
+		MtcSymbol *iter, *next;
+		
+		self->n_buckets = n_old ? n_old * 2 : 16;
+		self->buckets = (MtcSymbol **) mtc_alloc
+			(sizeof(MtcSymbol *) * self->n_buckets);
+		memset(self->buckets, 0, sizeof(MtcSymbol *) * self->n_buckets);
+		
+		for (i = 0; i < n_old; i++)
+		{
+			for (iter = old[i]; iter; iter = next)
+			{
+				next = iter->hash_next;
+				mtc_symbol_table_link(self, iter);
+			}
+		}
+		
+		if (old)
+			mtc_free(old);
+	}
+	
+	mtc_symbol_table_link(self, symbol);
+	self->n_symbols++;
+}
+
+//Searches for a symbol in the table
+static MtcSymbol *mtc_symbol_table_find
+	(MtcSymbolTable *self, const char *name)
+{
+	MtcSymbol *iter;
+	uint32_t hash;
+	
+	if (! self->n_symbols)
+		return NULL;
+	
+	hash = mtc_name_hash(name);
+	for (iter = self->buckets[hash & (self->n_buckets - 1)]; iter; 
+		iter = iter->hash_next)
+	{
+		if (iter->hash == hash && strcmp(iter->name, name) == 0)
+			break;
+	}
+	
+	return iter;
+}
+
+//Frees the buckets and empties the table
+static void mtc_symbol_table_clear(MtcSymbolTable *self)
+{
+	if (self->buckets)
+		mtc_free(self->buckets);
+	self->buckets = NULL;
+	self->n_buckets = self->n_symbols = 0;
+}
+
 //Creates a new symbol database
 MtcSymbolDB *mtc_symbol_db_new()
 {
 	MtcSymbolDB *self = (MtcSymbolDB *) mtc_alloc(sizeof(MtcSymbolDB));
+	MtcSymbolDB init = MTC_SYMBOL_DB_INIT;
 	
+	*self = init;
 	self->dynamic = 1;
-	self->head = self->tail = NULL;
 	
 	return self;
 }
@@ -92,11 +184,30 @@ MtcSymbolDB *mtc_symbol_db_new()
 void mtc_symbol_db_free(MtcSymbolDB *self)
 {
 	mtc_symbol_list_free(self->head);
+	mtc_symbol_table_clear(&(self->symbols));
+	mtc_symbol_table_clear(&(self->enum_values));
 	
 	if (self->dynamic)
 		mtc_free(self);
 }
 
+//Adds a symbol and values of enumerations to the hash tables
+static void mtc_symbol_db_index(MtcSymbolDB *self, MtcSymbol *symbol)
+{
+	mtc_symbol_table_add(&(self->symbols), symbol);
+	
+	if (symbol->gc == mtc_symbol_enum_gc)
+	{
+		MtcSymbol *iter;
+		
+		for (iter = ((MtcSymbolEnum *) symbol)->values; iter; 
+			iter = iter->next)
+		{
+			mtc_symbol_table_add(&(self->enum_values), iter);
+		}
+	}
+}
+
 //Appends a symbol to the database
 void mtc_symbol_db_append(MtcSymbolDB *self, MtcSymbol *symbol)
 {
@@ -106,18 +217,56 @@ void mtc_symbol_db_append(MtcSymbolDB *self, MtcSymbol *symbol)
 		self->head = symbol;
 	symbol->next = NULL;
 	self->tail = symbol;
+	
+	mtc_symbol_db_index(self, symbol);
 }
 
 //Concatenates db1 and db2 to db1. db2 is destroyed.
 void mtc_symbol_db_cat(MtcSymbolDB *db1, MtcSymbolDB *db2)
 {
+	MtcSymbol *iter;
+	
+	for (iter = db2->head; iter; iter = iter->next)
+		mtc_symbol_db_index(db1, iter);
+	
 	if (db1->tail)
 		db1->tail->next = db2->head;
-	db1->tail = db2->tail;
+	else
+		db1->head = db2->head;
+	if (db2->tail)
+		db1->tail = db2->tail;
+	
+	mtc_symbol_table_clear(&(db2->symbols));
+	mtc_symbol_table_clear(&(db2->enum_values));
 	if (db2->dynamic)
 		mtc_free(db2);
 }
 
+//Searches for a symbol in the database
+MtcSymbol *mtc_symbol_db_find(MtcSymbolDB *self, const char *name)
+{
+	return mtc_symbol_table_find(&(self->symbols), name);
+}
+
+//Searches for a value of any enumeration in the database
+MtcSymbol *mtc_symbol_db_find_enum_value
+	(MtcSymbolDB *self, const char *name)
+{
+	return mtc_symbol_table_find(&(self->enum_values), name);
+}
+
+//Returns the list of symbols in the database and empties it
+MtcSymbol *mtc_symbol_db_steal(MtcSymbolDB *self)
+{
+	MtcSymbol *res = self->head;
+	
+	self->head = self->tail = NULL;
+	mtc_symbol_table_clear(&(self->symbols));
+	mtc_symbol_table_clear(&(self->enum_values));
+	
+	return res;
+}
+
 //Dump contents of a symbol
 void mtc_symbol_dump(MtcSymbol *self, int depth, FILE *stream)
 {
@@ -167,7 +316,11 @@ void mtc_type_dump(MtcType type, FILE *stream)
 		fprintf(stream, "ref ");
 	}
 	
-	if (type.cat == MTC_TYPE_FUNDAMENTAL)
+	if (type.enum_symbol)
+	{
+		fprintf(stream, "%s", type.enum_symbol->name);
+	}
+	else if (type.cat == MTC_TYPE_FUNDAMENTAL)
 	{
 		fprintf(stream, "%s", 
 			mtc_type_fundamental_names[type.base.fid]);
@@ -178,11 +331,46 @@ void mtc_type_dump(MtcType type, FILE *stream)
 	}
 }
 
+size_t mtc_type_inline_threshold = 0;
+int mtc_type_builder = 0;
+
+//Tells whether the fundamental type is stored using inline encoding
+int mtc_type_fundamental_is_inline(MtcTypeFundamentalID fid)
+{
+	if (! mtc_type_inline_threshold)
+		return 0;
+	
+	return (fid == MTC_TYPE_FUNDAMENTAL_STRING 
+		|| fid == MTC_TYPE_FUNDAMENTAL_RAW);
+}
+
+//Tells whether the fundamental type is a variable length integer
+int mtc_type_fundamental_is_varint(MtcTypeFundamentalID fid)
+{
+	return (fid == MTC_TYPE_FUNDAMENTAL_VARUINT32
+		|| fid == MTC_TYPE_FUNDAMENTAL_VARUINT64
+		|| fid == MTC_TYPE_FUNDAMENTAL_VARINT32
+		|| fid == MTC_TYPE_FUNDAMENTAL_VARINT64);
+}
+
 //Calculates base size of a base type
 MtcDLen mtc_base_type_calc_base_size(MtcType type)
 {
 	if (type.cat == MTC_TYPE_FUNDAMENTAL)
 	{
+		if (mtc_type_fundamental_is_inline(type.base.fid))
+		{
+			MtcDLen header = {4, 0, 0};
+			return header;
+		}
+		
+		//Bools packed into the byte of a previous variable
+		if (type.bit)
+		{
+			MtcDLen packed = {0, 0, 0};
+			return packed;
+		}
+		
 		return  mtc_type_fundamental_sizes[type.base.fid];
 	}
 	else
@@ -199,6 +387,11 @@ int mtc_base_type_is_constsize(MtcType type)
 		return ((MtcSymbolStruct *) type.base.symbol)->constsize;
 	}
 	
+	if (mtc_type_fundamental_is_inline(type.base.fid))
+		return 0;
+	if (mtc_type_builder && type.base.fid == MTC_TYPE_FUNDAMENTAL_STRING)
+		return 0;
+	
 	return mtc_type_fundamental_constsize[type.base.fid];
 }
 
@@ -224,8 +417,14 @@ MtcDLen mtc_type_calc_base_size(MtcType type)
 		//Get base size of base type
 		res = mtc_base_type_calc_base_size(type);
 		
+		//Array of bools: packed as a bitset
+		if (type.complexity > 0 && type.cat == MTC_TYPE_FUNDAMENTAL
+			&& type.base.fid == MTC_TYPE_FUNDAMENTAL_BOOL)
+		{
+			res.n_bytes = (type.complexity + 7) / 8;
+		}
 		//Array: multiply it with its length
-		if (type.complexity > 0)
+		else if (type.complexity > 0)
 		{
 			res.n_bytes *= type.complexity;
 			res.n_blocks *= type.complexity;
@@ -263,6 +462,28 @@ static void mtc_symbol_var_dump(MtcSymbol *symbol, int depth, FILE *stream)
 	fprintf(stream, "')");
 }
 
+//Packs runs of adjacent bool variables 8 to a byte
+static void mtc_symbol_var_list_pack_bools(MtcSymbolVar *list)
+{
+	MtcSymbolVar *iter;
+	int bit = 0;
+	
+	for (iter = list; iter; iter = (MtcSymbolVar *) (iter->parent.next))
+	{
+		if (iter->type.cat == MTC_TYPE_FUNDAMENTAL
+			&& iter->type.base.fid == MTC_TYPE_FUNDAMENTAL_BOOL
+			&& iter->type.complexity == MTC_TYPE_NORMAL)
+		{
+			iter->type.bit = bit;
+			bit = (bit + 1) % 8;
+		}
+		else
+		{
+			bit = 0;
+		}
+	}
+}
+
 //Returns new variable
 MtcSymbolVar *mtc_symbol_var_new
 	(const char *name, const MtcSourcePtr *location, MtcType type)
@@ -318,7 +539,7 @@ MtcSymbolFunc *mtc_symbol_func_new
 	MtcSymbol *symbol;
 	MtcSymbolFunc *func;
 	MtcSymbolVar *iter;
-	MtcDLen in_base_size = {0, 0}, out_base_size = {0, 0}, onesize;
+	MtcDLen in_base_size = {0, 0, 0}, out_base_size = {0, 0, 0}, onesize;
 	
 	symbol = mtc_symbol_new(sizeof(MtcSymbolFunc), name, location);
 	
@@ -329,6 +550,9 @@ MtcSymbolFunc *mtc_symbol_func_new
 	func->in_args = in_args;
 	func->out_args = out_args;
 	
+	mtc_symbol_var_list_pack_bools(in_args);
+	mtc_symbol_var_list_pack_bools(out_args);
+	
 	for (iter = in_args; iter; 
 		iter = (MtcSymbolVar *) (iter->parent.next))
 	{
@@ -381,7 +605,7 @@ MtcSymbolStruct *mtc_symbol_struct_new
 	MtcSymbol *symbol;
 	MtcSymbolStruct *struct_v;
 	MtcSymbolVar *iter;
-	MtcDLen base_size = {0, 0}, onesize;
+	MtcDLen base_size = {0, 0, 0}, onesize;
 	int constsize = 1;
 	
 	symbol = mtc_symbol_new(sizeof(MtcSymbolStruct), name, location);
@@ -392,6 +616,8 @@ MtcSymbolStruct *mtc_symbol_struct_new
 	struct_v = (MtcSymbolStruct *) symbol;
 	struct_v->members = members;
 	
+	mtc_symbol_var_list_pack_bools(members);
+	
 	for (iter = members; iter; 
 		iter = (MtcSymbolVar *) (iter->parent.next))
 	{
@@ -409,6 +635,88 @@ MtcSymbolStruct *mtc_symbol_struct_new
 	return struct_v;
 }
 
+//Enumeration value's garbage collector
+static void mtc_symbol_enum_value_gc(MtcSymbol *symbol)
+{
+	
+}
+
+//Dumps contents of an enumeration value
+static void mtc_symbol_enum_value_dump
+	(MtcSymbol *symbol, int depth, FILE *stream)
+{
+	fprintf(stream, "EnumValue()");
+}
+
+//Creates a new enumeration value
+MtcSymbol *mtc_symbol_enum_value_new
+	(const char *name, const MtcSourcePtr *location)
+{
+	MtcSymbol *symbol;
+	
+	symbol = mtc_symbol_new(sizeof(MtcSymbol), name, location);
+	
+	symbol->gc = mtc_symbol_enum_value_gc;
+	symbol->dump_func = mtc_symbol_enum_value_dump;
+	
+	return symbol;
+}
+
+//enum's garbage collector
+void mtc_symbol_enum_gc(MtcSymbol *symbol)
+{
+	MtcSymbolEnum *enum_v = (MtcSymbolEnum *) symbol;
+	
+	mtc_symbol_list_free(enum_v->values);
+}
+
+//Dumps contents of an enumeration
+static void mtc_symbol_enum_dump(MtcSymbol *symbol, int depth, FILE *stream)
+{
+	MtcSymbolEnum *enum_v = (MtcSymbolEnum *) symbol;
+	MtcSymbol *iter;
+	int i;
+	
+	fprintf(stream, "Enum(type = '%s', values = {\n", 
+		mtc_type_fundamental_names[enum_v->fid]);
+	for (iter = enum_v->values; iter; iter = iter->next)
+		mtc_symbol_dump(iter, depth + 1, stream);
+	for (i = 0; i < depth; i++)
+		fprintf(stream, "\t");
+	fprintf(stream, "})");
+}
+
+//Returns a new enumeration.
+MtcSymbolEnum *mtc_symbol_enum_new
+	(const char *name, const MtcSourcePtr *location, MtcSymbol *values)
+{
+	MtcSymbol *symbol, *iter;
+	MtcSymbolEnum *enum_v;
+	uint32_t n_values = 0;
+	
+	symbol = mtc_symbol_new(sizeof(MtcSymbolEnum), name, location);
+	
+	symbol->gc = mtc_symbol_enum_gc;
+	symbol->dump_func = mtc_symbol_enum_dump;
+	
+	enum_v = (MtcSymbolEnum *) symbol;
+	enum_v->values = values;
+	
+	for (iter = values; iter; iter = iter->next)
+		n_values++;
+	enum_v->n_values = n_values;
+	
+	//Smallest unsigned integer holding all values
+	if (n_values <= 0x100)
+		enum_v->fid = MTC_TYPE_FUNDAMENTAL_UCHAR;
+	else if (n_values <= 0x10000)
+		enum_v->fid = MTC_TYPE_FUNDAMENTAL_UINT16;
+	else
+		enum_v->fid = MTC_TYPE_FUNDAMENTAL_UINT32;
+	
+	return enum_v;
+}
+
 //class' garbage collector 
 void mtc_symbol_class_gc(MtcSymbol *symbol)
 {
@@ -31,10 +31,18 @@ struct _MtcSymbol
 	MtcSourcePtr *location;
 	int reflevel;
 	
+	//Hash of the name, and the next symbol in the same bucket 
+	//of the hash table of a symbol database
+	uint32_t hash;
+	MtcSymbol *hash_next;
+	
 	MtcSymbolGC gc;
 	MtcSymbolDumpFunc dump_func;
 };
 
+//Returns hash of a name, used to index symbols and macros
+uint32_t mtc_name_hash(const char *name);
+
 //Frees a symbol
 void mtc_symbol_free(MtcSymbol *symbol);
 
@@ -44,14 +52,24 @@ void mtc_symbol_list_free(MtcSymbol *symbols);
 //Searches for a symbol
 MtcSymbol *mtc_symbol_list_find(MtcSymbol *list, const char *name);
 
+//Hash table of symbols by name, chained through hash_next
+typedef struct
+{
+	MtcSymbol **buckets;
+	uint32_t n_buckets, n_symbols;
+} MtcSymbolTable;
+
 //Symbol database
 typedef struct 
 {
 	int dynamic;
 	MtcSymbol *head, *tail;
+	
+	//All symbols, and values of all enumerations in the database
+	MtcSymbolTable symbols, enum_values;
 } MtcSymbolDB;
 
-#define MTC_SYMBOL_DB_INIT {0, NULL, NULL}
+#define MTC_SYMBOL_DB_INIT {0, NULL, NULL, {NULL, 0, 0}, {NULL, 0, 0}}
 
 //Creates a new symbol database
 MtcSymbolDB *mtc_symbol_db_new();
@@ -65,6 +83,17 @@ void mtc_symbol_db_append(MtcSymbolDB *self, MtcSymbol *symbol);
 //Concatenates db1 and db2 to db1. db2 is destroyed.
 void mtc_symbol_db_cat(MtcSymbolDB *db1, MtcSymbolDB *db2);
 
+//Searches for a symbol in the database
+MtcSymbol *mtc_symbol_db_find(MtcSymbolDB *self, const char *name);
+
+//Searches for a value of any enumeration in the database
+MtcSymbol *mtc_symbol_db_find_enum_value
+	(MtcSymbolDB *self, const char *name);
+
+//Returns the list of symbols in the database and empties it, 
+//so that the symbols can be given to another symbol
+MtcSymbol *mtc_symbol_db_steal(MtcSymbolDB *self);
+
 //Dump contents of a symbol
 void mtc_symbol_dump(MtcSymbol *self, int depth, FILE *stream);
 
@@ -101,8 +130,13 @@ typedef enum
 	MTC_TYPE_FUNDAMENTAL_STRING = 10,
 	MTC_TYPE_FUNDAMENTAL_RAW = 11,
 	MTC_TYPE_FUNDAMENTAL_MSG = 12,
+	MTC_TYPE_FUNDAMENTAL_VARUINT32 = 13,
+	MTC_TYPE_FUNDAMENTAL_VARUINT64 = 14,
+	MTC_TYPE_FUNDAMENTAL_VARINT32 = 15,
+	MTC_TYPE_FUNDAMENTAL_VARINT64 = 16,
+	MTC_TYPE_FUNDAMENTAL_BOOL = 17,
 	
-	MTC_TYPE_FUNDAMENTAL_N = 13
+	MTC_TYPE_FUNDAMENTAL_N = 18
 } MtcTypeFundamentalID;
 
 #ifdef MTC_SYMBOL_C
@@ -121,24 +155,34 @@ const char *mtc_type_fundamental_names[] =
 	"string",
 	"raw",
 	"msg",
+	"varuint32",
+	"varuint64",
+	"varint32",
+	"varint64",
+	"bool",
 	NULL
 };
 
 const MtcDLen mtc_type_fundamental_sizes[] =
 {
-	{1, 0},
-	{2, 0},
-	{4, 0},
-	{8, 0},
-	{1, 0},
-	{2, 0},
-	{4, 0},
-	{8, 0},
-	{4, 0},
-	{8, 0},
-	{0, 1},
-	{0, 1},
-	{4, 0}
+	{1, 0, 0},
+	{2, 0, 0},
+	{4, 0, 0},
+	{8, 0, 0},
+	{1, 0, 0},
+	{2, 0, 0},
+	{4, 0, 0},
+	{8, 0, 0},
+	{4, 0, 0},
+	{8, 0, 0},
+	{0, 1, 0},
+	{0, 1, 0},
+	{4, 0, 0},
+	{0, 0, 0},
+	{0, 0, 0},
+	{0, 0, 0},
+	{0, 0, 0},
+	{1, 0, 0}
 };
 
 const int mtc_type_fundamental_constsize[] = 
@@ -155,7 +199,12 @@ const int mtc_type_fundamental_constsize[] =
 	1,
 	1,
 	1,
-	0
+	0,
+	0,
+	0,
+	0,
+	0,
+	1
 };
 
 #else 
@@ -164,6 +213,22 @@ extern const MtcDLen mtc_type_fundamental_sizes[];
 extern const int mtc_type_fundamental_constsize[];
 #endif
 
+//Strings and raw values upto this size are stored inline in the
+//byte stream. 0 disables inlining and keeps the original wire format.
+extern size_t mtc_type_inline_threshold;
+
+//Whether generated serializers copy strings into the message heap,
+//which requires strings to be counted
+extern int mtc_type_builder;
+
+//Tells whether the fundamental type is string or raw and is stored 
+//using inline encoding
+int mtc_type_fundamental_is_inline(MtcTypeFundamentalID fid);
+
+//Tells whether the fundamental type is a variable length integer, 
+//stored entirely in the dynamic part of the byte stream
+int mtc_type_fundamental_is_varint(MtcTypeFundamentalID fid);
+
 
 typedef struct 
 {
@@ -174,6 +239,16 @@ typedef struct
 		MtcTypeFundamentalID fid;
 		MtcSymbol *symbol;
 	} base;
+	
+	//Enumerations are fundamental types, stored as the smallest 
+	//unsigned integer type holding all values. This is the 
+	//enumeration then, NULL otherwise.
+	MtcSymbol *enum_symbol;
+	
+	//Adjacent bool variables are packed 8 to a byte. This is the 
+	//position of the value in its byte; the variable at position 0 
+	//takes the byte in the base size. 0 for other types.
+	int bit;
 } MtcType;
 
 MtcDLen mtc_type_calc_base_size(MtcType type);
@@ -234,6 +309,29 @@ MtcSymbolStruct *mtc_symbol_struct_new
 
 void mtc_symbol_struct_gc(MtcSymbol *symbol);
 
+//Enumeration
+typedef struct
+{
+	MtcSymbol parent;
+	
+	//List of values, numbered from 0 in order
+	MtcSymbol *values;
+	uint32_t n_values;
+	
+	//Fundamental type used to store values
+	MtcTypeFundamentalID fid;
+} MtcSymbolEnum;
+
+//Creates a new enumeration value
+MtcSymbol *mtc_symbol_enum_value_new
+	(const char *name, const MtcSourcePtr *location);
+
+//Creates a new enumeration
+MtcSymbolEnum *mtc_symbol_enum_new
+	(const char *name, const MtcSourcePtr *location, MtcSymbol *values);
+
+void mtc_symbol_enum_gc(MtcSymbol *symbol);
+
 //Class
 typedef struct _MtcSymbolClass MtcSymbolClass;
 struct _MtcSymbolClass
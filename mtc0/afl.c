@@ -34,7 +34,7 @@ static void expand_table(MtcAfl *self)
 	//Double the size of the table
 	new_alloc_len = self->alloc_len * 2;
 	self->table = (MtcAflItem **) 
-		mtc_realloc(self->table, (new_alloc_len + 1) * sizeof(void *));
+		mtc_realloc_cat(self->table, (new_alloc_len + 1) * sizeof(void *));
 	for (i = self->alloc_len; i <= new_alloc_len; i++)
 		self->table[i] = NULL;
 	
@@ -105,7 +105,7 @@ static void collapse_table(MtcAfl *self)
 	}
 	
 	//Collapse the table
-	new_table = (MtcAflItem **) mtc_realloc
+	new_table = (MtcAflItem **) mtc_realloc_cat
 		(self->table, sizeof(void *) * (new_alloc_len + 1));
 	
 	//Regenerate the free list
@@ -132,7 +132,8 @@ void mtc_afl_init(MtcAfl *self)
 	int32_t i;
 	
 	//Allocate initial memory
-	self->table = (MtcAflItem **) mtc_alloc(sizeof(void *) * (MTC_AFL_INIT_SIZE + 1));
+	self->table = (MtcAflItem **) mtc_alloc_cat
+		(sizeof(void *) * (MTC_AFL_INIT_SIZE + 1), MTC_ALLOC_CAT_DEST);
 	self->alloc_len = MTC_AFL_INIT_SIZE;
 	self->n_elements = 0;
 	
@@ -318,7 +319,7 @@ void mtc_afl_get_items(MtcAfl *self, MtcAflItem **items)
 void mtc_afl_destroy(MtcAfl *self)
 {	
 	//Free the array
-	mtc_free(self->table);
+	mtc_free_cat(self->table);
 }
 
 /* Dumps the internals of the data structure for debugging the library.
@@ -23,9 +23,9 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 #ifndef _MTC_PUBLIC
-#include <string.h>
 #include <error.h>
 #include <assert.h>
 
@@ -36,6 +36,7 @@
 #include <mtc0/generated.h>
 
 #include "utils.h"
+#include "mmpool.h"
 #include "types.h"
 #include "serialize.h"
 #include "message.h"
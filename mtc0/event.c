@@ -69,13 +69,12 @@ void mtc_event_test_pollfd_init
 
 void mtc_event_mgr_ref(MtcEventMgr *mgr)
 {
-	mgr->refcount++;
+	mtc_refcount_inc(&(mgr->refcount));
 }
 
 void mtc_event_mgr_unref(MtcEventMgr *mgr)
 {
-	mgr->refcount--;
-	if (mgr->refcount <= 0)
+	if (mtc_refcount_dec_and_test(&(mgr->refcount)))
 	{
 		(* mgr->vtable->destroy)(mgr);
 	}
@@ -30,16 +30,19 @@
 	
 	#For each type in uint16_t, uint32_t, uint64_t ...
 	{
-		echo "2 16 01        $uint16_endian"
-		echo "4 32 0123      $uint32_endian"
-		echo "8 64 01234567  $uint64_endian"
-	} | while read size_bytes size_bits le_fmt endian
+		echo "2 16 01        10        $uint16_endian"
+		echo "4 32 0123      3210      $uint32_endian"
+		echo "8 64 01234567  76543210  $uint64_endian"
+	} | while read size_bytes size_bits le_fmt be_fmt endian
 	do
 		echo "/*uint${size_bits}_t endianness*/"
 		
 		if test "$endian" = "$le_fmt"; then
 			echo "#define MTC_UINT${size_bits}_LITTLE_ENDIAN 1"
 		fi
+		if test "$endian" = "$be_fmt"; then
+			echo "#define MTC_UINT${size_bits}_BIG_ENDIAN 1"
+		fi
 		
 		for i in `seq 0 $(($size_bytes - 1))`; do
 			def="MTC_UINT${size_bits}_BYTE_${i}_SIGNIFICANCE"
@@ -55,6 +58,24 @@
 	fi
 	echo
 	
+	echo "/*IEEE 754 floating point numbers*/"
+	if test "$flt_ieee754" = "yes"; then
+		echo "#define MTC_FLT_IEEE754 1"
+	fi
+	echo
+	
+	echo "/*Byte swapping builtins*/"
+	if test "$builtin_bswap" = "yes"; then
+		echo "#define MTC_HAVE_BUILTIN_BSWAP 1"
+	fi
+	echo
+	
+	echo "/*Atomic reference counts*/"
+	if test "$atomic_refcount" = "yes"; then
+		echo "#define MTC_ATOMIC_REFCOUNT 1"
+	fi
+	echo
+	
 	#Generate signature, a little endian compile time constant
 	sig_byte0="4d"
 	sig_byte1="54"
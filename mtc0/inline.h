@@ -0,0 +1,413 @@
+/* inline.h
+ * Inline versions of functions used by serializers
+ *
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ *
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \addtogroup mtc_serialize
+ * \{
+ *
+ * <mtc0/inline.h> is not included by <mtc0/mtc.h>. Including it
+ * replaces reference counting of memory and the segment and
+ * 'dual stream' functions used by serializers with static inline
+ * versions of them, so that compilers can inline serialization of
+ * a whole message into the caller. The functions in the library
+ * are still there and behave the same.
+ *
+ * Serializers generated by mdlc --static-inline include this header.
+ */
+
+#ifndef MTC_INLINE_H_INCLUDED
+#define MTC_INLINE_H_INCLUDED
+
+#ifndef MTC_PRIVATE
+#include <mtc0/mtc.h>
+#endif
+
+//Header placed before accounted and reference counted memory
+typedef struct
+{
+	int refcount;
+	//Packed into one word so that the header stays small
+	unsigned int category : 3;
+	//Whether the memory is from the mapping pool
+	unsigned int mapped : 1;
+	//Accounting epoch the memory was counted in, 0 if it was not
+	unsigned int counted : 28;
+	size_t size;
+} MtcRCMemMembers;
+
+typedef union
+{
+	MtcRCMemMembers s;
+	struct {
+		char d[mtc_offset_align(sizeof(MtcRCMemMembers))];
+	} pad;
+} MtcRCMem;
+
+//Reference counted memory
+static inline void mtc_rcmem_ref_inline(void *mem)
+{
+	MtcRCMem *md = ((MtcRCMem *) mem) - 1;
+	
+	mtc_refcount_inc(&(md->s.refcount));
+}
+
+static inline void mtc_rcmem_unref_inline(void *mem)
+{
+	MtcRCMem *md = ((MtcRCMem *) mem) - 1;
+	
+	if (mtc_refcount_dec_and_test(&(md->s.refcount)))
+		mtc_free_cat(mem);
+}
+
+static inline void mtc_mblock_ref_inline(MtcMBlock block)
+{
+	mtc_rcmem_ref_inline(block.parent ? block.parent : block.mem);
+}
+
+static inline void mtc_mblock_unref_inline(MtcMBlock block)
+{
+	mtc_rcmem_unref_inline(block.parent ? block.parent : block.mem);
+}
+
+//'Dual stream'
+static inline void mtc_msg_iter_inline(MtcMsg *self, MtcDStream *dstream)
+{
+	dstream->bytes = (char *) self->blocks->mem;
+	dstream->bytes_lim = dstream->bytes + self->blocks->size;
+	dstream->bytes_parent = self->blocks->parent 
+		? self->blocks->parent : self->blocks->mem;
+	dstream->blocks = self->blocks + 1;
+	dstream->blocks_lim = self->blocks + self->n_blocks;
+	dstream->heap = dstream->heap_lim = NULL;
+	dstream->heap_parent = NULL;
+	dstream->chunks = NULL;
+}
+
+//Growing the 'dual stream' is left to the library
+static inline int mtc_dstream_get_segment_inline
+	(MtcDStream *self, size_t n_bytes, size_t n_blocks,
+	 MtcSegment *res)
+{
+	if (n_bytes > (size_t) (self->bytes_lim - self->bytes)
+		|| n_blocks > (size_t) (self->blocks_lim - self->blocks))
+		return mtc_dstream_get_segment(self, n_bytes, n_blocks, res);
+	
+	res->bytes = self->bytes;
+	res->blocks = self->blocks;
+	self->bytes += n_bytes;
+	self->blocks += n_blocks;
+	
+	return 0;
+}
+
+//Arrays of integers. Empty sequences may have NULL data, which must
+//not be passed to memcpy().
+static inline void mtc_segment_write_uchar_array_inline
+	(MtcSegment *seg, unsigned char *ptr, size_t n)
+{
+	if (n)
+		memcpy(seg->bytes, ptr, n);
+	seg->bytes += n;
+}
+
+static inline void mtc_segment_read_uchar_array_inline
+	(MtcSegment *seg, unsigned char *ptr, size_t n)
+{
+	if (n)
+		memcpy(ptr, seg->bytes, n);
+	seg->bytes += n;
+}
+
+#ifdef MTC_UINT16_LITTLE_ENDIAN
+static inline void mtc_segment_write_uint16_array_inline
+	(MtcSegment *seg, uint16_t *ptr, size_t n)
+{
+	if (n)
+		memcpy(seg->bytes, ptr, n * 2);
+	seg->bytes += n * 2;
+}
+
+static inline void mtc_segment_read_uint16_array_inline
+	(MtcSegment *seg, uint16_t *ptr, size_t n)
+{
+	if (n)
+		memcpy(ptr, seg->bytes, n * 2);
+	seg->bytes += n * 2;
+}
+#endif
+
+#ifdef MTC_UINT32_LITTLE_ENDIAN
+static inline void mtc_segment_write_uint32_array_inline
+	(MtcSegment *seg, uint32_t *ptr, size_t n)
+{
+	if (n)
+		memcpy(seg->bytes, ptr, n * 4);
+	seg->bytes += n * 4;
+}
+
+static inline void mtc_segment_read_uint32_array_inline
+	(MtcSegment *seg, uint32_t *ptr, size_t n)
+{
+	if (n)
+		memcpy(ptr, seg->bytes, n * 4);
+	seg->bytes += n * 4;
+}
+#endif
+
+#ifdef MTC_UINT64_LITTLE_ENDIAN
+static inline void mtc_segment_write_uint64_array_inline
+	(MtcSegment *seg, uint64_t *ptr, size_t n)
+{
+	if (n)
+		memcpy(seg->bytes, ptr, n * 8);
+	seg->bytes += n * 8;
+}
+
+static inline void mtc_segment_read_uint64_array_inline
+	(MtcSegment *seg, uint64_t *ptr, size_t n)
+{
+	if (n)
+		memcpy(ptr, seg->bytes, n * 8);
+	seg->bytes += n * 8;
+}
+#endif
+
+//Floating point values
+//Normal values are copied bit by bit, everything else is left to
+//the library.
+#ifdef MTC_FLT_IEEE754
+static inline void mtc_segment_write_flt32_inline
+	(MtcSegment *seg, MtcValFlt val)
+{
+	uint32_t inter;
+	float v;
+	
+	if (val.type == MTC_FLT_NORMAL || val.type == MTC_FLT_ZERO)
+	{
+		v = val.val;
+		memcpy(&inter, &v, 4);
+		if ((inter & 0x7f800000) != 0x7f800000 && (inter & 0x7fffffff))
+		{
+			mtc_segment_write_uint32(seg, inter);
+			return;
+		}
+	}
+	
+	mtc_segment_write_flt32(seg, val);
+}
+
+static inline void mtc_segment_read_flt32_inline
+	(MtcSegment *seg, MtcValFlt *val)
+{
+	uint32_t inter;
+	float res;
+	
+	mtc_uint32_copy_from_le(seg->bytes, &inter);
+	if ((inter & 0x7f800000) == 0x7f800000)
+	{
+		mtc_segment_read_flt32(seg, val);
+		return;
+	}
+	seg->bytes += 4;
+	
+	val->type = inter ? MTC_FLT_NORMAL : MTC_FLT_ZERO;
+	memcpy(&res, &inter, 4);
+	val->val = res;
+}
+
+static inline void mtc_segment_write_flt64_inline
+	(MtcSegment *seg, MtcValFlt val)
+{
+	uint64_t inter;
+	
+	if (val.type == MTC_FLT_NORMAL || val.type == MTC_FLT_ZERO)
+	{
+		memcpy(&inter, &(val.val), 8);
+		if ((inter & 0x7ff0000000000000LL) != 0x7ff0000000000000LL
+			&& (inter & 0x7fffffffffffffffLL))
+		{
+			mtc_segment_write_uint64(seg, inter);
+			return;
+		}
+	}
+	
+	mtc_segment_write_flt64(seg, val);
+}
+
+static inline void mtc_segment_read_flt64_inline
+	(MtcSegment *seg, MtcValFlt *val)
+{
+	uint64_t inter;
+	
+	mtc_uint64_copy_from_le(seg->bytes, &inter);
+	if ((inter & 0x7ff0000000000000LL) == 0x7ff0000000000000LL)
+	{
+		mtc_segment_read_flt64(seg, val);
+		return;
+	}
+	seg->bytes += 8;
+	
+	val->type = inter ? MTC_FLT_NORMAL : MTC_FLT_ZERO;
+	memcpy(&(val->val), &inter, 8);
+}
+#endif
+
+//Strings
+static inline void mtc_segment_write_string_inline
+	(MtcSegment *seg, char *val)
+{
+	MtcMBlock *block;
+	size_t len;
+	
+	block = seg->blocks;
+	seg->blocks++;
+	
+	len = strlen(val) + 1;
+	block->mem = mtc_rcmem_dup_cat((void *) val, len, MTC_ALLOC_CAT_STRING);
+	block->size = len;
+	block->parent = NULL;
+}
+
+static inline void mtc_segment_write_rcstring_inline
+	(MtcSegment *seg, char *val)
+{
+	MtcMBlock *block;
+	
+	block = seg->blocks;
+	seg->blocks++;
+	
+	block->mem = val;
+	block->size = strlen(val) + 1;
+	block->parent = NULL;
+	mtc_rcmem_ref_inline(val);
+}
+
+static inline int mtc_segment_check_string_inline(MtcSegment *seg)
+{
+	MtcMBlock *block;
+	char *mem;
+	
+	block = seg->blocks;
+	mem = (char *) block->mem;
+	
+	//Verify that the only null character is the last byte
+	if (! block->size || mem[block->size - 1]
+		|| memchr(mem, 0, block->size - 1))
+		return -1;
+	
+	seg->blocks++;
+	
+	return 0;
+}
+
+static inline char *mtc_segment_get_string_inline(MtcSegment *seg)
+{
+	MtcMBlock *block;
+	
+	block = seg->blocks;
+	seg->blocks++;
+	
+	//A slice cannot be handed out as a string, copy it
+	if (block->parent)
+		return (char *) mtc_rcmem_dup_cat
+			(block->mem, block->size, MTC_ALLOC_CAT_STRING);
+	
+	mtc_rcmem_ref_inline(block->mem);
+	
+	return (char *) block->mem;
+}
+
+static inline char *mtc_segment_read_string_inline(MtcSegment *seg)
+{
+	MtcSegment check_seg = *seg;
+	
+	if (mtc_segment_check_string_inline(&check_seg) < 0)
+		return NULL;
+	
+	return mtc_segment_get_string_inline(seg);
+}
+
+//'raw' type
+static inline void mtc_segment_write_raw_inline
+	(MtcSegment *seg, MtcMBlock val)
+{
+	*(seg->blocks) = val;
+	seg->blocks++;
+	mtc_mblock_ref_inline(val);
+}
+
+static inline void mtc_segment_read_raw_inline
+	(MtcSegment *seg, MtcMBlock *val)
+{
+	*val = *(seg->blocks);
+	seg->blocks++;
+	mtc_mblock_ref_inline(*val);
+}
+
+//Everything including this header outside the library uses
+//inline versions
+#ifndef MTC_PRIVATE
+
+#define mtc_rcmem_ref mtc_rcmem_ref_inline
+#define mtc_rcmem_unref mtc_rcmem_unref_inline
+#define mtc_mblock_ref mtc_mblock_ref_inline
+#define mtc_mblock_unref mtc_mblock_unref_inline
+
+#define mtc_msg_iter mtc_msg_iter_inline
+#define mtc_dstream_get_segment mtc_dstream_get_segment_inline
+
+#define mtc_segment_write_uchar_array mtc_segment_write_uchar_array_inline
+#define mtc_segment_read_uchar_array mtc_segment_read_uchar_array_inline
+#ifdef MTC_UINT16_LITTLE_ENDIAN
+#define mtc_segment_write_uint16_array mtc_segment_write_uint16_array_inline
+#define mtc_segment_read_uint16_array mtc_segment_read_uint16_array_inline
+#endif
+#ifdef MTC_UINT32_LITTLE_ENDIAN
+#define mtc_segment_write_uint32_array mtc_segment_write_uint32_array_inline
+#define mtc_segment_read_uint32_array mtc_segment_read_uint32_array_inline
+#endif
+#ifdef MTC_UINT64_LITTLE_ENDIAN
+#define mtc_segment_write_uint64_array mtc_segment_write_uint64_array_inline
+#define mtc_segment_read_uint64_array mtc_segment_read_uint64_array_inline
+#endif
+
+#ifdef MTC_FLT_IEEE754
+#define mtc_segment_write_flt32 mtc_segment_write_flt32_inline
+#define mtc_segment_read_flt32 mtc_segment_read_flt32_inline
+#define mtc_segment_write_flt64 mtc_segment_write_flt64_inline
+#define mtc_segment_read_flt64 mtc_segment_read_flt64_inline
+#endif
+
+#define mtc_segment_write_string mtc_segment_write_string_inline
+#define mtc_segment_write_rcstring mtc_segment_write_rcstring_inline
+#define mtc_segment_check_string mtc_segment_check_string_inline
+#define mtc_segment_get_string mtc_segment_get_string_inline
+#define mtc_segment_read_string mtc_segment_read_string_inline
+
+#define mtc_segment_write_raw mtc_segment_write_raw_inline
+#define mtc_segment_read_raw mtc_segment_read_raw_inline
+
+#endif
+
+/**
+ * \}
+ */
+
+#endif //MTC_INLINE_H_INCLUDED
@@ -235,14 +235,13 @@ static void mtc_link_event_source_destroy(MtcLink *self)
 //Increments the reference count of the link by one.
 void mtc_link_ref(MtcLink *self)
 {
-	self->refcount++;
+	mtc_refcount_inc(&(self->refcount));
 }
 
 //Decrements the reference count of the link by one.
 void mtc_link_unref(MtcLink *self)
 {
-	self->refcount--;
-	if (! self->refcount)
+	if (mtc_refcount_dec_and_test(&(self->refcount)))
 	{	
 		//Run 'finalize' virtual function.
 		(* (self->vtable->finalize))(self);
@@ -251,21 +250,21 @@ void mtc_link_unref(MtcLink *self)
 		mtc_link_event_source_destroy(self);
 		
 		//Free ourselves
-		mtc_free(self);
+		mtc_free_cat(self);
 	}
 }
 
 //Gets reference count of the link.
 int mtc_link_get_refcount(MtcLink *self)
 {
-	return self->refcount;
+	return mtc_refcount_get(&(self->refcount));
 }
 
 MtcLink *mtc_link_create(size_t size, const MtcLinkVTable *vtable)
 {
 	MtcLink *self;
 
-	self = (MtcLink *) mtc_alloc(size);
+	self = (MtcLink *) mtc_alloc_cat(size, MTC_ALLOC_CAT_LINK);
 
 	self->refcount = 1;
 	self->in_status = self->out_status = MTC_LINK_STATUS_OPEN;
@@ -300,7 +299,7 @@ static void mtc_link_holder_destroy(MtcLinkHolder *holder)
 	
 	mtc_link_set_events_enabled(holder->link, 0);
 	mtc_link_unref(holder->link);
-	mtc_free(holder);
+	mtc_free_cat(holder);
 }
 
 static void mtc_link_holder_sent(MtcLink *link, void *data)
@@ -318,7 +317,8 @@ MtcLinkAsyncFlush *mtc_link_async_flush_new()
 	MtcLinkAsyncFlush *flush;
 	MtcRing *sentinel;
 	
-	flush = (MtcLinkAsyncFlush *) mtc_alloc(sizeof(MtcLinkAsyncFlush));
+	flush = (MtcLinkAsyncFlush *) mtc_alloc_cat
+		(sizeof(MtcLinkAsyncFlush), MTC_ALLOC_CAT_LINK);
 	
 	flush->refcount = 1;
 	
@@ -338,7 +338,8 @@ void mtc_link_async_flush_add(MtcLinkAsyncFlush *flush, MtcLink *link)
 	if (! mtc_link_has_unsent_data(link))
 		return;
 	
-	holder = (MtcLinkHolder *) mtc_alloc(sizeof(MtcLinkHolder));
+	holder = (MtcLinkHolder *) mtc_alloc_cat
+		(sizeof(MtcLinkHolder), MTC_ALLOC_CAT_LINK);
 	
 	ring = &(holder->ring);
 	sentinel = &(flush->sentinel);
@@ -372,17 +373,15 @@ void mtc_link_async_flush_clear(MtcLinkAsyncFlush *flush)
 
 void mtc_link_async_flush_ref(MtcLinkAsyncFlush *flush)
 {
-	flush->refcount++;
+	mtc_refcount_inc(&(flush->refcount));
 }
 
 void mtc_link_async_flush_unref(MtcLinkAsyncFlush *flush)
 {
-	flush->refcount--;
-	
-	if (flush->refcount <= 0)
+	if (mtc_refcount_dec_and_test(&(flush->refcount)))
 	{
 		mtc_link_async_flush_clear(flush);
 		
-		mtc_free(flush);
+		mtc_free_cat(flush);
 	}
 }
@@ -19,6 +19,9 @@
  */
 
 #include "common.h"
+#include "inline.h"
+
+#include <pthread.h>
 
 size_t mtc_msg_get_n_blocks(MtcMsg *self)
 {
@@ -32,36 +35,156 @@ MtcMBlock *mtc_msg_get_blocks(MtcMsg *self)
 
 void mtc_msg_iter(MtcMsg *self, MtcDStream *dstream)
 {
-	dstream->bytes = self->blocks->mem;
-	dstream->bytes_lim = dstream->bytes + self->blocks->size;
-	dstream->blocks = self->blocks + 1;
-	dstream->blocks_lim = self->blocks + self->n_blocks;
+	mtc_msg_iter_inline(self, dstream);
 }
 
-MtcMsg *mtc_msg_new(size_t n_bytes, size_t n_blocks)
+//Per-thread cache of destroyed messages, 
+//bucketed by capacity of byte stream and block array
+#define MTC_MSG_CACHE_MIN_BYTES 64
+#define MTC_MSG_CACHE_N_BYTE_CLASSES 7
+#define MTC_MSG_CACHE_N_BLOCK_CLASSES 5
+
+typedef struct
 {
-	MtcMsg *self;
-	void *byte_stream;
-	size_t msg_offset;
+	MtcMsg *buckets[MTC_MSG_CACHE_N_BYTE_CLASSES]
+		[MTC_MSG_CACHE_N_BLOCK_CLASSES];
+	MtcMsgCacheStats stats;
+	//Whether the cache is flushed when the thread exits
+	int watched;
+} MtcMsgCache;
+
+static __thread MtcMsgCache mtc_msg_cache;
+static size_t mtc_msg_cache_limit = 64;
+
+//Key whose destructor flushes the cache of an exiting thread
+static pthread_key_t mtc_msg_cache_key;
+static pthread_once_t mtc_msg_cache_key_once = PTHREAD_ONCE_INIT;
+
+//Finds the bucket for given capacity, returns -1 if it is too large
+static int mtc_msg_cache_classify
+	(size_t n_bytes, size_t n_blocks, int *byte_class, int *block_class)
+{
+	int i;
+	
+	for (i = 0; (MTC_MSG_CACHE_MIN_BYTES << i) < n_bytes; i++)
+		if (i == MTC_MSG_CACHE_N_BYTE_CLASSES - 1)
+			return -1;
+	*byte_class = i;
+	
+	for (i = 0; (1 << i) < n_blocks; i++)
+		if (i == MTC_MSG_CACHE_N_BLOCK_CLASSES - 1)
+			return -1;
+	*block_class = i;
+	
+	return 0;
+}
+
+static void mtc_msg_free_shell(MtcMsg *self)
+{
+	void *byte_stream = self->bs_ref;
+	
+	//One reference held by blocks[0], one by bs_ref
+	mtc_rcmem_unref(byte_stream);
+	mtc_rcmem_unref(byte_stream);
+}
+
+void mtc_msg_cache_set_limit(size_t limit)
+{
+	mtc_msg_cache_limit = limit;
+}
+
+void mtc_msg_cache_flush(void)
+{
+	MtcMsgCache *cache = &mtc_msg_cache;
+	int i, j;
+	
+	for (i = 0; i < MTC_MSG_CACHE_N_BYTE_CLASSES; i++)
+	{
+		for (j = 0; j < MTC_MSG_CACHE_N_BLOCK_CLASSES; j++)
+		{
+			MtcMsg *iter, *next;
+			
+			for (iter = cache->buckets[i][j]; iter; iter = next)
+			{
+				next = *((MtcMsg **) iter->bs_ref);
+				mtc_msg_free_shell(iter);
+			}
+			cache->buckets[i][j] = NULL;
+		}
+	}
 	
+	cache->stats.n_cached = 0;
+	
+	mtc_dstream_flush_spare();
+}
+
+static void mtc_msg_cache_destroy(void *data)
+{
+	mtc_msg_cache.watched = 0;
+	mtc_msg_cache_flush();
+}
+
+static void mtc_msg_cache_create_key(void)
+{
+	if (pthread_key_create(&mtc_msg_cache_key, mtc_msg_cache_destroy) != 0)
+		mtc_error("pthread_key_create() failed");
+}
+
+//Arranges for the cache of the calling thread, and the spare chunks
+//of growable 'dual streams', to be flushed when the thread exits
+static void mtc_msg_cache_watch(MtcMsgCache *cache)
+{
+	if (cache->watched)
+		return;
+	
+	pthread_once(&mtc_msg_cache_key_once, mtc_msg_cache_create_key);
+	//Destructors only run for non-NULL values
+	pthread_setspecific(mtc_msg_cache_key, cache);
+	cache->watched = 1;
+}
+
+void mtc_msg_cache_get_stats(MtcMsgCacheStats *stats)
+{
+	*stats = mtc_msg_cache.stats;
+}
+
+//Puts the message into the cache if possible
+static int mtc_msg_cache_put(MtcMsg *self)
+{
+	MtcMsgCache *cache = &mtc_msg_cache;
+	int byte_class, block_class;
+	
+	if (cache->stats.n_cached >= mtc_msg_cache_limit)
+		return -1;
+	if (! self->bytes_cap)
+		return -1;
+	if (mtc_rcmem_get_refcount(self->bs_ref) != 2)
+		return -1;
+	if (mtc_msg_cache_classify(self->bytes_cap, self->blocks_cap, 
+			&byte_class, &block_class) < 0)
+		return -1;
+	
+	mtc_msg_cache_watch(cache);
+	*((MtcMsg **) self->bs_ref) = cache->buckets[byte_class][block_class];
+	cache->buckets[byte_class][block_class] = self;
+	cache->stats.n_cached++;
+	
+	return 0;
+}
+
+//Initializes a message created by mtc_msg_new() to hold given 
+//number of bytes and empty blocks
+static void mtc_msg_init
+	(MtcMsg *self, void *byte_stream, size_t n_bytes, size_t n_blocks)
+{
 	MtcMBlock *m_iter, *m_lim;
 	
-	//Allocate memory
-	msg_offset = mtc_offset_align(n_bytes);
-	byte_stream = mtc_rcmem_alloc
-		(msg_offset + sizeof(MtcMsg) 
-		+ ((n_blocks + 1) * sizeof(MtcMBlock)));
-	self = MTC_PTR_ADD(byte_stream, msg_offset);
-	                  
 	//Initialize 'byte stream'
-	self->blocks[0].mem = byte_stream;
-	self->blocks[0].size = n_bytes;
-	mtc_rcmem_ref(byte_stream);
+	self->blocks[0] = mtc_mblock_init(byte_stream, n_bytes);
 	
 	//Initialize other members
 	self->n_blocks = n_blocks + 1;
 	self->refcount = 1;
-	self->bs_ref = byte_stream;
 	
 	//Initialize memory block array
 	m_iter = self->blocks + 1;
@@ -69,60 +192,180 @@ MtcMsg *mtc_msg_new(size_t n_bytes, size_t n_blocks)
 	
 	while(m_iter < m_lim)
 	{
-		m_iter->mem = NULL;
-		m_iter->size = 0;
+		*m_iter = mtc_mblock_init(NULL, 0);
 		
 		m_iter++;
 	}
+}
+
+//Sets up the heap after the byte stream of a message 
+//created with room for dlen.n_bytes + dlen.n_heap bytes
+static void mtc_msg_iter_heap(MtcMsg *self, MtcDLen dlen, MtcDStream *dstream)
+{
+	self->blocks[0].size = dlen.n_bytes;
+	
+	mtc_msg_iter(self, dstream);
+	dstream->heap = dstream->bytes_lim;
+	dstream->heap_lim = dstream->heap + dlen.n_heap;
+	dstream->heap_parent = self->bs_ref;
+}
+
+MtcMsg *mtc_msg_new(size_t n_bytes, size_t n_blocks)
+{
+	MtcMsg *self;
+	void *byte_stream;
+	size_t msg_offset, bytes_cap, blocks_cap;
+	int byte_class, block_class;
+	
+	bytes_cap = n_bytes;
+	blocks_cap = n_blocks + 1;
+	
+	//mtc_dstream_finish_growable() keeps spare chunks after calling this
+	mtc_msg_cache_watch(&mtc_msg_cache);
+	
+	if (mtc_msg_cache_limit 
+		&& mtc_msg_cache_classify(n_bytes, n_blocks + 1, 
+			&byte_class, &block_class) == 0)
+	{
+		MtcMsgCache *cache = &mtc_msg_cache;
+		
+		self = cache->buckets[byte_class][block_class];
+		if (self)
+		{
+			//Reuse a cached message
+			cache->buckets[byte_class][block_class] 
+				= *((MtcMsg **) self->bs_ref);
+			cache->stats.n_cached--;
+			cache->stats.hits++;
+			
+			byte_stream = self->bs_ref;
+			goto init;
+		}
+		
+		cache->stats.misses++;
+		bytes_cap = MTC_MSG_CACHE_MIN_BYTES << byte_class;
+		blocks_cap = 1 << block_class;
+	}
+	
+	//Allocate memory
+	msg_offset = mtc_offset_align(bytes_cap);
+	byte_stream = mtc_rcmem_alloc_cat
+		(msg_offset + sizeof(MtcMsg) 
+		+ (blocks_cap * sizeof(MtcMBlock)), MTC_ALLOC_CAT_MSG);
+	self = MTC_PTR_ADD(byte_stream, msg_offset);
+	mtc_rcmem_ref(byte_stream);
+	self->bs_ref = byte_stream;
+	self->bytes_cap = bytes_cap;
+	self->blocks_cap = blocks_cap;
+	
+init:
+	mtc_msg_init(self, byte_stream, n_bytes, n_blocks);
+	
+	return self;
+}
+
+MtcMsg *mtc_msg_new_with_heap(MtcDLen dlen, MtcDStream *dstream)
+{
+	MtcMsg *self;
+	
+	//The heap follows the byte stream in the same memory
+	self = mtc_msg_new(dlen.n_bytes + dlen.n_heap, dlen.n_blocks);
+	mtc_msg_iter_heap(self, dlen, dstream);
 	
 	return self;
 }
 
+int mtc_msg_reuse(MtcMsg *self, MtcDLen dlen, MtcDStream *dstream)
+{
+	MtcMBlock *m_iter, *m_lim;
+	int n_refs;
+	
+	//Only unshared messages from mtc_msg_new() can be reused
+	if (mtc_refcount_get(&(self->refcount)) != 1 || ! self->bytes_cap)
+		return -1;
+	
+	//Check capacity
+	if (dlen.n_bytes > self->bytes_cap 
+		|| dlen.n_heap > self->bytes_cap - dlen.n_bytes
+		|| dlen.n_blocks >= self->blocks_cap)
+		return -1;
+	
+	//The byte stream may only be referenced by the message itself, 
+	//including blocks in its heap
+	m_iter = self->blocks + 1;
+	m_lim = self->blocks + self->n_blocks;
+	for (n_refs = 2; m_iter < m_lim; m_iter++)
+		if (m_iter->parent == self->bs_ref)
+			n_refs++;
+	if (mtc_rcmem_get_refcount(self->bs_ref) != n_refs)
+		return -1;
+	
+	//Release blocks of previous contents, 
+	//blocks of a new message are still unset
+	for (m_iter = self->blocks + 1; m_iter < m_lim; m_iter++)
+		if (m_iter->mem)
+			mtc_mblock_unref(*m_iter);
+	
+	mtc_msg_init(self, self->bs_ref, 
+		dlen.n_bytes + dlen.n_heap, dlen.n_blocks);
+	mtc_msg_iter_heap(self, dlen, dstream);
+	
+	return 0;
+}
+
 MtcMsg *mtc_msg_try_new_allocd(size_t n_bytes, size_t n_blocks, 
 		uint32_t *block_sizes)
 {
 	MtcMsg *self;
-	void *byte_stream;
-	size_t msg_offset;
+	void *payload;
+	size_t payload_len, msg_offset, i;
 	
 	MtcMBlock *m_iter, *m_lim;
 	
-	//Allocate memory
-	msg_offset = mtc_offset_align(n_bytes);
-	byte_stream = mtc_rcmem_tryalloc
+	//Size of the payload
+	payload_len = n_bytes;
+	for (i = 0; i < n_blocks; i++)
+	{
+		if (payload_len + block_sizes[i] < payload_len)
+			return NULL;
+		payload_len += block_sizes[i];
+	}
+	if (n_blocks > (SIZE_MAX / sizeof(MtcMBlock)) - 1)
+		return NULL;
+	
+	//Allocate memory for payload and message together
+	msg_offset = mtc_offset_align(payload_len);
+	if (msg_offset < payload_len
+		|| msg_offset + sizeof(MtcMsg) 
+			+ ((n_blocks + 1) * sizeof(MtcMBlock)) < msg_offset)
+		return NULL;
+	payload = mtc_rcmem_tryalloc_cat
 		(msg_offset + sizeof(MtcMsg) 
-		+ ((n_blocks + 1) * sizeof(MtcMBlock)));
-	if (! byte_stream)
+		+ ((n_blocks + 1) * sizeof(MtcMBlock)), MTC_ALLOC_CAT_MSG);
+	if (! payload)
 		return NULL;
-	self = MTC_PTR_ADD(byte_stream, msg_offset);
+	self = MTC_PTR_ADD(payload, msg_offset);
 	                  
 	//Initialize 'byte stream'
-	self->blocks[0].mem = byte_stream;
-	self->blocks[0].size = n_bytes;
-	mtc_rcmem_ref(byte_stream);
+	self->blocks[0] = mtc_mblock_init(payload, n_bytes);
+	mtc_rcmem_ref(payload);
 	
 	//Initialize other members
 	self->n_blocks = n_blocks + 1;
 	self->refcount = 1;
-	self->bs_ref = byte_stream;
+	self->bs_ref = payload;
+	self->bytes_cap = self->blocks_cap = 0;
 	
-	//Allocate other memory blocks
+	//Other memory blocks are slices of the payload
 	m_iter = self->blocks + 1;
 	m_lim = m_iter + n_blocks;
 	
 	while(m_iter < m_lim)
 	{
-		m_iter->mem = mtc_rcmem_tryalloc(*block_sizes);
+		m_iter->mem = MTC_PTR_ADD(m_iter[-1].mem, m_iter[-1].size);
 		m_iter->size = *block_sizes;
-		
-		if (! m_iter->mem)
-		{
-			for (m_iter--; m_iter > self->blocks; m_iter--)
-				mtc_rcmem_unref(m_iter->mem);
-			
-			mtc_free(self);
-			return NULL;
-		}
+		m_iter->parent = payload;
+		mtc_rcmem_ref(payload);
 		
 		m_iter++;
 		block_sizes++;
@@ -131,31 +374,180 @@ MtcMsg *mtc_msg_try_new_allocd(size_t n_bytes, size_t n_blocks,
 	return self;
 }
 
+void *mtc_msg_get_payload(MtcMsg *self, size_t *size)
+{
+	MtcMBlock *m_iter, *m_lim;
+	void *payload = self->blocks[0].mem;
+	size_t len = self->blocks[0].size;
+	
+	m_iter = self->blocks + 1;
+	m_lim = self->blocks + self->n_blocks;
+	
+	for (; m_iter < m_lim; m_iter++)
+	{
+		if (m_iter->mem != MTC_PTR_ADD(payload, len))
+			return NULL;
+		len += m_iter->size;
+	}
+	
+	*size = len;
+	return payload;
+}
+
+size_t mtc_msg_get_flat_size(MtcMsg *self)
+{
+	size_t i, len;
+	
+	//Header
+	len = 4 * ((size_t) self->n_blocks + 1);
+	
+	//Contents
+	for (i = 0; i < self->n_blocks; i++)
+	{
+		if (self->blocks[i].size > UINT32_MAX
+			|| len + self->blocks[i].size < len)
+			return 0;
+		len += self->blocks[i].size;
+	}
+	
+	return len;
+}
+
+int mtc_msg_flatten_to(MtcMsg *self, void *buf, size_t size)
+{
+	char *header, *data;
+	size_t len;
+	uint32_t i, block_size;
+	
+	len = mtc_msg_get_flat_size(self);
+	if (! len || len > size)
+		return -1;
+	
+	//Header
+	header = (char *) buf;
+	data = header + 4 * ((size_t) self->n_blocks + 1);
+	mtc_uint32_copy_to_le(header, &(self->n_blocks));
+	header += 4;
+	
+	//Block sizes and contents
+	for (i = 0; i < self->n_blocks; i++)
+	{
+		block_size = self->blocks[i].size;
+		mtc_uint32_copy_to_le(header, &block_size);
+		header += 4;
+		
+		memcpy(data, self->blocks[i].mem, block_size);
+		data += block_size;
+	}
+	
+	return 0;
+}
+
+void *mtc_msg_flatten(MtcMsg *self, size_t *size)
+{
+	void *flat;
+	size_t len;
+	
+	len = mtc_msg_get_flat_size(self);
+	if (! len)
+		return NULL;
+	
+	flat = mtc_rcmem_tryalloc_cat(len, MTC_ALLOC_CAT_MSG);
+	if (! flat)
+		return NULL;
+	
+	mtc_msg_flatten_to(self, flat, len);
+	*size = len;
+	
+	return flat;
+}
+
+MtcMsg *mtc_msg_unflatten(MtcMBlock flat)
+{
+	MtcMsg *self;
+	char *header, *data;
+	size_t len, avail;
+	uint32_t n_blocks, i, block_size;
+	void *parent;
+	
+	//Read the number of blocks, there is always a byte stream
+	if (flat.size < 4)
+		return NULL;
+	header = (char *) flat.mem;
+	mtc_uint32_copy_from_le(header, &n_blocks);
+	header += 4;
+	if (! n_blocks || n_blocks > (flat.size / 4) - 1)
+		return NULL;
+	
+	//Sizes of all blocks must add up to the rest of the flat form
+	data = header + 4 * (size_t) n_blocks;
+	avail = flat.size - 4 * ((size_t) n_blocks + 1);
+	for (i = 0, len = 0; i < n_blocks; i++)
+	{
+		mtc_uint32_copy_from_le(header + 4 * (size_t) i, &block_size);
+		if (block_size > avail - len)
+			return NULL;
+		len += block_size;
+	}
+	if (len != avail)
+		return NULL;
+	
+	//Allocate memory for message
+	self = (MtcMsg *) mtc_tryalloc_cat
+		(sizeof(MtcMsg) + (n_blocks * sizeof(MtcMBlock)), 
+		MTC_ALLOC_CAT_MSG);
+	if (! self)
+		return NULL;
+	
+	//Initialize other members
+	self->n_blocks = n_blocks;
+	self->refcount = 1;
+	self->bs_ref = NULL;
+	self->bytes_cap = self->blocks_cap = 0;
+	
+	//All blocks are slices of the flat form
+	parent = flat.parent ? flat.parent : flat.mem;
+	for (i = 0; i < n_blocks; i++)
+	{
+		mtc_uint32_copy_from_le(header, &block_size);
+		header += 4;
+		
+		self->blocks[i].mem = data;
+		self->blocks[i].size = block_size;
+		self->blocks[i].parent = parent;
+		mtc_rcmem_ref(parent);
+		
+		data += block_size;
+	}
+	
+	return self;
+}
+
 void mtc_msg_ref(MtcMsg *self)
 {
-	self->refcount++;
+	mtc_refcount_inc(&(self->refcount));
 }
 
 void mtc_msg_unref(MtcMsg *self)
 {
-	self->refcount--;
-	
-	if (! self->refcount)
+	if (mtc_refcount_dec_and_test(&(self->refcount)))
 	{
 		MtcMBlock *m_iter, *m_lim;
 		
-		m_iter = self->blocks;
+		//Byte stream of messages from mtc_msg_new() is released 
+		//along with the message
+		m_iter = self->blocks + (self->bs_ref ? 1 : 0);
 		m_lim = self->blocks + self->n_blocks;
 		while(m_iter < m_lim)
 		{
-			mtc_rcmem_unref(m_iter->mem);
+			mtc_mblock_unref(*m_iter);
 			m_iter++;
 		}
 		
-		if (self->bs_ref)
-			mtc_rcmem_unref(self->bs_ref);
-		else
-			mtc_free(self);
+		if (! self->bs_ref)
+			mtc_free_cat(self);
+		else if (mtc_msg_cache_put(self) < 0)
+			mtc_msg_free_shell(self);
 	}
 }
 
@@ -165,6 +557,7 @@ MtcDLen mtc_msg_count(MtcMsg *self)
 	
 	res.n_bytes = 0;
 	res.n_blocks = self->n_blocks;
+	res.n_heap = 0;
 	
 	return res;
 }
@@ -185,7 +578,7 @@ void mtc_msg_write
 	for (i = 0; i < n_blocks; i++)
 	{
 		sub_seg.blocks[i] = self->blocks[i];
-		mtc_rcmem_ref(self->blocks[i].mem);
+		mtc_mblock_ref(self->blocks[i]);
 	}
 }
 
@@ -196,16 +589,19 @@ MtcMsg *mtc_msg_read(MtcSegment *segment, MtcDStream *dstream)
 	uint32_t n_blocks;
 	MtcMsg *self;
 	
-	//Read the number of blocks
+	//Read the number of blocks, there is always a byte stream
 	mtc_segment_read_uint32(segment, n_blocks);
+	if (! n_blocks)
+		return NULL;
 	
 	//Get the memory blocks
 	if (mtc_dstream_get_segment(dstream, 0, n_blocks, &sub_seg) < 0)
 		return NULL;
 	
 	//Allocate memory for message
-	self = (MtcMsg *) mtc_tryalloc
-		(sizeof(MtcMsg) + (n_blocks * sizeof(MtcMBlock)));
+	self = (MtcMsg *) mtc_tryalloc_cat
+		(sizeof(MtcMsg) + (n_blocks * sizeof(MtcMBlock)), 
+		MTC_ALLOC_CAT_MSG);
 	if (! self)
 		return NULL;
 	
@@ -213,13 +609,28 @@ MtcMsg *mtc_msg_read(MtcSegment *segment, MtcDStream *dstream)
 	self->n_blocks = n_blocks;
 	self->refcount = 1;
 	self->bs_ref = NULL;
+	self->bytes_cap = self->blocks_cap = 0;
 		
 	//Copy in all blocks
 	for (i = 0; i < n_blocks; i++)
 	{
 		self->blocks[i] = sub_seg.blocks[i];
-		mtc_rcmem_ref(sub_seg.blocks[i].mem);
+		mtc_mblock_ref(sub_seg.blocks[i]);
 	}
 	
 	return self;
 }
+
+int mtc_msg_check(MtcSegment *segment, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	uint32_t n_blocks;
+	
+	//Read the number of blocks, there is always a byte stream
+	mtc_segment_read_uint32(segment, n_blocks);
+	if (! n_blocks)
+		return -1;
+	
+	//Skip the memory blocks
+	return mtc_dstream_get_segment(dstream, 0, n_blocks, &sub_seg);
+}
@@ -32,6 +32,9 @@ typedef struct
 	int refcount;
 	
 	void *bs_ref;
+	//Capacity of the byte stream and the block array (including the
+	//byte stream) of messages created by mtc_msg_new(), 0 otherwise.
+	uint32_t bytes_cap, blocks_cap;
 	uint32_t n_blocks;
 	MtcMBlock blocks[];
 } MtcMsg;
@@ -58,17 +61,161 @@ MtcMBlock *mtc_msg_get_blocks(MtcMsg *self);
 void mtc_msg_iter(MtcMsg *self, MtcDStream *dstream);
 
 /**Creates a new message.
+ * 
+ * Messages of common sizes are taken from a per-thread cache of 
+ * recently destroyed messages when possible, see 
+ * mtc_msg_cache_set_limit().
  * \param n_bytes Size of the byte stream
  * \param n_blocks Size of the block stream
  */
 MtcMsg *mtc_msg_new(size_t n_bytes, size_t n_blocks);
 
+/**Creates a new message with a heap, a region in the same memory
+ * where contents of blocks can be placed, and initializes a 'dual 
+ * stream' over it. Serializers that copy block contents, like 
+ * mtc_string_write_heap(), put them in the heap, so that the whole 
+ * message takes a single allocation. Blocks that are only referenced,
+ * like _raw_ values, remain shared.
+ * \param dlen Size of the message, with n_heap the size of the heap
+ * \param dstream Return location for the 'dual stream', as 
+ *        initialized by mtc_msg_iter(), with the heap set up.
+ * \return The new message
+ */
+MtcMsg *mtc_msg_new_with_heap(MtcDLen dlen, MtcDStream *dstream);
+
+/**Reuses a message created by mtc_msg_new() or 
+ * mtc_msg_new_with_heap() for new contents, releasing the blocks it
+ * holds and initializing a 'dual stream' over it like 
+ * mtc_msg_new_with_heap(). This only succeeds if nothing else 
+ * references the message or its byte stream, and the message has 
+ * the capacity for the new contents, which is at least its size 
+ * at creation.
+ * \param self The message to reuse
+ * \param dlen New size of the message, with n_heap the size of the heap
+ * \param dstream Return location for the 'dual stream'
+ * \return 0 on success, -1 if the message cannot be reused, 
+ *         in which case it is left untouched.
+ */
+int mtc_msg_reuse(MtcMsg *self, MtcDLen dlen, MtcDStream *dstream);
+
+/**Collects everything written to a 'dual stream' initialized by
+ * mtc_dstream_init_growable() into a new message, and frees the
+ * chunks. References held by blocks are passed on to the message.
+ * \param self The 'dual stream'
+ * \return A new message containing the written data
+ */
+MtcMsg *mtc_dstream_finish_growable(MtcDStream *self);
+
+/**Frees the chunks kept by the calling thread for reuse by
+ * mtc_dstream_init_growable(). mtc_msg_cache_flush() calls this too.
+ */
+void mtc_dstream_flush_spare(void);
+
+///Statistics of the message cache of a thread
+typedef struct
+{
+	///Number of messages created from the cache
+	size_t hits;
+	///Number of messages of cacheable size that had to be allocated
+	size_t misses;
+	///Number of messages currently in the cache
+	size_t n_cached;
+} MtcMsgCacheStats;
+
+/**Sets the maximum number of destroyed messages each thread keeps 
+ * for reuse by mtc_msg_new(). Default is 64. 
+ * Set it to 0 to disable the cache; messages then are allocated 
+ * with exact sizes.
+ * 
+ * Only messages whose byte stream is at most 4096 bytes and that 
+ * have at most 15 blocks in the block stream are cached. They are
+ * allocated with their sizes rounded up to a power of two so that
+ * they can be reused for messages of similar size.
+ * \param limit Maximum number of messages cached per thread
+ */
+void mtc_msg_cache_set_limit(size_t limit);
+
+/**Frees all messages cached by the calling thread, and the chunks
+ * it kept for growable 'dual streams' (see mtc_dstream_flush_spare()).
+ * This is done automatically when a thread exits; call it to release
+ * the memory earlier.
+ */
+void mtc_msg_cache_flush(void);
+
+/**Gets statistics of the message cache of the calling thread.
+ * \param stats Return location for the statistics
+ */
+void mtc_msg_cache_get_stats(MtcMsgCacheStats *stats);
+
 /* Tries to create a new message, fully allocated. Ignores block_sizes
  * if n_blocks = 0. on failure it returns NULL.
+ * 
+ * The byte stream and all blocks are laid out back to back in one
+ * allocation, the payload (see mtc_msg_get_payload()). The blocks are
+ * slices of it, so the payload is released when the message and 
+ * all slices referring to it are gone.
+ * 
+ * Deserializing such a message references raw values but copies every
+ * string stored in a block, because a slice cannot be handed out as a
+ * reference counted string.
  */
 MtcMsg *mtc_msg_try_new_allocd
 	(size_t n_bytes, size_t n_blocks, uint32_t *block_sizes);
 
+/**Gets the contiguous memory that holds the byte stream followed by 
+ * all blocks of the message, in order. For messages created by 
+ * mtc_msg_try_new_allocd() this lets a whole frame be received with
+ * one read into it.
+ * \param self The message
+ * \param size Return location for the size of the payload
+ * \return The payload, or NULL if the contents of the message are 
+ *         not contiguous.
+ */
+void *mtc_msg_get_payload(MtcMsg *self, size_t *size);
+
+/**Gets the size of the flat form of the message, as written by 
+ * mtc_msg_flatten_to(). 
+ * 
+ * The flat form is the number of memory blocks and the size of each 
+ * of them as 32-bit little endian integers, followed by the contents
+ * of all blocks in order. 
+ * \param self The message
+ * \return Size of the flat form in bytes, 0 if the message has a 
+ *         block of 4 GiB or more and cannot be flattened.
+ */
+size_t mtc_msg_get_flat_size(MtcMsg *self);
+
+/**Writes the message in flat form into given buffer.
+ * \param self The message
+ * \param buf The buffer
+ * \param size Size of the buffer, 
+ *        at least mtc_msg_get_flat_size() bytes
+ * \return 0 on success, -1 if the message cannot be flattened or 
+ *         does not fit in the buffer.
+ */
+int mtc_msg_flatten_to(MtcMsg *self, void *buf, size_t size);
+
+/**Writes the message in flat form into newly allocated reference
+ * counted memory.
+ * \param self The message
+ * \param size Return location for the size of the flat form
+ * \return The flat form, release it using mtc_rcmem_unref().
+ *         NULL if the message cannot be flattened or allocation 
+ *         failed.
+ */
+void *mtc_msg_flatten(MtcMsg *self, size_t *size);
+
+/**Creates a message from its flat form without copying. 
+ * The blocks of the message are slices of the flat form, holding 
+ * references to it.
+ * \param flat Memory block containing exactly the flat form, 
+ *        for example the memory returned by mtc_msg_flatten() with 
+ *        parent set to NULL. It is not consumed.
+ * \return The message, NULL if flat is not a valid flat form or 
+ *         allocation failed.
+ */
+MtcMsg *mtc_msg_unflatten(MtcMBlock flat);
+
 /**Increments the reference count of the message by 1
  * \param self The message
  */        
@@ -102,6 +249,14 @@ void mtc_msg_write
  */
 MtcMsg *mtc_msg_read(MtcSegment *segment, MtcDStream *dstream);
 
+/**Checks a message in a 'dual stream' the way mtc_msg_read() does,
+ * without deserializing it.
+ * \param segment Current segment
+ * \param dstream The dual stream to check data from
+ * \return 0 if the message is valid, -1 otherwise
+ */
+int mtc_msg_check(MtcSegment *segment, MtcDStream *dstream);
+
 /**
  * \}
  */
@@ -0,0 +1,377 @@
+/* mmpool.c
+ * Pool of memory mappings for large allocations
+ *
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ *
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "common.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+//Mapping sizes have 4 classes per doubling
+#define MTC_MMPOOL_N_CLASSES (sizeof(size_t) * 8 * 4)
+
+//Mappings can be released on any thread in atomic mode
+#ifdef MTC_ATOMIC_REFCOUNT
+
+static char mtc_mmpool_lock_flag = 0;
+
+#define mtc_mmpool_lock() \
+	while (__atomic_test_and_set(&mtc_mmpool_lock_flag, __ATOMIC_ACQUIRE)) \
+		;
+
+#define mtc_mmpool_unlock() \
+	__atomic_clear(&mtc_mmpool_lock_flag, __ATOMIC_RELEASE)
+
+#else
+
+#define mtc_mmpool_lock()
+#define mtc_mmpool_unlock()
+
+#endif
+
+//Header at the beginning of every mapping
+typedef struct
+{
+	//Links the mapping into the list of live mappings, or into the
+	//list of cached mappings of its class
+	MtcRing ring;
+
+	size_t map_len;
+	size_t size;
+} MtcMMPoolMap;
+
+#define MTC_MMPOOL_HEADER_SIZE \
+	((sizeof(MtcMMPoolMap) + 63) - ((sizeof(MtcMMPoolMap) + 63) % 64))
+
+//State
+static size_t mtc_mmpool_threshold = 0;
+static int mtc_mmpool_hugepages = 0;
+static size_t mtc_mmpool_max_cached = 64 * 1024 * 1024;
+
+static int mtc_mmpool_initialized = 0;
+static MtcRing mtc_mmpool_live;
+static MtcRing mtc_mmpool_cached[MTC_MMPOOL_N_CLASSES];
+
+static size_t mtc_mmpool_n_mappings = 0;
+static size_t mtc_mmpool_n_cached = 0;
+static size_t mtc_mmpool_mapped_bytes = 0;
+static size_t mtc_mmpool_cached_bytes = 0;
+static size_t mtc_mmpool_used_bytes = 0;
+
+//Ring helpers
+static void mtc_mmpool_ring_add(MtcRing *sentinel, MtcRing *ring)
+{
+	ring->next = sentinel->next;
+	ring->prev = sentinel;
+	ring->next->prev = ring;
+	ring->prev->next = ring;
+}
+
+static void mtc_mmpool_ring_remove(MtcRing *ring)
+{
+	ring->next->prev = ring->prev;
+	ring->prev->next = ring->next;
+	ring->next = ring;
+	ring->prev = ring;
+}
+
+static void mtc_mmpool_init(void)
+{
+	int i;
+
+	if (mtc_mmpool_initialized)
+		return;
+
+	mtc_ring_init(&mtc_mmpool_live);
+	for (i = 0; i < MTC_MMPOOL_N_CLASSES; i++)
+		mtc_ring_init(mtc_mmpool_cached + i);
+
+	mtc_mmpool_initialized = 1;
+}
+
+//Finds the class of mappings large enough for size bytes and the
+//size of mappings of that class, returns -1 if there is none
+static int mtc_mmpool_classify(size_t size, size_t *map_len)
+{
+	size_t step;
+	int k, m;
+
+	if (size > ((size_t) -1) - MTC_MMPOOL_HEADER_SIZE)
+		return -1;
+	size += MTC_MMPOOL_HEADER_SIZE;
+	if (size < MTC_MMPOOL_MIN_MAPPING)
+		size = MTC_MMPOOL_MIN_MAPPING;
+
+	//2^k < size <= 2^(k+1), mapping size is m quarters of 2^k
+	for (k = 0; ((size - 1) >> k) > 1; k++)
+		;
+	if (k >= sizeof(size_t) * 8 - 1)
+		return -1;
+	step = (size_t) 1 << (k - 2);
+	m = (size + step - 1) / step;
+
+	*map_len = m * step;
+	return k * 4 + (m - 5);
+}
+
+static void mtc_mmpool_unmap(MtcMMPoolMap *map)
+{
+	mtc_mmpool_n_mappings--;
+	mtc_mmpool_mapped_bytes -= map->map_len;
+	munmap(map, map->map_len);
+}
+
+static void *mtc_mmpool_alloc_unlocked(size_t size)
+{
+	MtcMMPoolMap *map;
+	MtcRing *sentinel;
+	size_t map_len;
+	int class_id;
+
+	class_id = mtc_mmpool_classify(size, &map_len);
+	if (class_id < 0)
+		return NULL;
+
+	mtc_mmpool_init();
+
+	sentinel = mtc_mmpool_cached + class_id;
+	if (sentinel->next != sentinel)
+	{
+		//Recycle a cached mapping
+		map = (MtcMMPoolMap *) sentinel->next;
+		mtc_mmpool_ring_remove(&(map->ring));
+		mtc_mmpool_n_cached--;
+		mtc_mmpool_cached_bytes -= map->map_len;
+	}
+	else
+	{
+		map = (MtcMMPoolMap *) mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (map == MAP_FAILED)
+			return NULL;
+#ifdef MADV_HUGEPAGE
+		if (mtc_mmpool_hugepages)
+			madvise(map, map_len, MADV_HUGEPAGE);
+#endif
+
+		map->map_len = map_len;
+		mtc_mmpool_n_mappings++;
+		mtc_mmpool_mapped_bytes += map_len;
+	}
+
+	map->size = size;
+	mtc_mmpool_used_bytes += size;
+	mtc_mmpool_ring_add(&mtc_mmpool_live, &(map->ring));
+
+	return MTC_PTR_ADD(map, MTC_MMPOOL_HEADER_SIZE);
+}
+
+static void mtc_mmpool_free_unlocked(void *mem)
+{
+	MtcMMPoolMap *map;
+	size_t map_len;
+	int class_id;
+
+	map = (MtcMMPoolMap *) MTC_PTR_ADD(mem, - MTC_MMPOOL_HEADER_SIZE);
+
+	mtc_mmpool_ring_remove(&(map->ring));
+	mtc_mmpool_used_bytes -= map->size;
+
+	if (mtc_mmpool_cached_bytes + map->map_len > mtc_mmpool_max_cached)
+	{
+		mtc_mmpool_unmap(map);
+		return;
+	}
+
+	//Keep the mapping for reuse
+	class_id = mtc_mmpool_classify
+		(map->map_len - MTC_MMPOOL_HEADER_SIZE, &map_len);
+	mtc_mmpool_ring_add(mtc_mmpool_cached + class_id, &(map->ring));
+	mtc_mmpool_n_cached++;
+	mtc_mmpool_cached_bytes += map->map_len;
+}
+
+static void mtc_mmpool_set_max_cached_unlocked(size_t bytes)
+{
+	int i;
+
+	mtc_mmpool_max_cached = bytes;
+
+	if (! mtc_mmpool_initialized)
+		return;
+
+	//Release largest mappings first
+	for (i = MTC_MMPOOL_N_CLASSES - 1; i >= 0; i--)
+	{
+		MtcRing *sentinel = mtc_mmpool_cached + i;
+
+		while (mtc_mmpool_cached_bytes > mtc_mmpool_max_cached
+			&& sentinel->next != sentinel)
+		{
+			MtcMMPoolMap *map = (MtcMMPoolMap *) sentinel->next;
+
+			mtc_mmpool_ring_remove(&(map->ring));
+			mtc_mmpool_n_cached--;
+			mtc_mmpool_cached_bytes -= map->map_len;
+			mtc_mmpool_unmap(map);
+		}
+	}
+}
+
+void mtc_mmpool_set_threshold(size_t threshold)
+{
+	mtc_mmpool_threshold = threshold;
+}
+
+size_t mtc_mmpool_get_threshold(void)
+{
+	return mtc_mmpool_threshold;
+}
+
+void mtc_mmpool_set_hugepages(int enabled)
+{
+	mtc_mmpool_hugepages = enabled;
+}
+
+void mtc_mmpool_set_max_cached(size_t bytes)
+{
+	mtc_mmpool_lock();
+	mtc_mmpool_set_max_cached_unlocked(bytes);
+	mtc_mmpool_unlock();
+}
+
+void *mtc_mmpool_alloc(size_t size)
+{
+	void *mem;
+
+	mtc_mmpool_lock();
+	mem = mtc_mmpool_alloc_unlocked(size);
+	mtc_mmpool_unlock();
+
+	return mem;
+}
+
+void *mtc_mmpool_realloc(void *mem, size_t size)
+{
+	MtcMMPoolMap *map;
+	void *new_mem;
+	size_t map_len;
+
+	map = (MtcMMPoolMap *) MTC_PTR_ADD(mem, - MTC_MMPOOL_HEADER_SIZE);
+
+	mtc_mmpool_lock();
+
+	//Grow or shrink in place if the mapping is of right class
+	if (mtc_mmpool_classify(size, &map_len) >= 0 
+		&& map_len == map->map_len)
+	{
+		mtc_mmpool_used_bytes += size - map->size;
+		map->size = size;
+		mtc_mmpool_unlock();
+		return mem;
+	}
+
+	new_mem = mtc_mmpool_alloc_unlocked(size);
+	if (new_mem)
+	{
+		memcpy(new_mem, mem, size < map->size ? size : map->size);
+		mtc_mmpool_free_unlocked(mem);
+	}
+
+	mtc_mmpool_unlock();
+
+	return new_mem;
+}
+
+void mtc_mmpool_free(void *mem)
+{
+	mtc_mmpool_lock();
+	mtc_mmpool_free_unlocked(mem);
+	mtc_mmpool_unlock();
+}
+
+void mtc_mmpool_trim(void)
+{
+	size_t max_cached;
+
+	mtc_mmpool_lock();
+	max_cached = mtc_mmpool_max_cached;
+	mtc_mmpool_set_max_cached_unlocked(0);
+	mtc_mmpool_max_cached = max_cached;
+	mtc_mmpool_unlock();
+}
+
+//Counts resident bytes of a mapping
+static size_t mtc_mmpool_count_resident(MtcMMPoolMap *map, size_t page_size)
+{
+	unsigned char vec[256];
+	size_t res = 0, offset, chunk, n_pages, i;
+
+	for (offset = 0; offset < map->map_len; offset += chunk)
+	{
+		chunk = map->map_len - offset;
+		if (chunk > page_size * sizeof(vec))
+			chunk = page_size * sizeof(vec);
+		n_pages = (chunk + page_size - 1) / page_size;
+
+		if (mincore(MTC_PTR_ADD(map, offset), chunk, (void *) vec) < 0)
+			return res;
+
+		for (i = 0; i < n_pages; i++)
+			if (vec[i] & 1)
+				res += page_size;
+	}
+
+	return res;
+}
+
+void mtc_mmpool_get_stats(MtcMMPoolStats *stats)
+{
+	size_t page_size = sysconf(_SC_PAGESIZE);
+	MtcRing *iter;
+	int i;
+
+	mtc_mmpool_lock();
+
+	stats->n_mappings = mtc_mmpool_n_mappings;
+	stats->n_cached = mtc_mmpool_n_cached;
+	stats->mapped_bytes = mtc_mmpool_mapped_bytes;
+	stats->used_bytes = mtc_mmpool_used_bytes;
+	stats->resident_bytes = 0;
+
+	if (mtc_mmpool_initialized)
+	{
+		for (iter = mtc_mmpool_live.next; iter != &mtc_mmpool_live;
+			iter = iter->next)
+			stats->resident_bytes += mtc_mmpool_count_resident
+				((MtcMMPoolMap *) iter, page_size);
+
+		for (i = 0; i < MTC_MMPOOL_N_CLASSES; i++)
+		{
+			MtcRing *sentinel = mtc_mmpool_cached + i;
+
+			for (iter = sentinel->next; iter != sentinel;
+				iter = iter->next)
+				stats->resident_bytes += mtc_mmpool_count_resident
+					((MtcMMPoolMap *) iter, page_size);
+		}
+	}
+
+	mtc_mmpool_unlock();
+}
@@ -0,0 +1,115 @@
+/* mmpool.h
+ * Pool of memory mappings for large allocations
+ *
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ *
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \addtogroup mtc_utils
+ * \{
+ *
+ * The mapping pool serves large allocations directly from anonymous
+ * memory mappings. Once enabled using mtc_mmpool_set_threshold(),
+ * reference counted memory (and hence messages and _raw_ blocks) of
+ * at least the threshold size is allocated from it.
+ *
+ * Mappings are at least MTC_MMPOOL_MIN_MAPPING bytes and rounded up
+ * to one of four sizes per power of two. Freed mappings are kept for
+ * reuse with their pages still resident, so that recycling a mapping
+ * does not cause page faults again. Optionally transparent huge pages are
+ * requested for the mappings.
+ */
+
+///Smallest mapping made by the mapping pool
+#define MTC_MMPOOL_MIN_MAPPING ((size_t) 65536)
+
+///Statistics about the mapping pool
+typedef struct
+{
+	///Number of mappings, including the ones kept for reuse
+	size_t n_mappings;
+	///Number of mappings kept for reuse
+	size_t n_cached;
+	///Total size of all mappings
+	size_t mapped_bytes;
+	///Bytes of all mappings that are resident in memory
+	size_t resident_bytes;
+	///Bytes requested by allocations currently live
+	size_t used_bytes;
+} MtcMMPoolStats;
+
+/**Sets the size from which reference counted memory is allocated
+ * from the mapping pool.
+ * \param threshold Minimum size of allocations served by the pool,
+ *        0 to disable the pool (the default)
+ */
+void mtc_mmpool_set_threshold(size_t threshold);
+
+/**Gets the size from which reference counted memory is allocated
+ * from the mapping pool.
+ * \return The threshold, 0 if the pool is disabled
+ */
+size_t mtc_mmpool_get_threshold(void);
+
+/**Sets whether transparent huge pages are requested for new
+ * mappings using MADV_HUGEPAGE. Has no effect where it is not
+ * supported. Disabled by default.
+ * \param enabled Nonzero to request huge pages
+ */
+void mtc_mmpool_set_hugepages(int enabled);
+
+/**Sets the maximum total size of freed mappings kept for reuse.
+ * The default is 64 MiB. Setting it lower releases excess mappings
+ * immediately.
+ * \param bytes Maximum size of mappings to keep
+ */
+void mtc_mmpool_set_max_cached(size_t bytes);
+
+/**Allocates memory from the mapping pool.
+ * \param size Number of bytes to allocate
+ * \return Newly allocated memory, free with mtc_mmpool_free().
+ *         NULL if mapping failed.
+ */
+void *mtc_mmpool_alloc(size_t size);
+
+/**Resizes memory allocated from the mapping pool.
+ * \param mem Memory allocated by mtc_mmpool_alloc()
+ * \param size New size
+ * \return Resized memory, NULL if mapping failed,
+ *         in which case mem is left untouched.
+ */
+void *mtc_mmpool_realloc(void *mem, size_t size);
+
+/**Frees memory allocated by mtc_mmpool_alloc().
+ * \param mem The memory to free
+ */
+void mtc_mmpool_free(void *mem);
+
+/**Unmaps all mappings kept for reuse.
+ */
+void mtc_mmpool_trim(void);
+
+/**Gets statistics about the mapping pool.
+ * Resident size is determined using mincore(), so this walks all
+ * pages of all mappings.
+ * \param stats Return location for the statistics
+ */
+void mtc_mmpool_get_stats(MtcMMPoolStats *stats);
+
+/**
+ * \}
+ */
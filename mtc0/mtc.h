@@ -22,8 +22,16 @@
 #ifndef MTC_H_INCLUDED
 #define MTC_H_INCLUDED
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define _MTC_PUBLIC
 #include "common.h"
 #undef _MTC_PUBLIC
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif //MTC_H_INCLUDED
@@ -0,0 +1,419 @@
+/* mtc.hpp
+ * C++ API header: wrappers around messages, generated structures
+ * and function calls
+ *
+ * Copyright 2013 Akash Rawal
+ * This file is part of MTC.
+ *
+ * MTC is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * MTC is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with MTC.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * \addtogroup mtc_serialize
+ * \{
+ *
+ * <mtc0/mtc.hpp> is for C++20 programs. It wraps messages,
+ * values of structures and function call handles into move-only
+ * classes that release them when they go out of scope.
+ *
+ * mdlc --cxx writes a header that specializes mtc::Traits and
+ * mtc::View for every structure, and a descriptor for every function
+ * of every class to use with mtc::fc_start() and mtc::fc_return().
+ * Views return strings as std::string_view and bytes as std::span,
+ * pointing into the message they were created from.
+ */
+
+#ifndef MTC_HPP_INCLUDED
+#define MTC_HPP_INCLUDED
+
+#if __cplusplus < 202002L
+#error "<mtc0/mtc.hpp> requires C++20"
+#endif
+
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <mtc0/mtc.h>
+
+namespace mtc
+{
+
+/**A reference to a message. Destroying it drops the reference.
+ */
+class Msg
+{
+	MtcMsg *msg_;
+
+public:
+	///Creates an empty reference
+	Msg() noexcept : msg_(nullptr) {}
+	
+	/**Takes over a reference to a message.
+	 * \param msg A message or NULL, the caller's reference
+	 *            now belongs to the new object
+	 */
+	explicit Msg(MtcMsg *msg) noexcept : msg_(msg) {}
+	
+	Msg(const Msg &) = delete;
+	Msg &operator=(const Msg &) = delete;
+	
+	Msg(Msg &&other) noexcept : msg_(other.msg_)
+	{
+		other.msg_ = nullptr;
+	}
+	
+	Msg &operator=(Msg &&other) noexcept
+	{
+		std::swap(msg_, other.msg_);
+		return *this;
+	}
+	
+	~Msg()
+	{
+		if (msg_)
+			mtc_msg_unref(msg_);
+	}
+	
+	///Returns a new reference to the same message
+	Msg ref() const noexcept
+	{
+		if (msg_)
+			mtc_msg_ref(msg_);
+		return Msg(msg_);
+	}
+	
+	///Returns the message without changing its reference count
+	MtcMsg *get() const noexcept
+	{
+		return msg_;
+	}
+	
+	///Gives up the reference to the caller
+	MtcMsg *release() noexcept
+	{
+		MtcMsg *res = msg_;
+		
+		msg_ = nullptr;
+		return res;
+	}
+	
+	explicit operator bool() const noexcept
+	{
+		return msg_ != nullptr;
+	}
+};
+
+/**Functions generated by mdlc for a structure. mdlc --cxx
+ * specializes this for every structure with members:
+ *  - typedef of the C view type as CView
+ *  - MtcMsg *serialize(T *value)
+ *  - int deserialize_reuse(MtcMsg *msg, T *value)
+ *  - void free(T *value)
+ *  - int view_init(MtcMsg *msg, CView *view)
+ */
+template <typename T>
+struct Traits;
+
+/**A value of a structure deserialized from a message, owning
+ * all memory it refers to. Deserializing again into the same object
+ * reuses that memory.
+ */
+template <typename T>
+class Value
+{
+	T value_;
+	bool full_;
+
+public:
+	///Creates an empty value with all members zeroed
+	Value() noexcept : full_(false)
+	{
+		std::memset(&value_, 0, sizeof(T));
+	}
+	
+	Value(const Value &) = delete;
+	Value &operator=(const Value &) = delete;
+	
+	Value(Value &&other) noexcept : value_(other.value_), full_(other.full_)
+	{
+		std::memset(&other.value_, 0, sizeof(T));
+		other.full_ = false;
+	}
+	
+	Value &operator=(Value &&other) noexcept
+	{
+		std::swap(value_, other.value_);
+		std::swap(full_, other.full_);
+		return *this;
+	}
+	
+	~Value()
+	{
+		reset();
+	}
+	
+	///Frees the value and zeroes it
+	void reset() noexcept
+	{
+		if (full_)
+			Traits<T>::free(&value_);
+		std::memset(&value_, 0, sizeof(T));
+		full_ = false;
+	}
+	
+	/**Deserializes a message into the value.
+	 * \param msg The message
+	 * \return false if the message is invalid, the value is then empty
+	 */
+	bool deserialize(MtcMsg *msg) noexcept
+	{
+		full_ = (Traits<T>::deserialize_reuse(msg, &value_) == 0);
+		return full_;
+	}
+	
+	bool deserialize(const Msg &msg) noexcept
+	{
+		return deserialize(msg.get());
+	}
+	
+	///Serializes the value into a new message
+	Msg serialize() noexcept
+	{
+		return Msg(Traits<T>::serialize(&value_));
+	}
+	
+	///Whether the value holds a deserialized message
+	explicit operator bool() const noexcept
+	{
+		return full_;
+	}
+	
+	T *get() noexcept
+	{
+		return &value_;
+	}
+	
+	T &operator*() noexcept
+	{
+		return value_;
+	}
+	
+	T *operator->() noexcept
+	{
+		return &value_;
+	}
+};
+
+/**Serializes a value of a structure into a new message.
+ * \param value The value
+ * \return The new message
+ */
+template <typename T>
+Msg serialize(T &value) noexcept
+{
+	return Msg(Traits<T>::serialize(&value));
+}
+
+/**Members shared by all views. A view holds a reference to the
+ * message it reads from, so values returned by its accessors stay
+ * valid as long as the view or the message lives.
+ */
+template <typename T>
+class ViewBase
+{
+protected:
+	Msg msg_;
+	typename Traits<T>::CView view_;
+
+public:
+	///Creates an empty view, use init() before reading it
+	ViewBase() noexcept : msg_(), view_() {}
+	
+	/**Creates a view from a C view of a message
+	 * \param msg Reference to the message the C view reads from
+	 * \param view The C view
+	 */
+	ViewBase(Msg msg, const typename Traits<T>::CView &view) noexcept
+		: msg_(std::move(msg)), view_(view) {}
+	
+	/**Checks a message and creates a view of it
+	 * \param msg The message
+	 * \return false if the message is invalid
+	 */
+	bool init(Msg msg) noexcept
+	{
+		if (Traits<T>::view_init(msg.get(), &view_) < 0)
+			return false;
+		msg_ = std::move(msg);
+		return true;
+	}
+	
+	///The message the view reads from
+	const Msg &c_msg() const noexcept
+	{
+		return msg_;
+	}
+	
+	///The underlying C view
+	const typename Traits<T>::CView &c_view() const noexcept
+	{
+		return view_;
+	}
+};
+
+/**Typed view of a message holding a structure. mdlc --cxx
+ * specializes it for every structure, with an accessor for every
+ * member, m() or m(i) for arrays and sequences, m_len() for arrays
+ * and sequences and has_m() for references.
+ */
+template <typename T>
+class View;
+
+/**Handle for a function call started with fc_start(). Destroying it
+ * drops the handle, freeing output arguments of a successful call.
+ *
+ * Fn is a function descriptor generated by mdlc --cxx, with typedefs
+ * In and Out for argument structures (void for none) and
+ * static MtcFCBinary *binary().
+ */
+template <typename Fn>
+class Call
+{
+	MtcFCHandle *handle_;
+
+public:
+	explicit Call(MtcFCHandle *handle = nullptr) noexcept
+		: handle_(handle) {}
+	
+	Call(const Call &) = delete;
+	Call &operator=(const Call &) = delete;
+	
+	Call(Call &&other) noexcept : handle_(other.handle_)
+	{
+		other.handle_ = nullptr;
+	}
+	
+	Call &operator=(Call &&other) noexcept
+	{
+		std::swap(handle_, other.handle_);
+		return *this;
+	}
+	
+	~Call()
+	{
+		if (handle_)
+			mtc_dest_unref((MtcDest *) handle_);
+	}
+	
+	MtcFCHandle *get() const noexcept
+	{
+		return handle_;
+	}
+	
+	///See mtc_fc_get_status()
+	MtcStatus status() const noexcept
+	{
+		return mtc_fc_get_status(handle_);
+	}
+	
+	///See mtc_fc_finish_sync()
+	MtcStatus finish_sync() noexcept
+	{
+		return mtc_fc_finish_sync(handle_);
+	}
+	
+	///See mtc_fc_set_cb()
+	void set_cb(MtcFCFn cb, void *data) noexcept
+	{
+		mtc_fc_set_cb(handle_, cb, data);
+	}
+	
+	/**Output arguments, valid when status() is MTC_FC_SUCCESS.
+	 * They belong to the handle.
+	 */
+	typename Fn::Out *out() const noexcept
+	{
+		return mtc_fc_get_out_args(handle_, typename Fn::Out);
+	}
+};
+
+/**Starts a function call, see mtc_fc_start().
+ * \param peer The peer where the object resides
+ * \param addr Address assigned to its object handle
+ * \param args Input arguments
+ * \return Handle for the function call
+ */
+template <typename Fn>
+Call<Fn> fc_start(MtcPeer *peer, MtcMBlock addr, typename Fn::In &args)
+	noexcept
+{
+	return Call<Fn>(mtc_fc_start(peer, addr, Fn::binary(), &args));
+}
+
+///Starts a function call without input arguments
+template <typename Fn>
+Call<Fn> fc_start(MtcPeer *peer, MtcMBlock addr) noexcept
+{
+	static_assert(std::is_void_v<typename Fn::In>,
+		"The function has input arguments");
+	return Call<Fn>(mtc_fc_start(peer, addr, Fn::binary(), nullptr));
+}
+
+///Starts a function call without a handle, see mtc_fc_start_unhandled()
+template <typename Fn>
+void fc_start_unhandled
+	(MtcPeer *peer, MtcMBlock addr, typename Fn::In &args) noexcept
+{
+	mtc_fc_start_unhandled(peer, addr, Fn::binary(), &args);
+}
+
+template <typename Fn>
+void fc_start_unhandled(MtcPeer *peer, MtcMBlock addr) noexcept
+{
+	static_assert(std::is_void_v<typename Fn::In>,
+		"The function has input arguments");
+	mtc_fc_start_unhandled(peer, addr, Fn::binary(), nullptr);
+}
+
+/**Sends return values of a function call back, see mtc_fc_return().
+ * \param src The peer who started function call
+ * \param ret_addr Address to send return values to
+ * \param out_args Output arguments
+ */
+template <typename Fn>
+void fc_return(MtcPeer *src, MtcMBlock ret_addr, typename Fn::Out &out_args)
+	noexcept
+{
+	mtc_fc_return(src, ret_addr, Fn::binary(), &out_args);
+}
+
+///Returns from a function call without output arguments
+template <typename Fn>
+void fc_return(MtcPeer *src, MtcMBlock ret_addr) noexcept
+{
+	static_assert(std::is_void_v<typename Fn::Out>,
+		"The function has output arguments");
+	mtc_fc_return(src, ret_addr, Fn::binary(), nullptr);
+}
+
+} //namespace mtc
+
+/**
+ * \}
+ */
+
+#endif //MTC_HPP_INCLUDED
@@ -64,7 +64,7 @@ typedef struct
 
 static void mtc_router_init_dynamic(MtcRouter *router)
 {
-	router->dynamic_counter = mtc_alloc(1);
+	router->dynamic_counter = mtc_alloc_cat(1, MTC_ALLOC_CAT_DEST);
 	router->dynamic_len = 1;
 	counter[0] = 0;
 	
@@ -88,7 +88,8 @@ static MtcDest *mtc_router_alloc_dynamic_dest
 	alloc_len = dest_offset + size;
 	
 	//Allocate
-	addr.mem = mtc_rcmem_alloc(alloc_len);
+	addr = mtc_mblock_init
+		(mtc_rcmem_alloc_cat(alloc_len, MTC_ALLOC_CAT_DEST), addr.size);
 	dest = (MtcDest *) MTC_PTR_ADD(addr.mem, dest_offset);
 	
 	//Insert
@@ -111,7 +112,7 @@ static MtcDest *mtc_router_alloc_dynamic_dest
 	if (i == router->dynamic_len)
 	{
 		router->dynamic_len++;
-		router->dynamic_counter = mtc_realloc
+		router->dynamic_counter = mtc_realloc_cat
 			((void *) counter, router->dynamic_len);
 		counter[i] = 0;
 	}
@@ -133,7 +134,7 @@ static void mtc_router_free_dynamic(MtcRouter *router)
 		mtc_error("MtcRouter destroyed with "
 			"%d dynamic destinations still remaining", n_remain);
 	mtc_afl_destroy(&(router->dests));
-	mtc_free(router->dynamic_counter);
+	mtc_free_cat(router->dynamic_counter);
 }
 
 #undef counter
@@ -144,8 +145,8 @@ static void mtc_router_init_static(MtcRouter *router)
 	int i;
 	
 	router->static_dests_len = 4;
-	router->static_dests = (MtcDest **) mtc_alloc
-		(sizeof(void *) * router->static_dests_len);
+	router->static_dests = (MtcDest **) mtc_alloc_cat
+		(sizeof(void *) * router->static_dests_len, MTC_ALLOC_CAT_DEST);
 		
 	for (i = 0; i < router->static_dests_len; i++)
 	{
@@ -168,7 +169,8 @@ static MtcDest *mtc_router_alloc_static_dest
 	alloc_len = dest_offset + size;
 	
 	//Allocate
-	addr.mem = mtc_rcmem_alloc(alloc_len);
+	addr = mtc_mblock_init
+		(mtc_rcmem_alloc_cat(alloc_len, MTC_ALLOC_CAT_DEST), addr.size);
 	dest = (MtcDest *) MTC_PTR_ADD(addr.mem, dest_offset);
 	
 	//Enlarge router->static_dests if neccessary
@@ -180,7 +182,7 @@ static MtcDest *mtc_router_alloc_static_dest
 		if (new_len > mtc_static_id_max)
 			new_len = mtc_static_id_max;
 		
-		router->static_dests = (MtcDest **) mtc_realloc
+		router->static_dests = (MtcDest **) mtc_realloc_cat
 			(router->static_dests, sizeof(void *) * new_len);
 		
 		for (i = router->static_dests_len; i < new_len; i++)
@@ -220,7 +222,7 @@ static void mtc_router_free_static(MtcRouter *router)
 	if (n)
 		mtc_error("MtcRouter destroyed with "
 			"%d static destinations still remaining", n);
-	mtc_free(router->static_dests);
+	mtc_free_cat(router->static_dests);
 }
 
 MtcRouter *mtc_router_create
@@ -231,7 +233,7 @@ MtcRouter *mtc_router_create
 	if (struct_size < sizeof(MtcRouter))
 		mtc_error("struct_size is smaller than sizeof(MtcRouter)");
 	
-	router = (MtcRouter *) mtc_alloc(struct_size);
+	router = (MtcRouter *) mtc_alloc_cat(struct_size, MTC_ALLOC_CAT_DEST);
 	
 	router->refcount = 1;
 	router->vtable = vtable;
@@ -244,14 +246,12 @@ MtcRouter *mtc_router_create
 
 void mtc_router_ref(MtcRouter *router)
 {
-	router->refcount++;
+	mtc_refcount_inc(&(router->refcount));
 }
 
 void mtc_router_unref(MtcRouter *router)
 {
-	router->refcount--;
-	
-	if (router->refcount <= 0)
+	if (mtc_refcount_dec_and_test(&(router->refcount)))
 	{
 		(* router->vtable->destroy) (router);
 		
@@ -261,7 +261,7 @@ void mtc_router_unref(MtcRouter *router)
 		mtc_router_free_dynamic(router);
 		mtc_router_free_static(router);
 		
-		mtc_free(router);
+		mtc_free_cat(router);
 	}
 }
 
@@ -353,14 +353,12 @@ void mtc_peer_destroy(MtcPeer *peer)
 
 void mtc_peer_ref(MtcPeer *peer)
 {
-	peer->refcount++;
+	mtc_refcount_inc(&(peer->refcount));
 }
 
 void mtc_peer_unref(MtcPeer *peer)
 {
-	peer->refcount--;
-	
-	if (peer->refcount <= 0)
+	if (mtc_refcount_dec_and_test(&(peer->refcount)))
 	{
 		MtcRing *r = &(peer->reset_notifys);
 		
@@ -434,15 +432,13 @@ int mtc_peer_sync_io_step(MtcPeer *peer)
 
 MtcMBlock mtc_addr_new_static(int static_id)
 {
-	MtcMBlock res;
 	MtcStaticAddr *static_addr;
 	
-	static_addr = (MtcStaticAddr *) mtc_rcmem_alloc(1);
+	static_addr = (MtcStaticAddr *) mtc_rcmem_alloc_cat
+		(1, MTC_ALLOC_CAT_DEST);
 	static_addr->static_id = static_id;
 	
-	res.mem = static_addr;
-	res.size = 1;
-	return res;
+	return mtc_mblock_init(static_addr, 1);
 }
 
 
@@ -503,27 +499,25 @@ void mtc_dest_remove(MtcDest *dest)
 
 void mtc_dest_ref(MtcDest *dest)
 {
-	dest->refcount++;
+	mtc_refcount_inc(&(dest->refcount));
 }
 
 void mtc_dest_unref(MtcDest *dest)
 {
-	dest->refcount--;
-
-	if (dest->refcount <= 0)
+	if (mtc_refcount_dec_and_test(&(dest->refcount)))
 	{
 		mtc_dest_remove(dest);
 		
 		(* dest->vtable->destroy)(dest);
 		
 		mtc_router_unref(dest->router);
-		mtc_rcmem_unref(dest->addr.mem);
+		mtc_mblock_unref(dest->addr);
 	}
 }
 
 MtcMBlock mtc_dest_get_addr(MtcDest *dest)
 {
-	mtc_rcmem_ref(dest->addr.mem);
+	mtc_mblock_ref(dest->addr);
 	
 	return dest->addr;
 }
@@ -20,14 +20,223 @@
 /* ********************************************************************/ 
 
 #include "common.h"
+#include "inline.h"
+
+//Growable dual stream
+//Chunks start small and double in size upto a limit
+#define MTC_DSTREAM_CHUNK_MIN_BYTES 256
+#define MTC_DSTREAM_CHUNK_MIN_BLOCKS 8
+#define MTC_DSTREAM_CHUNK_MAX_SIZE 65536
+//Total size of chunks kept for reuse by each thread
+#define MTC_DSTREAM_SPARE_MAX_SIZE (4 * MTC_DSTREAM_CHUNK_MAX_SIZE)
+
+struct _MtcDStreamChunk
+{
+	MtcDStreamChunk *next;
+	//Capacity and used size in bytes
+	size_t size, used;
+};
+
+#define mtc_dstream_chunk_data(chunk) \
+	MTC_PTR_ADD((chunk), mtc_offset_align(sizeof(MtcDStreamChunk)))
+
+//Freed chunks are kept for reuse, so that serializing large messages
+//repeatedly does not keep returning memory to the system
+static __thread MtcDStreamChunk *mtc_dstream_spare = NULL;
+static __thread size_t mtc_dstream_spare_size = 0;
+
+static MtcDStreamChunk *mtc_dstream_chunk_alloc(size_t size)
+{
+	MtcDStreamChunk **iter, *chunk;
+	
+	for (iter = &mtc_dstream_spare; *iter; iter = &((*iter)->next))
+	{
+		if ((*iter)->size >= size)
+		{
+			chunk = *iter;
+			*iter = chunk->next;
+			mtc_dstream_spare_size -= chunk->size;
+			return chunk;
+		}
+	}
+	
+	chunk = (MtcDStreamChunk *) mtc_alloc_cat
+		(mtc_offset_align(sizeof(MtcDStreamChunk)) + size, 
+		MTC_ALLOC_CAT_MSG);
+	chunk->size = size;
+	
+	return chunk;
+}
+
+static void mtc_dstream_chunk_free(MtcDStreamChunk *chunk)
+{
+	if (mtc_dstream_spare_size + chunk->size > MTC_DSTREAM_SPARE_MAX_SIZE)
+	{
+		mtc_free_cat(chunk);
+		return;
+	}
+	
+	chunk->next = mtc_dstream_spare;
+	mtc_dstream_spare = chunk;
+	mtc_dstream_spare_size += chunk->size;
+}
+
+void mtc_dstream_flush_spare(void)
+{
+	MtcDStreamChunk *iter, *next;
+	
+	for (iter = mtc_dstream_spare; iter; iter = next)
+	{
+		next = iter->next;
+		mtc_free_cat(iter);
+	}
+	
+	mtc_dstream_spare = NULL;
+	mtc_dstream_spare_size = 0;
+}
+
+//Adds a chunk of at least min_size bytes after tail, returns its data
+static void *mtc_dstream_chunk_add
+	(MtcDStreamChunk **head, MtcDStreamChunk **tail, 
+	 size_t used, size_t min_size, size_t start_size)
+{
+	MtcDStreamChunk *chunk;
+	size_t size = start_size;
+	
+	if (*tail)
+	{
+		(*tail)->used = used;
+		size = (*tail)->size * 2;
+		if (size > MTC_DSTREAM_CHUNK_MAX_SIZE)
+			size = MTC_DSTREAM_CHUNK_MAX_SIZE;
+	}
+	if (size < min_size)
+		size = min_size;
+	
+	chunk = mtc_dstream_chunk_alloc(size);
+	chunk->next = NULL;
+	chunk->used = 0;
+	
+	if (*tail)
+		(*tail)->next = chunk;
+	else
+		*head = chunk;
+	*tail = chunk;
+	
+	return mtc_dstream_chunk_data(chunk);
+}
+
+//Moves the dual stream to new chunks so that a segment fits
+static void mtc_dstream_grow
+	(MtcDStream *self, size_t n_bytes, size_t n_blocks)
+{
+	MtcDStreamChunks *chunks = self->chunks;
+	
+	if (n_bytes > (size_t) (self->bytes_lim - self->bytes))
+	{
+		size_t used = chunks->bytes_tail 
+			? self->bytes - (char *) mtc_dstream_chunk_data
+				(chunks->bytes_tail) 
+			: 0;
+		
+		self->bytes = (char *) mtc_dstream_chunk_add
+			(&(chunks->bytes_head), &(chunks->bytes_tail), 
+			used, n_bytes, MTC_DSTREAM_CHUNK_MIN_BYTES);
+		self->bytes_lim = self->bytes + chunks->bytes_tail->size;
+	}
+	
+	if (n_blocks > (size_t) (self->blocks_lim - self->blocks))
+	{
+		size_t used = chunks->blocks_tail
+			? (char *) self->blocks - (char *) mtc_dstream_chunk_data
+				(chunks->blocks_tail) 
+			: 0;
+		
+		if (n_blocks > SIZE_MAX / sizeof(MtcMBlock))
+			mtc_error("Too many blocks");
+		
+		self->blocks = (MtcMBlock *) mtc_dstream_chunk_add
+			(&(chunks->blocks_head), &(chunks->blocks_tail), 
+			used, n_blocks * sizeof(MtcMBlock), 
+			MTC_DSTREAM_CHUNK_MIN_BLOCKS * sizeof(MtcMBlock));
+		self->blocks_lim = self->blocks 
+			+ chunks->blocks_tail->size / sizeof(MtcMBlock);
+	}
+}
+
+void mtc_dstream_init_growable(MtcDStream *self, MtcDStreamChunks *chunks)
+{
+	chunks->bytes_head = chunks->bytes_tail = NULL;
+	chunks->blocks_head = chunks->blocks_tail = NULL;
+	
+	self->bytes = self->bytes_lim = NULL;
+	self->bytes_parent = NULL;
+	self->blocks = self->blocks_lim = NULL;
+	self->heap = self->heap_lim = NULL;
+	self->heap_parent = NULL;
+	self->chunks = chunks;
+}
+
+MtcMsg *mtc_dstream_finish_growable(MtcDStream *self)
+{
+	MtcDStreamChunks *chunks = self->chunks;
+	MtcDStreamChunk *iter, *next;
+	MtcMsg *msg;
+	size_t n_bytes = 0, n_blocks = 0;
+	char *bytes;
+	MtcMBlock *blocks;
+	
+	//Find out the sizes
+	if (chunks->bytes_tail)
+		chunks->bytes_tail->used = self->bytes 
+			- (char *) mtc_dstream_chunk_data(chunks->bytes_tail);
+	if (chunks->blocks_tail)
+		chunks->blocks_tail->used = (char *) self->blocks 
+			- (char *) mtc_dstream_chunk_data(chunks->blocks_tail);
+	
+	for (iter = chunks->bytes_head; iter; iter = iter->next)
+		n_bytes += iter->used;
+	for (iter = chunks->blocks_head; iter; iter = iter->next)
+		n_blocks += iter->used / sizeof(MtcMBlock);
+	
+	//Concatenate the chunks into the message
+	msg = mtc_msg_new(n_bytes, n_blocks);
+	bytes = (char *) mtc_msg_get_blocks(msg)[0].mem;
+	blocks = mtc_msg_get_blocks(msg) + 1;
+	
+	for (iter = chunks->bytes_head; iter; iter = next)
+	{
+		next = iter->next;
+		memcpy(bytes, mtc_dstream_chunk_data(iter), iter->used);
+		bytes += iter->used;
+		mtc_dstream_chunk_free(iter);
+	}
+	for (iter = chunks->blocks_head; iter; iter = next)
+	{
+		next = iter->next;
+		memcpy(blocks, mtc_dstream_chunk_data(iter), iter->used);
+		blocks += iter->used / sizeof(MtcMBlock);
+		mtc_dstream_chunk_free(iter);
+	}
+	
+	chunks->bytes_head = chunks->bytes_tail = NULL;
+	chunks->blocks_head = chunks->blocks_tail = NULL;
+	self->chunks = NULL;
+	
+	return msg;
+}
 
 int mtc_dstream_get_segment
 	(MtcDStream *self, size_t n_bytes, size_t n_blocks, 
 	 MtcSegment *res)
 {
-	if (self->bytes + n_bytes > self->bytes_lim
-		|| self->blocks + n_blocks > self->blocks_lim)
-		return -1;
+	if (n_bytes > (size_t) (self->bytes_lim - self->bytes)
+		|| n_blocks > (size_t) (self->blocks_lim - self->blocks))
+	{
+		if (! self->chunks)
+			return -1;
+		mtc_dstream_grow(self, n_bytes, n_blocks);
+	}
 	
 	res->bytes = self->bytes;
 	res->blocks = self->blocks;
@@ -37,138 +246,1268 @@ int mtc_dstream_get_segment
 	return 0;
 }
 
+//Arrays of integers
+void mtc_segment_write_uchar_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n)
+{
+	mtc_segment_write_uchar_array_inline(seg, ptr, n);
+}
+
+void mtc_segment_read_uchar_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n)
+{
+	mtc_segment_read_uchar_array_inline(seg, ptr, n);
+}
+
+//On little endian hosts the integers are already in portable form.
+//Elsewhere they are converted one by one; with byte swapping builtins
+//compilers vectorize these loops into byte shuffles. Empty sequences
+//may have NULL data, which must not be passed to memcpy().
+void mtc_segment_write_uint16_array(MtcSegment *seg, uint16_t *ptr, size_t n)
+{
+#ifdef MTC_UINT16_LITTLE_ENDIAN
+	if (n)
+		memcpy(seg->bytes, ptr, n * 2);
+#else
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_uint16_copy_to_le(seg->bytes + i * 2, ptr + i);
+#endif
+	seg->bytes += n * 2;
+}
+
+void mtc_segment_write_uint32_array(MtcSegment *seg, uint32_t *ptr, size_t n)
+{
+#ifdef MTC_UINT32_LITTLE_ENDIAN
+	if (n)
+		memcpy(seg->bytes, ptr, n * 4);
+#else
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_uint32_copy_to_le(seg->bytes + i * 4, ptr + i);
+#endif
+	seg->bytes += n * 4;
+}
+
+void mtc_segment_write_uint64_array(MtcSegment *seg, uint64_t *ptr, size_t n)
+{
+#ifdef MTC_UINT64_LITTLE_ENDIAN
+	if (n)
+		memcpy(seg->bytes, ptr, n * 8);
+#else
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_uint64_copy_to_le(seg->bytes + i * 8, ptr + i);
+#endif
+	seg->bytes += n * 8;
+}
+
+void mtc_segment_read_uint16_array(MtcSegment *seg, uint16_t *ptr, size_t n)
+{
+#ifdef MTC_UINT16_LITTLE_ENDIAN
+	if (n)
+		memcpy(ptr, seg->bytes, n * 2);
+#else
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_uint16_copy_from_le(seg->bytes + i * 2, ptr + i);
+#endif
+	seg->bytes += n * 2;
+}
+
+void mtc_segment_read_uint32_array(MtcSegment *seg, uint32_t *ptr, size_t n)
+{
+#ifdef MTC_UINT32_LITTLE_ENDIAN
+	if (n)
+		memcpy(ptr, seg->bytes, n * 4);
+#else
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_uint32_copy_from_le(seg->bytes + i * 4, ptr + i);
+#endif
+	seg->bytes += n * 4;
+}
+
+void mtc_segment_read_uint64_array(MtcSegment *seg, uint64_t *ptr, size_t n)
+{
+#ifdef MTC_UINT64_LITTLE_ENDIAN
+	if (n)
+		memcpy(ptr, seg->bytes, n * 8);
+#else
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_uint64_copy_from_le(seg->bytes + i * 8, ptr + i);
+#endif
+	seg->bytes += n * 8;
+}
+
+#ifndef MTC_INT_2_COMPLEMENT
+void mtc_segment_write_char_array(MtcSegment *seg, char *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_write_char(seg, ptr[i]);
+}
+
+void mtc_segment_read_char_array(MtcSegment *seg, char *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_read_char(seg, ptr[i]);
+}
+
+void mtc_segment_write_int16_array(MtcSegment *seg, int16_t *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_write_int16(seg, ptr[i]);
+}
+
+void mtc_segment_write_int32_array(MtcSegment *seg, int32_t *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_write_int32(seg, ptr[i]);
+}
+
+void mtc_segment_write_int64_array(MtcSegment *seg, int64_t *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_write_int64(seg, ptr[i]);
+}
+
+void mtc_segment_read_int16_array(MtcSegment *seg, int16_t *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_read_int16(seg, ptr[i]);
+}
+
+void mtc_segment_read_int32_array(MtcSegment *seg, int32_t *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_read_int32(seg, ptr[i]);
+}
+
+void mtc_segment_read_int64_array(MtcSegment *seg, int64_t *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		mtc_segment_read_int64(seg, ptr[i]);
+}
+#endif
+
+//Booleans
+void mtc_segment_write_bool_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n)
+{
+	unsigned char *bytes = (unsigned char *) seg->bytes;
+	size_t i;
+	
+	memset(bytes, 0, (n + 7) / 8);
+	for (i = 0; i < n; i++)
+	{
+		if (ptr[i])
+			bytes[i >> 3] |= 1 << (i & 7);
+	}
+	
+	seg->bytes += (n + 7) / 8;
+}
+
+void mtc_segment_read_bool_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n)
+{
+	unsigned char *bytes = (unsigned char *) seg->bytes;
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		ptr[i] = (bytes[i >> 3] >> (i & 7)) & 1;
+	
+	seg->bytes += (n + 7) / 8;
+}
+
+//Enumerations
+int mtc_segment_read_enum8
+	(MtcSegment *seg, unsigned char *res, uint32_t n_values)
+{
+	mtc_segment_read_uchar(seg, *res);
+	
+	return *res < n_values ? 0 : -1;
+}
+
+int mtc_segment_read_enum16
+	(MtcSegment *seg, uint16_t *res, uint32_t n_values)
+{
+	mtc_segment_read_uint16(seg, *res);
+	
+	return *res < n_values ? 0 : -1;
+}
+
+int mtc_segment_read_enum32
+	(MtcSegment *seg, uint32_t *res, uint32_t n_values)
+{
+	mtc_segment_read_uint32(seg, *res);
+	
+	return *res < n_values ? 0 : -1;
+}
+
+int mtc_segment_check_enum8(MtcSegment *seg, uint32_t n_values)
+{
+	unsigned char val;
+	
+	return mtc_segment_read_enum8(seg, &val, n_values);
+}
+
+int mtc_segment_check_enum16(MtcSegment *seg, uint32_t n_values)
+{
+	uint16_t val;
+	
+	return mtc_segment_read_enum16(seg, &val, n_values);
+}
+
+int mtc_segment_check_enum32(MtcSegment *seg, uint32_t n_values)
+{
+	uint32_t val;
+	
+	return mtc_segment_read_enum32(seg, &val, n_values);
+}
+
 //Floating point values
-void mtc_segment_write_flt32(MtcSegment *seg, MtcValFlt val)
+//Converts MtcValFlt to 32-bit IEEE 754 form
+static uint32_t mtc_val_flt_to_flt32(MtcValFlt val)
 {
+#ifdef MTC_FLT_IEEE754
 	uint32_t inter;
+	float v;
+	
+	//Common case, same as mtc_double_to_flt32() but inlined
+	if (val.type == MTC_FLT_NORMAL || val.type == MTC_FLT_ZERO)
+	{
+		v = val.val;
+		memcpy(&inter, &v, 4);
+		if ((inter & 0x7f800000) == 0x7f800000 && (inter & 0x007fffff))
+			return mtc_flt32_nan;
+		if (! (inter & 0x7fffffff))
+			return mtc_flt32_zero;
+		return inter;
+	}
+#endif
 	
 	switch (val.type)
 	{
 	case MTC_FLT_ZERO:
 	case MTC_FLT_NORMAL:
-		inter = mtc_double_to_flt32(val.val);
-		break;
+		return mtc_double_to_flt32(val.val);
 	case MTC_FLT_NAN:
-		inter = mtc_flt32_nan;
-		break;
+		return mtc_flt32_nan;
 	case MTC_FLT_INFINITE:
-		inter = mtc_flt32_infinity;
-		break;
+		return mtc_flt32_infinity;
 	case MTC_FLT_NEG_INFINITE:
-		inter = mtc_flt32_neg_infinity;
+		return mtc_flt32_neg_infinity;
 	default:
 		mtc_error("Invalid type %d", val.type);
 	}
 	
-	mtc_segment_write_uint32(seg, inter);
-}
-
-void mtc_segment_read_flt32(MtcSegment *seg, MtcValFlt *val)
-{
-	uint32_t inter;
-	
-	mtc_segment_read_uint32(seg, inter);
-	val->type = mtc_flt32_classify(inter);
-	val->val = mtc_double_from_flt32(inter);
+	return 0;
 }
 
-void mtc_segment_write_flt64(MtcSegment *seg, MtcValFlt val)
+//Converts MtcValFlt to 64-bit IEEE 754 form
+static uint64_t mtc_val_flt_to_flt64(MtcValFlt val)
 {
+#ifdef MTC_FLT_IEEE754
 	uint64_t inter;
 	
+	//Common case, same as mtc_double_to_flt64() but inlined
+	if (val.type == MTC_FLT_NORMAL || val.type == MTC_FLT_ZERO)
+	{
+		memcpy(&inter, &(val.val), 8);
+		if ((inter & 0x7ff0000000000000LL) == 0x7ff0000000000000LL 
+			&& (inter & 0x000fffffffffffffLL))
+			return mtc_flt64_nan;
+		if (! (inter & 0x7fffffffffffffffLL))
+			return mtc_flt64_zero;
+		return inter;
+	}
+#endif
+	
 	switch (val.type)
 	{
 	case MTC_FLT_ZERO:
 	case MTC_FLT_NORMAL:
-		inter = mtc_double_to_flt64(val.val);
-		break;
+		return mtc_double_to_flt64(val.val);
 	case MTC_FLT_NAN:
-		inter = mtc_flt64_nan;
-		break;
+		return mtc_flt64_nan;
 	case MTC_FLT_INFINITE:
-		inter = mtc_flt64_infinity;
-		break;
+		return mtc_flt64_infinity;
 	case MTC_FLT_NEG_INFINITE:
-		inter = mtc_flt64_neg_infinity;
+		return mtc_flt64_neg_infinity;
 	default:
 		mtc_error("Invalid type %d", val.type);
 	}
 	
-	mtc_segment_write_uint64(seg, inter);
+	return 0;
 }
 
-void mtc_segment_read_flt64(MtcSegment *seg, MtcValFlt *val)
+//Converts 32-bit IEEE 754 form to MtcValFlt
+static void mtc_val_flt_from_flt32(uint32_t inter, MtcValFlt *val)
+{
+	val->type = mtc_flt32_classify(inter);
+#ifdef MTC_FLT_IEEE754
+	{
+		float res;
+		
+		memcpy(&res, &inter, 4);
+		val->val = res;
+	}
+#else
+	val->val = mtc_double_from_flt32(inter);
+#endif
+}
+
+//Converts 64-bit IEEE 754 form to MtcValFlt
+static void mtc_val_flt_from_flt64(uint64_t inter, MtcValFlt *val)
 {
-	uint64_t inter;
-	
-	mtc_segment_read_uint64(seg, inter);
 	val->type = mtc_flt64_classify(inter);
+#ifdef MTC_FLT_IEEE754
+	memcpy(&(val->val), &inter, 8);
+#else
 	val->val = mtc_double_from_flt64(inter);
+#endif
 }
 
-//Strings
-
-void mtc_segment_write_string(MtcSegment *seg, char *val)
+void mtc_segment_write_flt32(MtcSegment *seg, MtcValFlt val)
 {
-	MtcMBlock *block;
-	size_t len;
-		
-	block = seg->blocks;
-	seg->blocks++;
+	uint32_t inter;
 	
-	//Copy memory
-	len = strlen(val) + 1;
-	block->mem = mtc_rcmem_dup((void *) val, len);
-	block->size = len;
+	inter = mtc_val_flt_to_flt32(val);
+	mtc_segment_write_uint32(seg, inter);
 }
 
-char *mtc_segment_read_string(MtcSegment *seg)
+void mtc_segment_read_flt32(MtcSegment *seg, MtcValFlt *val)
 {
-	MtcMBlock *block;
-	int len;
-	char *ch, *lim, *res;
-	
-	//Fetch it
-	block = seg->blocks;
-	len = block->size;
-	
-	//Verify...
-	res = ch = (char *) block->mem;
-	lim = ch + len - 1;
-	for(; ch < lim ? *ch : 0; ch++)
-		;
-	if (ch != lim)
-		return NULL;
+	uint32_t inter;
 	
-	//Increment
-	seg->blocks++;
+	mtc_segment_read_uint32(seg, inter);
+	mtc_val_flt_from_flt32(inter, val);
+}
 
-	//Reference count
-	mtc_rcmem_ref(block->mem);
+void mtc_segment_write_flt64(MtcSegment *seg, MtcValFlt val)
+{
+	uint64_t inter;
 	
-	return res;
+	inter = mtc_val_flt_to_flt64(val);
+	mtc_segment_write_uint64(seg, inter);
 }
 
-//'raw' type
-void mtc_segment_write_raw(MtcSegment *seg, MtcMBlock val)
+void mtc_segment_read_flt64(MtcSegment *seg, MtcValFlt *val)
 {
-	MtcMBlock *block;
+	uint64_t inter;
 	
-	block = seg->blocks;
-	seg->blocks++;
+	mtc_segment_read_uint64(seg, inter);
+	mtc_val_flt_from_flt64(inter, val);
+}
+
+void mtc_segment_write_flt32_array(MtcSegment *seg, MtcValFlt *ptr, size_t n)
+{
+	size_t i;
 	
-	*block = val;
-	mtc_rcmem_ref(val.mem);
+	for (i = 0; i < n; i++)
+	{
+		uint32_t inter = mtc_val_flt_to_flt32(ptr[i]);
+		
+		mtc_uint32_copy_to_le(seg->bytes + i * 4, &inter);
+	}
+	seg->bytes += n * 4;
 }
 
-void mtc_segment_read_raw(MtcSegment *seg, MtcMBlock *val)
+void mtc_segment_read_flt32_array(MtcSegment *seg, MtcValFlt *ptr, size_t n)
 {
-	MtcMBlock *block;
+	size_t i;
 	
-	block = seg->blocks;
-	seg->blocks++;
+	for (i = 0; i < n; i++)
+	{
+		uint32_t inter;
+		
+		mtc_uint32_copy_from_le(seg->bytes + i * 4, &inter);
+		mtc_val_flt_from_flt32(inter, ptr + i);
+	}
+	seg->bytes += n * 4;
+}
+
+void mtc_segment_write_flt64_array(MtcSegment *seg, MtcValFlt *ptr, size_t n)
+{
+	size_t i;
 	
-	*val = *block;
-	mtc_rcmem_ref(block->mem);
+	for (i = 0; i < n; i++)
+	{
+		uint64_t inter = mtc_val_flt_to_flt64(ptr[i]);
+		
+		mtc_uint64_copy_to_le(seg->bytes + i * 8, &inter);
+	}
+	seg->bytes += n * 8;
 }
 
+void mtc_segment_read_flt64_array(MtcSegment *seg, MtcValFlt *ptr, size_t n)
+{
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+	{
+		uint64_t inter;
+		
+		mtc_uint64_copy_from_le(seg->bytes + i * 8, &inter);
+		mtc_val_flt_from_flt64(inter, ptr + i);
+	}
+	seg->bytes += n * 8;
+}
+
+//Strings
+
+void mtc_segment_write_string(MtcSegment *seg, char *val)
+{
+	mtc_segment_write_string_inline(seg, val);
+}
+
+void mtc_segment_write_rcstring(MtcSegment *seg, char *val)
+{
+	mtc_segment_write_rcstring_inline(seg, val);
+}
+
+//Places a copy of given memory in the heap of the dual stream
+static int mtc_dstream_heap_write
+	(MtcDStream *dstream, void *mem, size_t len, MtcMBlock *block)
+{
+	if (! dstream->heap || (size_t) (dstream->heap_lim - dstream->heap) < len)
+		return -1;
+	
+	memcpy(dstream->heap, mem, len);
+	block->mem = dstream->heap;
+	block->size = len;
+	block->parent = dstream->heap_parent;
+	mtc_rcmem_ref(dstream->heap_parent);
+	dstream->heap += len;
+	
+	return 0;
+}
+
+void mtc_string_write_heap(char *val, MtcSegment *seg, MtcDStream *dstream)
+{
+	if (mtc_dstream_heap_write(dstream, val, strlen(val) + 1, seg->blocks) 
+		< 0)
+	{
+		mtc_segment_write_string(seg, val);
+		return;
+	}
+	
+	seg->blocks++;
+}
+
+MtcDLen mtc_string_count_heap(char *val)
+{
+	MtcDLen res;
+	
+	res.n_bytes = 0;
+	res.n_blocks = 0;
+	res.n_heap = strlen(val) + 1;
+	
+	return res;
+}
+
+int mtc_segment_check_string(MtcSegment *seg)
+{
+	return mtc_segment_check_string_inline(seg);
+}
+
+int mtc_segment_check_strings(MtcSegment *seg, size_t n)
+{
+	MtcMBlock *block, *lim;
+	char *mem;
+	
+	block = seg->blocks;
+	lim = block + n;
+	
+	for (; block < lim; block++)
+	{
+		mem = (char *) block->mem;
+		if (! block->size || mem[block->size - 1] 
+			|| memchr(mem, 0, block->size - 1))
+			return -1;
+	}
+	
+	seg->blocks = lim;
+	
+	return 0;
+}
+
+const char *mtc_segment_view_string(MtcSegment *seg, size_t *len)
+{
+	MtcMBlock *block;
+	
+	block = seg->blocks;
+	seg->blocks++;
+	
+	*len = block->size - 1;
+	return (const char *) block->mem;
+}
+
+char *mtc_segment_get_string(MtcSegment *seg)
+{
+	return mtc_segment_get_string_inline(seg);
+}
+
+char *mtc_segment_read_string(MtcSegment *seg)
+{
+	return mtc_segment_read_string_inline(seg);
+}
+
+int mtc_segment_read_strings(MtcSegment *seg, char **res, size_t n)
+{
+	MtcSegment check_seg = *seg;
+	size_t i;
+	
+	//Verify all of them first, so that nothing needs to be undone
+	if (mtc_segment_check_strings(&check_seg, n) < 0)
+		return -1;
+	
+	for (i = 0; i < n; i++)
+		res[i] = mtc_segment_get_string(seg);
+	
+	return 0;
+}
+
+//'raw' type
+void mtc_segment_write_raw(MtcSegment *seg, MtcMBlock val)
+{
+	mtc_segment_write_raw_inline(seg, val);
+}
+
+void mtc_segment_read_raw(MtcSegment *seg, MtcMBlock *val)
+{
+	mtc_segment_read_raw_inline(seg, val);
+}
+
+void mtc_segment_view_raw(MtcSegment *seg, MtcMBlock *val)
+{
+	*val = *(seg->blocks);
+	seg->blocks++;
+}
+
+
+//Inline encoding for strings and 'raw' type
+MtcDLen mtc_string_count_inline(char *val, size_t threshold)
+{
+	MtcDLen res;
+	size_t len = strlen(val);
+	
+	if (len <= threshold)
+	{
+		res.n_bytes = len;
+		res.n_blocks = 0;
+		res.n_heap = 0;
+	}
+	else
+	{
+		res.n_bytes = 0;
+		res.n_blocks = 1;
+		res.n_heap = len + 1;
+	}
+	
+	return res;
+}
+
+static void mtc_string_write_inline_common
+	(char *val, size_t threshold, int borrow, 
+	 MtcSegment *seg, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	size_t len = strlen(val);
+	uint32_t header;
+	
+	if (len <= threshold)
+	{
+		header = (len << 1) | 1;
+		mtc_segment_write_uint32(seg, header);
+		mtc_dstream_get_segment(dstream, len, 0, &sub_seg);
+		memcpy(sub_seg.bytes, val, len);
+	}
+	else
+	{
+		header = 0;
+		mtc_segment_write_uint32(seg, header);
+		mtc_dstream_get_segment(dstream, 0, 1, &sub_seg);
+		if (borrow)
+			mtc_segment_write_rcstring(&sub_seg, val);
+		else
+			mtc_string_write_heap(val, &sub_seg, dstream);
+	}
+}
+
+void mtc_string_write_inline
+	(char *val, size_t threshold, MtcSegment *seg, MtcDStream *dstream)
+{
+	mtc_string_write_inline_common(val, threshold, 0, seg, dstream);
+}
+
+void mtc_rcstring_write_inline
+	(char *val, size_t threshold, MtcSegment *seg, MtcDStream *dstream)
+{
+	mtc_string_write_inline_common(val, threshold, 1, seg, dstream);
+}
+
+//Reads a string with inline encoding, reusing old if possible. 
+//The reference to old is always released.
+static char *mtc_string_read_inline_common
+	(MtcSegment *seg, MtcDStream *dstream, char *old)
+{
+	MtcSegment sub_seg;
+	uint32_t header;
+	size_t len;
+	char *res;
+	
+	mtc_segment_read_uint32(seg, header);
+	
+	if (! (header & 1))
+	{
+		res = NULL;
+		if (! header 
+			&& mtc_dstream_get_segment(dstream, 0, 1, &sub_seg) == 0)
+			res = mtc_segment_read_string(&sub_seg);
+		goto release;
+	}
+	
+	len = header >> 1;
+	if (mtc_dstream_get_segment(dstream, len, 0, &sub_seg) < 0)
+	{
+		res = NULL;
+		goto release;
+	}
+	if (memchr(sub_seg.bytes, 0, len))
+	{
+		res = NULL;
+		goto release;
+	}
+	
+	//Copy into the old string if nothing else uses it and it fits
+	if (old && mtc_rcmem_get_refcount(old) == 1 
+		&& mtc_rcmem_get_size(old) > len)
+	{
+		res = old;
+		old = NULL;
+	}
+	else
+	{
+		res = (char *) mtc_rcmem_alloc_cat(len + 1, MTC_ALLOC_CAT_STRING);
+	}
+	memcpy(res, sub_seg.bytes, len);
+	res[len] = 0;
+	
+release:
+	if (old)
+		mtc_rcmem_unref(old);
+	
+	return res;
+}
+
+char *mtc_string_read_inline(MtcSegment *seg, MtcDStream *dstream)
+{
+	return mtc_string_read_inline_common(seg, dstream, NULL);
+}
+
+char *mtc_string_read_inline_reuse
+	(MtcSegment *seg, MtcDStream *dstream, char *old)
+{
+	return mtc_string_read_inline_common(seg, dstream, old);
+}
+
+MtcDLen mtc_raw_count_inline(MtcMBlock val, size_t threshold)
+{
+	MtcDLen res;
+	
+	if (val.size <= threshold)
+	{
+		res.n_bytes = val.size;
+		res.n_blocks = 0;
+	}
+	else
+	{
+		res.n_bytes = 0;
+		res.n_blocks = 1;
+	}
+	res.n_heap = 0;
+	
+	return res;
+}
+
+void mtc_raw_write_inline
+	(MtcMBlock val, size_t threshold, MtcSegment *seg, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	uint32_t header;
+	
+	if (val.size <= threshold)
+	{
+		header = (val.size << 1) | 1;
+		mtc_segment_write_uint32(seg, header);
+		mtc_dstream_get_segment(dstream, val.size, 0, &sub_seg);
+		memcpy(sub_seg.bytes, val.mem, val.size);
+	}
+	else
+	{
+		header = 0;
+		mtc_segment_write_uint32(seg, header);
+		mtc_dstream_get_segment(dstream, 0, 1, &sub_seg);
+		mtc_segment_write_raw(&sub_seg, val);
+	}
+}
+
+int mtc_raw_read_inline
+	(MtcMBlock *val, MtcSegment *seg, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	uint32_t header;
+	size_t len;
+	
+	mtc_segment_read_uint32(seg, header);
+	
+	if (! (header & 1))
+	{
+		if (header)
+			return -1;
+		if (mtc_dstream_get_segment(dstream, 0, 1, &sub_seg) < 0)
+			return -1;
+		mtc_segment_read_raw(&sub_seg, val);
+		return 0;
+	}
+	
+	len = header >> 1;
+	if (mtc_dstream_get_segment(dstream, len, 0, &sub_seg) < 0)
+		return -1;
+	
+	*val = mtc_mblock_init(mtc_rcmem_alloc(len), len);
+	memcpy(val->mem, sub_seg.bytes, len);
+	
+	return 0;
+}
+
+//Checking and viewing values with inline encoding
+int mtc_string_check_inline(MtcSegment *seg, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	uint32_t header;
+	size_t len;
+	
+	mtc_segment_read_uint32(seg, header);
+	
+	if (! (header & 1))
+	{
+		if (header)
+			return -1;
+		if (mtc_dstream_get_segment(dstream, 0, 1, &sub_seg) < 0)
+			return -1;
+		return mtc_segment_check_string(&sub_seg);
+	}
+	
+	len = header >> 1;
+	if (mtc_dstream_get_segment(dstream, len, 0, &sub_seg) < 0)
+		return -1;
+	if (memchr(sub_seg.bytes, 0, len))
+		return -1;
+	
+	return 0;
+}
+
+const char *mtc_string_view_inline
+	(MtcSegment *seg, MtcDStream *dstream, size_t *len)
+{
+	MtcSegment sub_seg;
+	uint32_t header;
+	
+	mtc_segment_read_uint32(seg, header);
+	
+	if (! header)
+	{
+		mtc_dstream_get_segment(dstream, 0, 1, &sub_seg);
+		return mtc_segment_view_string(&sub_seg, len);
+	}
+	
+	*len = header >> 1;
+	mtc_dstream_get_segment(dstream, *len, 0, &sub_seg);
+	
+	return sub_seg.bytes;
+}
+
+int mtc_raw_check_inline(MtcSegment *seg, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	uint32_t header;
+	
+	mtc_segment_read_uint32(seg, header);
+	
+	if (! (header & 1))
+	{
+		if (header)
+			return -1;
+		return mtc_dstream_get_segment(dstream, 0, 1, &sub_seg);
+	}
+	
+	return mtc_dstream_get_segment(dstream, header >> 1, 0, &sub_seg);
+}
+
+void mtc_raw_view_inline
+	(MtcMBlock *val, MtcSegment *seg, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	uint32_t header;
+	
+	mtc_segment_read_uint32(seg, header);
+	
+	if (! header)
+	{
+		mtc_dstream_get_segment(dstream, 0, 1, &sub_seg);
+		mtc_segment_view_raw(&sub_seg, val);
+		return;
+	}
+	
+	val->size = header >> 1;
+	mtc_dstream_get_segment(dstream, val->size, 0, &sub_seg);
+	val->mem = sub_seg.bytes;
+	val->parent = dstream->bytes_parent;
+}
+
+//Variable length integers
+
+//Number of bytes needed to store a value
+static size_t mtc_varint_len(uint64_t val)
+{
+#ifdef __GNUC__
+	return (64 - __builtin_clzll(val | 1) + 6) / 7;
+#else
+	size_t len = 1;
+	
+	while (val >= 0x80)
+	{
+		val >>= 7;
+		len++;
+	}
+	
+	return len;
+#endif
+}
+
+//Encodes a value at ptr, returns the position after it
+static char *mtc_varint_encode(char *ptr, uint64_t val)
+{
+	while (val >= 0x80)
+	{
+		*(ptr++) = (char) ((val & 0x7f) | 0x80);
+		val >>= 7;
+	}
+	*(ptr++) = (char) val;
+	
+	return ptr;
+}
+
+//Decodes a value of at most max_bytes bytes at ptr, returns the
+//position after it or NULL if the value is malformed (including
+//non-minimal encodings with trailing zero bytes) or runs past lim.
+//When max_bytes bytes are left the loop does not need to check for 
+//the end; this is the common case and worth the duplication.
+static char *mtc_varint_decode
+	(char *ptr, char *lim, size_t max_bytes, uint64_t *val)
+{
+	uint64_t res;
+	unsigned char byte;
+	size_t i;
+	
+	if ((size_t) (lim - ptr) >= max_bytes)
+	{
+		byte = (unsigned char) *(ptr++);
+		if (! (byte & 0x80))
+		{
+			*val = byte;
+			return ptr;
+		}
+		
+		res = byte & 0x7f;
+		for (i = 1; i < max_bytes; i++)
+		{
+			byte = (unsigned char) *(ptr++);
+			res |= ((uint64_t) (byte & 0x7f)) << (7 * i);
+			if (! (byte & 0x80))
+				goto done;
+		}
+		
+		return NULL;
+	}
+	
+	res = 0;
+	for (i = 0; ptr < lim; i++)
+	{
+		byte = (unsigned char) *(ptr++);
+		res |= ((uint64_t) (byte & 0x7f)) << (7 * i);
+		if (! (byte & 0x80))
+			goto done;
+	}
+	
+	return NULL;
+	
+done:
+	//Encodings must be minimal, the last byte cannot be zero
+	if (i > 0 && ! byte)
+		return NULL;
+	//Last byte of a 64-bit value has room for one bit only
+	if (i == 9 && byte > 1)
+		return NULL;
+	
+	*val = res;
+	return ptr;
+}
+
+//Decodes n values of at most max_bytes bytes each from the dual stream
+//into a buffer of uint32_t (if max_bytes is MTC_VARINT32_MAX_BYTES)
+//or uint64_t. Single values are read using this too, so that 
+//mtc_varint_decode() is inlined at one place only.
+static int mtc_varint_decode_array
+	(void *ptr, size_t n, size_t max_bytes, MtcDStream *dstream)
+{
+	char *bytes = dstream->bytes, *lim = dstream->bytes_lim;
+	uint64_t val;
+	size_t i;
+	
+	//Every value takes at least one byte
+	if (n > (size_t) (lim - bytes))
+		return -1;
+	
+	for (i = 0; i < n; i++)
+	{
+		bytes = mtc_varint_decode(bytes, lim, max_bytes, &val);
+		if (! bytes)
+			return -1;
+		
+		if (max_bytes == MTC_VARINT32_MAX_BYTES)
+		{
+			if (val >> 32)
+				return -1;
+			((uint32_t *) ptr)[i] = val;
+		}
+		else
+		{
+			((uint64_t *) ptr)[i] = val;
+		}
+	}
+	
+	dstream->bytes = bytes;
+	return 0;
+}
+
+//Reads a single value, like mtc_varint_decode_array() with n = 1
+#define mtc_varint_read(ptr, max_bytes, dstream) \
+	(((dstream)->bytes < (dstream)->bytes_lim \
+	  && ! (*((dstream)->bytes) & 0x80)) \
+	 ? (*(ptr) = (unsigned char) *(((dstream)->bytes)++), 0) \
+	 : mtc_varint_decode_array((ptr), 1, (max_bytes), (dstream)))
+
+//Zigzag encoding of signed integers
+static uint32_t mtc_zigzag_encode32(int32_t val)
+{
+	uint32_t uval = mtc_int32_to_2_complement(val);
+	
+	return (uval << 1) ^ (0 - (uval >> 31));
+}
+
+static int32_t mtc_zigzag_decode32(uint32_t val)
+{
+	return mtc_int32_from_2_complement((val >> 1) ^ (0 - (val & 1)));
+}
+
+static uint64_t mtc_zigzag_encode64(int64_t val)
+{
+	uint64_t uval = mtc_int64_to_2_complement(val);
+	
+	return (uval << 1) ^ (0 - (uval >> 63));
+}
+
+static int64_t mtc_zigzag_decode64(uint64_t val)
+{
+	return mtc_int64_from_2_complement((val >> 1) ^ (0 - (val & 1)));
+}
+
+//Common parts of single value functions
+static MtcDLen mtc_varint_count(uint64_t val)
+{
+	MtcDLen res;
+	
+	res.n_bytes = mtc_varint_len(val);
+	res.n_blocks = 0;
+	res.n_heap = 0;
+	
+	return res;
+}
+
+static void mtc_varint_write(uint64_t val, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	size_t len = mtc_varint_len(val);
+	
+	//Same as taking a segment, but saves a call when there is room
+	if ((size_t) (dstream->bytes_lim - dstream->bytes) >= len)
+	{
+		dstream->bytes = mtc_varint_encode(dstream->bytes, val);
+		return;
+	}
+	
+	mtc_dstream_get_segment(dstream, len, 0, &sub_seg);
+	mtc_varint_encode(sub_seg.bytes, val);
+}
+
+//varuint32
+MtcDLen mtc_varuint32_count(uint32_t val)
+{
+	return mtc_varint_count(val);
+}
+
+void mtc_varuint32_write(uint32_t val, MtcDStream *dstream)
+{
+	mtc_varint_write(val, dstream);
+}
+
+int mtc_varuint32_read(uint32_t *val, MtcDStream *dstream)
+{
+	return mtc_varint_read(val, MTC_VARINT32_MAX_BYTES, dstream);
+}
+
+MtcDLen mtc_varuint32_count_array(uint32_t *ptr, size_t n)
+{
+	MtcDLen res = {0, 0, 0};
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		res.n_bytes += mtc_varint_len(ptr[i]);
+	
+	return res;
+}
+
+void mtc_varuint32_write_array(uint32_t *ptr, size_t n, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	size_t i;
+	
+	mtc_dstream_get_segment(dstream, 
+		mtc_varuint32_count_array(ptr, n).n_bytes, 0, &sub_seg);
+	for (i = 0; i < n; i++)
+		sub_seg.bytes = mtc_varint_encode(sub_seg.bytes, ptr[i]);
+}
+
+int mtc_varuint32_read_array(uint32_t *ptr, size_t n, MtcDStream *dstream)
+{
+	return mtc_varint_decode_array
+		(ptr, n, MTC_VARINT32_MAX_BYTES, dstream);
+}
+
+int mtc_varuint32_check(MtcDStream *dstream)
+{
+	uint32_t val;
+	
+	return mtc_varint_read(&val, MTC_VARINT32_MAX_BYTES, dstream);
+}
+
+//varuint64
+MtcDLen mtc_varuint64_count(uint64_t val)
+{
+	return mtc_varint_count(val);
+}
+
+void mtc_varuint64_write(uint64_t val, MtcDStream *dstream)
+{
+	mtc_varint_write(val, dstream);
+}
+
+int mtc_varuint64_read(uint64_t *val, MtcDStream *dstream)
+{
+	return mtc_varint_read(val, MTC_VARINT64_MAX_BYTES, dstream);
+}
+
+MtcDLen mtc_varuint64_count_array(uint64_t *ptr, size_t n)
+{
+	MtcDLen res = {0, 0, 0};
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		res.n_bytes += mtc_varint_len(ptr[i]);
+	
+	return res;
+}
+
+void mtc_varuint64_write_array(uint64_t *ptr, size_t n, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	size_t i;
+	
+	mtc_dstream_get_segment(dstream, 
+		mtc_varuint64_count_array(ptr, n).n_bytes, 0, &sub_seg);
+	for (i = 0; i < n; i++)
+		sub_seg.bytes = mtc_varint_encode(sub_seg.bytes, ptr[i]);
+}
+
+int mtc_varuint64_read_array(uint64_t *ptr, size_t n, MtcDStream *dstream)
+{
+	return mtc_varint_decode_array
+		(ptr, n, MTC_VARINT64_MAX_BYTES, dstream);
+}
+
+int mtc_varuint64_check(MtcDStream *dstream)
+{
+	uint64_t val;
+	
+	return mtc_varint_read(&val, MTC_VARINT64_MAX_BYTES, dstream);
+}
+
+//varint32
+MtcDLen mtc_varint32_count(int32_t val)
+{
+	return mtc_varint_count(mtc_zigzag_encode32(val));
+}
+
+void mtc_varint32_write(int32_t val, MtcDStream *dstream)
+{
+	mtc_varint_write(mtc_zigzag_encode32(val), dstream);
+}
+
+int mtc_varint32_read(int32_t *val, MtcDStream *dstream)
+{
+	uint32_t res;
+	
+	if (mtc_varint_read(&res, MTC_VARINT32_MAX_BYTES, dstream) < 0)
+		return -1;
+	*val = mtc_zigzag_decode32(res);
+	
+	return 0;
+}
+
+MtcDLen mtc_varint32_count_array(int32_t *ptr, size_t n)
+{
+	MtcDLen res = {0, 0, 0};
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		res.n_bytes += mtc_varint_len(mtc_zigzag_encode32(ptr[i]));
+	
+	return res;
+}
+
+void mtc_varint32_write_array(int32_t *ptr, size_t n, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	size_t i;
+	
+	mtc_dstream_get_segment(dstream, 
+		mtc_varint32_count_array(ptr, n).n_bytes, 0, &sub_seg);
+	for (i = 0; i < n; i++)
+		sub_seg.bytes = mtc_varint_encode
+			(sub_seg.bytes, mtc_zigzag_encode32(ptr[i]));
+}
+
+int mtc_varint32_read_array(int32_t *ptr, size_t n, MtcDStream *dstream)
+{
+	uint32_t *uptr = (uint32_t *) ptr;
+	size_t i;
+	
+	//Decode in place
+	if (mtc_varint_decode_array
+		(uptr, n, MTC_VARINT32_MAX_BYTES, dstream) < 0)
+		return -1;
+	for (i = 0; i < n; i++)
+		ptr[i] = mtc_zigzag_decode32(uptr[i]);
+	
+	return 0;
+}
+
+int mtc_varint32_check(MtcDStream *dstream)
+{
+	uint32_t val;
+	
+	return mtc_varint_read(&val, MTC_VARINT32_MAX_BYTES, dstream);
+}
+
+//varint64
+MtcDLen mtc_varint64_count(int64_t val)
+{
+	return mtc_varint_count(mtc_zigzag_encode64(val));
+}
+
+void mtc_varint64_write(int64_t val, MtcDStream *dstream)
+{
+	mtc_varint_write(mtc_zigzag_encode64(val), dstream);
+}
+
+int mtc_varint64_read(int64_t *val, MtcDStream *dstream)
+{
+	uint64_t res;
+	
+	if (mtc_varint_read(&res, MTC_VARINT64_MAX_BYTES, dstream) < 0)
+		return -1;
+	*val = mtc_zigzag_decode64(res);
+	
+	return 0;
+}
+
+MtcDLen mtc_varint64_count_array(int64_t *ptr, size_t n)
+{
+	MtcDLen res = {0, 0, 0};
+	size_t i;
+	
+	for (i = 0; i < n; i++)
+		res.n_bytes += mtc_varint_len(mtc_zigzag_encode64(ptr[i]));
+	
+	return res;
+}
+
+void mtc_varint64_write_array(int64_t *ptr, size_t n, MtcDStream *dstream)
+{
+	MtcSegment sub_seg;
+	size_t i;
+	
+	mtc_dstream_get_segment(dstream, 
+		mtc_varint64_count_array(ptr, n).n_bytes, 0, &sub_seg);
+	for (i = 0; i < n; i++)
+		sub_seg.bytes = mtc_varint_encode
+			(sub_seg.bytes, mtc_zigzag_encode64(ptr[i]));
+}
+
+int mtc_varint64_read_array(int64_t *ptr, size_t n, MtcDStream *dstream)
+{
+	uint64_t *uptr = (uint64_t *) ptr;
+	size_t i;
+	
+	//Decode in place
+	if (mtc_varint_decode_array
+		(uptr, n, MTC_VARINT64_MAX_BYTES, dstream) < 0)
+		return -1;
+	for (i = 0; i < n; i++)
+		ptr[i] = mtc_zigzag_decode64(uptr[i]);
+	
+	return 0;
+}
+
+int mtc_varint64_check(MtcDStream *dstream)
+{
+	uint64_t val;
+	
+	return mtc_varint_read(&val, MTC_VARINT64_MAX_BYTES, dstream);
+}
@@ -54,13 +54,27 @@ typedef struct
 	size_t n_bytes;
 	///No. of blocks in 'block stream'
 	size_t n_blocks;
+	///No. of bytes of block contents to be copied into the message
+	///heap, see mtc_msg_new_with_heap()
+	size_t n_heap;
 } MtcDLen;
 
 /**Initializes the counter
  * \param self A pointer to structure of type MtcDLen
  */
 #define mtc_dlen_zero(self) \
-	(self)->n_bytes = (self)->n_blocks = 0
+	(self)->n_bytes = (self)->n_blocks = (self)->n_heap = 0
+
+typedef struct _MtcDStreamChunk MtcDStreamChunk;
+
+/**Storage for a 'dual stream' that grows as segments are taken from it,
+ * see mtc_dstream_init_growable(). Members are private.
+ */
+typedef struct
+{
+	MtcDStreamChunk *bytes_head, *bytes_tail;
+	MtcDStreamChunk *blocks_head, *blocks_tail;
+} MtcDStreamChunks;
 
 /**A structure to iterate over 'dual stream'. This can be used in
  * [de]serialization. 
@@ -72,10 +86,23 @@ typedef struct
 	char *bytes;
 	///A pointer that points just after the last byte in byte stream
 	char *bytes_lim;
+	///Reference counted memory containing the byte stream, 
+	///NULL if it is not known
+	void *bytes_parent;
 	///Current position in block stream
 	MtcMBlock *blocks;
 	///A pointer that points just after the last block in block stream
 	MtcMBlock *blocks_lim;
+	///Current position in the heap, where contents of blocks can be
+	///placed. NULL if there is no heap.
+	char *heap;
+	///A pointer that points just after the end of the heap
+	char *heap_lim;
+	///Reference counted memory containing the heap
+	void *heap_parent;
+	///Storage used to grow the 'dual stream' when a segment does not
+	///fit, NULL if the 'dual stream' cannot grow.
+	MtcDStreamChunks *chunks;
 } MtcDStream;
 
 /**A segment of 'dual stream'
@@ -99,6 +126,16 @@ int mtc_dstream_get_segment
 	(MtcDStream *self, size_t n_bytes, size_t n_blocks, 
 	 MtcSegment *res);
 
+/**Initializes a 'dual stream' for writing without knowing its size
+ * in advance. Segments are taken from chunks of memory that are
+ * allocated as needed, so serialization needs only one pass.
+ * Use mtc_dstream_finish_growable() to get the message.
+ * \param self The 'dual stream' to initialize
+ * \param chunks Storage for the chunks, must stay valid until
+ *        mtc_dstream_finish_growable() is called
+ */
+void mtc_dstream_init_growable(MtcDStream *self, MtcDStreamChunks *chunks);
+
 /**Determines whether the 'dual stream' is empty.*/
 #define mtc_dstream_is_empty(self) \
 	(((self)->bytes_lim - (self)->bytes) \
@@ -324,6 +361,289 @@ do { \
 
 #endif
 
+//Booleans
+/**Stores a boolean value as a byte holding 0 or 1 to the current 
+ * segment position and increments it accordingly. Up to 7 more 
+ * boolean values can be packed into the same byte using 
+ * mtc_segment_write_bit().
+ * \param seg Pointer to the segment (type MtcSegment *)
+ * \param val Value to store, any nonzero value is true
+ */
+#define mtc_segment_write_bool(seg, val) \
+do { \
+	*((seg)->bytes) = (val) ? 1 : 0; \
+	(seg)->bytes += 1; \
+} while (0)
+
+/**Packs a boolean value into the byte just before the current segment 
+ * position, which must have been stored using mtc_segment_write_bool().
+ * The position is not changed.
+ * \param seg Pointer to the segment (type MtcSegment *)
+ * \param val Value to store, any nonzero value is true
+ * \param bit Position of the value in the byte, from 1 to 7
+ */
+#define mtc_segment_write_bit(seg, val, bit) \
+do { \
+	if (val) \
+		(seg)->bytes[-1] |= 1 << (bit); \
+} while (0)
+
+/**Retrieves a boolean value stored using mtc_segment_write_bool()
+ * from the current segment position and increments it accordingly.
+ * \param seg Pointer to the segment (type MtcSegment *)
+ * \param lval Variable of type unsigned char to store the result
+ */
+#define mtc_segment_read_bool(seg, lval) \
+do { \
+	lval = *((seg)->bytes) & 1; \
+	(seg)->bytes += 1; \
+} while (0)
+
+/**Retrieves a boolean value stored using mtc_segment_write_bit()
+ * from the byte just before the current segment position. 
+ * The position is not changed.
+ * \param seg Pointer to the segment (type MtcSegment *)
+ * \param lval Variable of type unsigned char to store the result
+ * \param bit Position of the value in the byte, from 1 to 7
+ */
+#define mtc_segment_read_bit(seg, lval, bit) \
+do { \
+	lval = (((unsigned char *) (seg)->bytes)[-1] >> (bit)) & 1; \
+} while (0)
+
+/**Stores an array of boolean values at current segment position
+ * as a bitset of (n + 7) / 8 bytes, least significant bit first, 
+ * and increments the position accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Pointer to the array, any nonzero value is true
+ * \param n Number of elements in the array
+ */
+void mtc_segment_write_bool_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n);
+
+/**Retrieves an array of boolean values stored using 
+ * mtc_segment_write_bool_array() from current segment position
+ * and increments the position accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Pointer to the array, set to 0 or 1
+ * \param n Number of elements in the array
+ */
+void mtc_segment_read_bool_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n);
+
+//Enumerations
+/**Retrieves a value of an enumeration with up to 256 values from
+ * current segment position and increments the position accordingly.
+ * \param seg Pointer to the segment
+ * \param res Return location for the value
+ * \param n_values Number of values in the enumeration
+ * \return 0 on success, -1 if the value is out of range
+ */
+int mtc_segment_read_enum8
+	(MtcSegment *seg, unsigned char *res, uint32_t n_values);
+
+/**Retrieves a value of an enumeration with up to 65536 values from
+ * current segment position and increments the position accordingly.
+ * \param seg Pointer to the segment
+ * \param res Return location for the value
+ * \param n_values Number of values in the enumeration
+ * \return 0 on success, -1 if the value is out of range
+ */
+int mtc_segment_read_enum16
+	(MtcSegment *seg, uint16_t *res, uint32_t n_values);
+
+/**Retrieves a value of an enumeration from current segment position
+ * and increments the position accordingly.
+ * \param seg Pointer to the segment
+ * \param res Return location for the value
+ * \param n_values Number of values in the enumeration
+ * \return 0 on success, -1 if the value is out of range
+ */
+int mtc_segment_read_enum32
+	(MtcSegment *seg, uint32_t *res, uint32_t n_values);
+
+/**Checks a value of an enumeration with up to 256 values at current 
+ * segment position without retrieving it, and increments the position 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param n_values Number of values in the enumeration
+ * \return 0 if the value is valid, -1 otherwise
+ */
+int mtc_segment_check_enum8(MtcSegment *seg, uint32_t n_values);
+
+/**Checks a value of an enumeration with up to 65536 values at current 
+ * segment position without retrieving it, and increments the position 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param n_values Number of values in the enumeration
+ * \return 0 if the value is valid, -1 otherwise
+ */
+int mtc_segment_check_enum16(MtcSegment *seg, uint32_t n_values);
+
+/**Checks a value of an enumeration at current segment position 
+ * without retrieving it, and increments the position accordingly.
+ * \param seg Pointer to the segment
+ * \param n_values Number of values in the enumeration
+ * \return 0 if the value is valid, -1 otherwise
+ */
+int mtc_segment_check_enum32(MtcSegment *seg, uint32_t n_values);
+
+//Arrays of integers
+/**Stores an array of bytes at current segment position and 
+ * increments it accordingly. This is a single memcpy().
+ * \param seg Pointer to the segment
+ * \param ptr The bytes to store
+ * \param n Number of bytes
+ */
+void mtc_segment_write_uchar_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n);
+
+/**Retrieves an array of bytes from current segment position and 
+ * increments it accordingly. This is a single memcpy().
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the bytes
+ * \param n Number of bytes
+ */
+void mtc_segment_read_uchar_array
+	(MtcSegment *seg, unsigned char *ptr, size_t n);
+
+/**Stores an array of 16-bit unsigned integers at current segment
+ * position in little endian byte order and increments it accordingly.
+ * On little endian hosts this is a single memcpy().
+ * \param seg Pointer to the segment
+ * \param ptr The integers to store
+ * \param n Number of integers
+ */
+void mtc_segment_write_uint16_array(MtcSegment *seg, uint16_t *ptr, size_t n);
+
+/**Stores an array of 32-bit unsigned integers at current segment
+ * position in little endian byte order and increments it accordingly.
+ * On little endian hosts this is a single memcpy().
+ * \param seg Pointer to the segment
+ * \param ptr The integers to store
+ * \param n Number of integers
+ */
+void mtc_segment_write_uint32_array(MtcSegment *seg, uint32_t *ptr, size_t n);
+
+/**Stores an array of 64-bit unsigned integers at current segment
+ * position in little endian byte order and increments it accordingly.
+ * On little endian hosts this is a single memcpy().
+ * \param seg Pointer to the segment
+ * \param ptr The integers to store
+ * \param n Number of integers
+ */
+void mtc_segment_write_uint64_array(MtcSegment *seg, uint64_t *ptr, size_t n);
+
+/**Retrieves an array of 16-bit unsigned integers from current segment
+ * position, converting them to host byte order, and increments it 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the integers
+ * \param n Number of integers
+ */
+void mtc_segment_read_uint16_array(MtcSegment *seg, uint16_t *ptr, size_t n);
+
+/**Retrieves an array of 32-bit unsigned integers from current segment
+ * position, converting them to host byte order, and increments it 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the integers
+ * \param n Number of integers
+ */
+void mtc_segment_read_uint32_array(MtcSegment *seg, uint32_t *ptr, size_t n);
+
+/**Retrieves an array of 64-bit unsigned integers from current segment
+ * position, converting them to host byte order, and increments it 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the integers
+ * \param n Number of integers
+ */
+void mtc_segment_read_uint64_array(MtcSegment *seg, uint64_t *ptr, size_t n);
+
+#ifdef MTC_INT_2_COMPLEMENT
+#define mtc_segment_write_char_array(seg, ptr, n) \
+	mtc_segment_write_uchar_array((seg), (unsigned char *) (ptr), (n))
+#define mtc_segment_read_char_array(seg, ptr, n) \
+	mtc_segment_read_uchar_array((seg), (unsigned char *) (ptr), (n))
+#define mtc_segment_write_int16_array(seg, ptr, n) \
+	mtc_segment_write_uint16_array((seg), (uint16_t *) (ptr), (n))
+#define mtc_segment_write_int32_array(seg, ptr, n) \
+	mtc_segment_write_uint32_array((seg), (uint32_t *) (ptr), (n))
+#define mtc_segment_write_int64_array(seg, ptr, n) \
+	mtc_segment_write_uint64_array((seg), (uint64_t *) (ptr), (n))
+#define mtc_segment_read_int16_array(seg, ptr, n) \
+	mtc_segment_read_uint16_array((seg), (uint16_t *) (ptr), (n))
+#define mtc_segment_read_int32_array(seg, ptr, n) \
+	mtc_segment_read_uint32_array((seg), (uint32_t *) (ptr), (n))
+#define mtc_segment_read_int64_array(seg, ptr, n) \
+	mtc_segment_read_uint64_array((seg), (uint64_t *) (ptr), (n))
+#else
+/**Stores an array of characters at current segment position and
+ * increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr The characters to store
+ * \param n Number of characters
+ */
+void mtc_segment_write_char_array(MtcSegment *seg, char *ptr, size_t n);
+
+/**Retrieves an array of characters from current segment position
+ * and increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the characters
+ * \param n Number of characters
+ */
+void mtc_segment_read_char_array(MtcSegment *seg, char *ptr, size_t n);
+
+/**Stores an array of 16-bit signed integers at current segment
+ * position and increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr The integers to store
+ * \param n Number of integers
+ */
+void mtc_segment_write_int16_array(MtcSegment *seg, int16_t *ptr, size_t n);
+
+/**Stores an array of 32-bit signed integers at current segment
+ * position and increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr The integers to store
+ * \param n Number of integers
+ */
+void mtc_segment_write_int32_array(MtcSegment *seg, int32_t *ptr, size_t n);
+
+/**Stores an array of 64-bit signed integers at current segment
+ * position and increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr The integers to store
+ * \param n Number of integers
+ */
+void mtc_segment_write_int64_array(MtcSegment *seg, int64_t *ptr, size_t n);
+
+/**Retrieves an array of 16-bit signed integers from current segment
+ * position and increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the integers
+ * \param n Number of integers
+ */
+void mtc_segment_read_int16_array(MtcSegment *seg, int16_t *ptr, size_t n);
+
+/**Retrieves an array of 32-bit signed integers from current segment
+ * position and increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the integers
+ * \param n Number of integers
+ */
+void mtc_segment_read_int32_array(MtcSegment *seg, int32_t *ptr, size_t n);
+
+/**Retrieves an array of 64-bit signed integers from current segment
+ * position and increments it accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the integers
+ * \param n Number of integers
+ */
+void mtc_segment_read_int64_array(MtcSegment *seg, int64_t *ptr, size_t n);
+#endif
+
 /**Structure that you can use to portably store any floating point value
  * that IEEE 754 supports.
  * MDL type flt32 and flt64 map to this type.
@@ -367,6 +687,42 @@ void mtc_segment_write_flt64(MtcSegment *seg, MtcValFlt val);
  */
 void mtc_segment_read_flt64(MtcSegment *seg, MtcValFlt *val);
 
+/**Stores an array of floating point values at current segment 
+ * position in IEEE 754 32-bit format and increments the position 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr The values to store
+ * \param n Number of values
+ */
+void mtc_segment_write_flt32_array(MtcSegment *seg, MtcValFlt *ptr, size_t n);
+
+/**Retrieves an array of floating point values from current segment 
+ * position in IEEE 754 32-bit format and increments the position 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the values
+ * \param n Number of values
+ */
+void mtc_segment_read_flt32_array(MtcSegment *seg, MtcValFlt *ptr, size_t n);
+
+/**Stores an array of floating point values at current segment 
+ * position in IEEE 754 64-bit format and increments the position 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr The values to store
+ * \param n Number of values
+ */
+void mtc_segment_write_flt64_array(MtcSegment *seg, MtcValFlt *ptr, size_t n);
+
+/**Retrieves an array of floating point values from current segment 
+ * position in IEEE 754 64-bit format and increments the position 
+ * accordingly.
+ * \param seg Pointer to the segment
+ * \param ptr Location to store the values
+ * \param n Number of values
+ */
+void mtc_segment_read_flt64_array(MtcSegment *seg, MtcValFlt *ptr, size_t n);
+
 /**Adds a null-terminated string to the current segment position 
  * and increments the segment accordingly.
  * \param seg Pointer to the segment.
@@ -374,14 +730,93 @@ void mtc_segment_read_flt64(MtcSegment *seg, MtcValFlt *val);
  */
 void mtc_segment_write_string(MtcSegment *seg, char *val);
 
+/**Adds a null-terminated string held in reference counted memory
+ * to the current segment position and increments the segment 
+ * accordingly. The string is referenced instead of being copied.
+ * Strings returned by mtc_segment_read_string() and mtc_rcmem_strdup()
+ * can be passed here.
+ * \param seg Pointer to the segment.
+ * \param val The null-terminated string to add, must point to the 
+ *        start of reference counted memory
+ */
+void mtc_segment_write_rcstring(MtcSegment *seg, char *val);
+
+/**Adds a null-terminated string to the current segment position 
+ * and increments the segment accordingly. If the dual stream has a
+ * heap with enough space left, the string is copied into the heap and
+ * the block refers to it, otherwise this is same as 
+ * mtc_segment_write_string().
+ * \param val The null-terminated string to add
+ * \param seg Pointer to the segment.
+ * \param dstream The dual stream
+ */
+void mtc_string_write_heap(char *val, MtcSegment *seg, MtcDStream *dstream);
+
+/**Counts the heap space needed by mtc_string_write_heap() for a string.
+ * Base size of the string remains {0, 1}.
+ * \param val The null-terminated string
+ * \return Dynamic size of the string
+ */
+MtcDLen mtc_string_count_heap(char *val);
+
 /**Retrieves a null-terminated string from the current segment position 
  * and increments the segment accordingly.
+ * 
+ * The string is the reference counted memory of its block, with a new
+ * reference. If the block is a slice, as in messages created by 
+ * mtc_msg_try_new_allocd() or mtc_msg_new_with_heap(), the string is
+ * copied into new reference counted memory instead.
  * \param seg Pointer to the segment.
  * \return The string just read off or NULL if operation failed. 
- *         Use free() to free it. 
+ *         Use mtc_rcmem_unref() to free it. 
  */
 char *mtc_segment_read_string(MtcSegment *seg);
 
+/**Checks a null-terminated string at the current segment position 
+ * the way mtc_segment_read_string() does, without retrieving it, and 
+ * increments the segment accordingly.
+ * \param seg Pointer to the segment.
+ * \return 0 if the string is valid, -1 otherwise
+ */
+int mtc_segment_check_string(MtcSegment *seg);
+
+/**Checks n null-terminated strings at the current segment position 
+ * like mtc_segment_check_string() does for each of them, and 
+ * increments the segment past them if all are valid.
+ * \param seg Pointer to the segment.
+ * \param n Number of strings
+ * \return 0 if all strings are valid, -1 otherwise
+ */
+int mtc_segment_check_strings(MtcSegment *seg, size_t n);
+
+/**Retrieves n null-terminated strings from the current segment 
+ * position like mtc_segment_read_string() does. All of them are 
+ * checked before any is retrieved.
+ * \param seg Pointer to the segment.
+ * \param res Return location for the strings
+ * \param n Number of strings
+ * \return 0 on success, -1 if any string is invalid, in which case 
+ *         nothing is retrieved.
+ */
+int mtc_segment_read_strings(MtcSegment *seg, char **res, size_t n);
+
+/**Retrieves a null-terminated string from the current segment position 
+ * that has been checked using mtc_segment_check_string() or 
+ * mtc_segment_check_strings(), and increments the segment accordingly.
+ * \param seg Pointer to the segment.
+ * \return The string
+ */
+char *mtc_segment_get_string(MtcSegment *seg);
+
+/**Gets a string at the current segment position without copying or
+ * referencing it and increments the segment accordingly. The string 
+ * must have been checked using mtc_segment_check_string().
+ * \param seg Pointer to the segment.
+ * \param len Return location for the length of the string
+ * \return The string, valid as long as the block holding it
+ */
+const char *mtc_segment_view_string(MtcSegment *seg, size_t *len);
+
 /**Stores a _raw_ type in the current segment position and increments 
  * the segment's positions accordingly. 
  * \param seg Pointer to the segment
@@ -396,4 +831,357 @@ void mtc_segment_write_raw(MtcSegment *seg, MtcMBlock val);
  */
 void mtc_segment_read_raw(MtcSegment *seg, MtcMBlock *val);
 
+/**Retrives a _raw_ type from the current segment position without 
+ * referencing it and increments the segment's positions accordingly. 
+ * \param seg Pointer to the segment
+ * \param val Return location for the value, valid as long as
+ *        the block holding it
+ */
+void mtc_segment_view_raw(MtcSegment *seg, MtcMBlock *val);
+
+/* Inline encoding for strings and raw values:
+ * 
+ * The base part is a 32-bit header. If its lowest bit is set, the
+ * remaining bits give the length of the data and the data follows
+ * inline in the byte stream. If the header is 0, the data is carried
+ * by one block from the block stream, exactly as 
+ * mtc_segment_write_string() and mtc_segment_write_raw() would do.
+ * Strings are stored inline without the terminating null character.
+ */
+
+/**Counts the dynamic size of a null-terminated string stored with
+ * inline encoding. Base size of the string is {4, 0}.
+ * \param val The null-terminated string
+ * \param threshold Strings of length upto threshold bytes 
+ *        (excluding the null character) are stored inline
+ * \return Dynamic size of the string
+ */
+MtcDLen mtc_string_count_inline(char *val, size_t threshold);
+
+/**Serializes a null-terminated string using inline encoding.
+ * \param val The null-terminated string to add
+ * \param threshold Must be the same as passed to 
+ *        mtc_string_count_inline()
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_string_write_inline
+	(char *val, size_t threshold, MtcSegment *seg, MtcDStream *dstream);
+
+/**Serializes a null-terminated string held in reference counted 
+ * memory using inline encoding. Same as mtc_string_write_inline(),
+ * but if the string is not inlined it is referenced instead of 
+ * being copied, like mtc_segment_write_rcstring().
+ * \param val The null-terminated string to add
+ * \param threshold Must be the same as passed to 
+ *        mtc_string_count_inline()
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_rcstring_write_inline
+	(char *val, size_t threshold, MtcSegment *seg, MtcDStream *dstream);
+
+/**Deserializes a null-terminated string stored with inline encoding.
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ * \return The string just read off (reference counted memory)
+ *         or NULL if operation failed.
+ */
+char *mtc_string_read_inline(MtcSegment *seg, MtcDStream *dstream);
+
+/**Deserializes a null-terminated string stored with inline encoding,
+ * reusing the memory of a previously deserialized string if the 
+ * string is inlined and it fits.
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ * \param old String to reuse, or NULL. The reference to it is always
+ *        released.
+ * \return The string just read off (reference counted memory)
+ *         or NULL if operation failed.
+ */
+char *mtc_string_read_inline_reuse
+	(MtcSegment *seg, MtcDStream *dstream, char *old);
+
+/**Counts the dynamic size of a _raw_ value stored with
+ * inline encoding. Base size of the value is {4, 0}.
+ * \param val The value
+ * \param threshold Values of size upto threshold bytes are 
+ *        stored inline
+ * \return Dynamic size of the value
+ */
+MtcDLen mtc_raw_count_inline(MtcMBlock val, size_t threshold);
+
+/**Serializes a _raw_ value using inline encoding.
+ * \param val The value to store
+ * \param threshold Must be the same as passed to 
+ *        mtc_raw_count_inline()
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_raw_write_inline
+	(MtcMBlock val, size_t threshold, MtcSegment *seg, MtcDStream *dstream);
+
+/**Deserializes a _raw_ value stored with inline encoding.
+ * \param val Return location for the value
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ * \return 0 on success, -1 if operation failed.
+ */
+int mtc_raw_read_inline
+	(MtcMBlock *val, MtcSegment *seg, MtcDStream *dstream);
+
+/**Checks a string stored with inline encoding the way 
+ * mtc_string_read_inline() does, without deserializing it.
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ * \return 0 if the string is valid, -1 otherwise
+ */
+int mtc_string_check_inline(MtcSegment *seg, MtcDStream *dstream);
+
+/**Gets a string stored with inline encoding without copying or 
+ * referencing it. The string must have been checked using 
+ * mtc_string_check_inline(). Inlined strings are not null-terminated.
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ * \param len Return location for the length of the string
+ * \return The characters of the string, valid as long as the 
+ *         message holding them
+ */
+const char *mtc_string_view_inline
+	(MtcSegment *seg, MtcDStream *dstream, size_t *len);
+
+/**Checks a _raw_ value stored with inline encoding the way 
+ * mtc_raw_read_inline() does, without deserializing it.
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ * \return 0 if the value is valid, -1 otherwise
+ */
+int mtc_raw_check_inline(MtcSegment *seg, MtcDStream *dstream);
+
+/**Gets a _raw_ value stored with inline encoding without copying or
+ * referencing it. The value must have been checked using 
+ * mtc_raw_check_inline().
+ * \param val Return location for the value, valid as long as the 
+ *        message holding it. If it was inlined its parent is the
+ *        memory holding the byte stream, so it can be referenced
+ *        with mtc_mblock_ref() to keep it longer.
+ * \param seg Current segment
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_raw_view_inline
+	(MtcMBlock *val, MtcSegment *seg, MtcDStream *dstream);
+
+/* Variable length integers:
+ * 
+ * varuint32 and varuint64 values are stored as unsigned LEB128, 
+ * 7 bits per byte starting from the least significant ones, with the
+ * highest bit of each byte set if more bytes follow. varint32 and 
+ * varint64 values are zigzag encoded first (0, -1, 1, -2... map to 
+ * 0, 1, 2, 3...) so that small negative values are short too.
+ * Every value has exactly one valid encoding, the shortest one:
+ * readers reject encodings ending with a zero byte, like 0x80 0x00.
+ * 
+ * These types have no base part. The encoded value is taken from 
+ * the dual stream as a dynamic segment, the reading functions 
+ * decode it directly from the byte stream.
+ */
+
+///Maximum length of an encoded varuint32 or varint32
+#define MTC_VARINT32_MAX_BYTES 5
+
+///Maximum length of an encoded varuint64 or varint64
+#define MTC_VARINT64_MAX_BYTES 10
+
+/**Gets the number of bytes left in the byte stream of a 'dual stream'.*/
+#define mtc_dstream_bytes_left(self) \
+	((size_t) ((self)->bytes_lim - (self)->bytes))
+
+/**Counts the dynamic size of a varuint32 value.
+ * \param val The value
+ * \return Dynamic size of the value
+ */
+MtcDLen mtc_varuint32_count(uint32_t val);
+
+/**Serializes a varuint32 value.
+ * \param val The value to store
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varuint32_write(uint32_t val, MtcDStream *dstream);
+
+/**Deserializes a varuint32 value.
+ * \param val Return location for the value
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varuint32_read(uint32_t *val, MtcDStream *dstream);
+
+/**Counts the dynamic size of an array of varuint32 values.
+ * \param ptr The values
+ * \param n Number of values
+ * \return Dynamic size of the values
+ */
+MtcDLen mtc_varuint32_count_array(uint32_t *ptr, size_t n);
+
+/**Serializes an array of varuint32 values into a single segment.
+ * \param ptr The values to store
+ * \param n Number of values
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varuint32_write_array(uint32_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Deserializes an array of varuint32 values.
+ * \param ptr Location to store the values
+ * \param n Number of values
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if a value is malformed or truncated.
+ */
+int mtc_varuint32_read_array(uint32_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Checks a varuint32 value without deserializing it, skipping over it.
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varuint32_check(MtcDStream *dstream);
+
+/**Counts the dynamic size of a varuint64 value.
+ * \param val The value
+ * \return Dynamic size of the value
+ */
+MtcDLen mtc_varuint64_count(uint64_t val);
+
+/**Serializes a varuint64 value.
+ * \param val The value to store
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varuint64_write(uint64_t val, MtcDStream *dstream);
+
+/**Deserializes a varuint64 value.
+ * \param val Return location for the value
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varuint64_read(uint64_t *val, MtcDStream *dstream);
+
+/**Counts the dynamic size of an array of varuint64 values.
+ * \param ptr The values
+ * \param n Number of values
+ * \return Dynamic size of the values
+ */
+MtcDLen mtc_varuint64_count_array(uint64_t *ptr, size_t n);
+
+/**Serializes an array of varuint64 values into a single segment.
+ * \param ptr The values to store
+ * \param n Number of values
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varuint64_write_array(uint64_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Deserializes an array of varuint64 values.
+ * \param ptr Location to store the values
+ * \param n Number of values
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if a value is malformed or truncated.
+ */
+int mtc_varuint64_read_array(uint64_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Checks a varuint64 value without deserializing it, skipping over it.
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varuint64_check(MtcDStream *dstream);
+
+/**Counts the dynamic size of a varint32 value.
+ * \param val The value
+ * \return Dynamic size of the value
+ */
+MtcDLen mtc_varint32_count(int32_t val);
+
+/**Serializes a varint32 value.
+ * \param val The value to store
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varint32_write(int32_t val, MtcDStream *dstream);
+
+/**Deserializes a varint32 value.
+ * \param val Return location for the value
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varint32_read(int32_t *val, MtcDStream *dstream);
+
+/**Counts the dynamic size of an array of varint32 values.
+ * \param ptr The values
+ * \param n Number of values
+ * \return Dynamic size of the values
+ */
+MtcDLen mtc_varint32_count_array(int32_t *ptr, size_t n);
+
+/**Serializes an array of varint32 values into a single segment.
+ * \param ptr The values to store
+ * \param n Number of values
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varint32_write_array(int32_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Deserializes an array of varint32 values.
+ * \param ptr Location to store the values
+ * \param n Number of values
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if a value is malformed or truncated.
+ */
+int mtc_varint32_read_array(int32_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Checks a varint32 value without deserializing it, skipping over it.
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varint32_check(MtcDStream *dstream);
+
+/**Counts the dynamic size of a varint64 value.
+ * \param val The value
+ * \return Dynamic size of the value
+ */
+MtcDLen mtc_varint64_count(int64_t val);
+
+/**Serializes a varint64 value.
+ * \param val The value to store
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varint64_write(int64_t val, MtcDStream *dstream);
+
+/**Deserializes a varint64 value.
+ * \param val Return location for the value
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varint64_read(int64_t *val, MtcDStream *dstream);
+
+/**Counts the dynamic size of an array of varint64 values.
+ * \param ptr The values
+ * \param n Number of values
+ * \return Dynamic size of the values
+ */
+MtcDLen mtc_varint64_count_array(int64_t *ptr, size_t n);
+
+/**Serializes an array of varint64 values into a single segment.
+ * \param ptr The values to store
+ * \param n Number of values
+ * \param dstream The dual stream to take the dynamic part from
+ */
+void mtc_varint64_write_array(int64_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Deserializes an array of varint64 values.
+ * \param ptr Location to store the values
+ * \param n Number of values
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if a value is malformed or truncated.
+ */
+int mtc_varint64_read_array(int64_t *ptr, size_t n, MtcDStream *dstream);
+
+/**Checks a varint64 value without deserializing it, skipping over it.
+ * \param dstream The dual stream to read from
+ * \return 0 on success, -1 if the value is malformed or truncated.
+ */
+int mtc_varint64_check(MtcDStream *dstream);
+
 ///\}
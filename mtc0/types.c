@@ -228,6 +228,80 @@ int64_t mtc_int64_from_2_complement(uint64_t val)
 }
 #endif
 
+#ifdef MTC_FLT_IEEE754
+//float and double are already in IEEE 754 form, so only NaN and 
+//negative zero have to be converted to the forms used by the portable
+//conversions below
+
+//Returns a 32-bit integer representing the given float value.
+uint32_t mtc_float_to_flt32(float v)
+{
+	uint32_t res;
+	
+	memcpy(&res, &v, 4);
+	
+	//NaN
+	if ((res & 0x7f800000) == 0x7f800000 && (res & 0x007fffff))
+		return 0x7fffffff;
+	//Zero
+	if (! (res & 0x7fffffff))
+		return 0x00000000;
+	
+	return res;
+}
+
+//Retrieves float value from 32-bit integer. 
+float mtc_float_from_flt32(uint32_t v)
+{
+	float res;
+	
+	memcpy(&res, &v, 4);
+	
+	return res;
+}
+
+//Returns a 32-bit integer representing the given double value.
+uint32_t mtc_double_to_flt32(double v)
+{
+	return mtc_float_to_flt32((float) v);
+}
+
+//Retrieves double value from 32-bit integer. 
+double mtc_double_from_flt32(uint32_t v)
+{
+	return mtc_float_from_flt32(v);
+}
+
+//Returns a 64-bit integer representing the given double value.
+uint64_t mtc_double_to_flt64(double v)
+{
+	uint64_t res;
+	
+	memcpy(&res, &v, 8);
+	
+	//NaN
+	if ((res & 0x7ff0000000000000LL) == 0x7ff0000000000000LL 
+		&& (res & 0x000fffffffffffffLL))
+		return 0x7fffffffffffffffLL;
+	//Zero
+	if (! (res & 0x7fffffffffffffffLL))
+		return 0x0000000000000000LL;
+	
+	return res;
+}
+
+//Retrieves double value from 64-bit integer. 
+double mtc_double_from_flt64(uint64_t v)
+{
+	double res;
+	
+	memcpy(&res, &v, 8);
+	
+	return res;
+}
+
+#else
+
 //Returns a 32-bit integer representing the given float value.
 uint32_t mtc_float_to_flt32(float v)
 {
@@ -634,6 +708,8 @@ double mtc_double_from_flt64(uint64_t v)
 	return res;
 }
 
+#endif
+
 //Finds the type of floating point value in given 32-bit integer.
 MtcFltType mtc_flt32_classify(uint32_t val)
 {
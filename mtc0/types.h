@@ -41,6 +41,38 @@
 //byte order conversion
 
 //Common stuff used by all conversion logic
+//On hosts where the integer type is stored either in little endian or
+//in big endian byte order, conversion is done using memcpy(), which
+//compilers turn into a single (possibly unaligned) load and store,
+//followed by a byte swap on big endian hosts. Other hosts copy
+//one byte at a time.
+
+//Copies an integer of given width without changing byte order
+#define mtc_uint_copy_native(dest_ptr, src_ptr, bits) \
+	memcpy((dest_ptr), (src_ptr), (bits) / 8)
+
+#ifdef MTC_HAVE_BUILTIN_BSWAP
+//Copies an integer of given width reversing its byte order
+#define mtc_uint_copy_swapped(dest_ptr, src_ptr, bits) \
+do { \
+	uint ## bits ## _t mtc_swap_tmp; \
+	memcpy(&mtc_swap_tmp, (src_ptr), (bits) / 8); \
+	mtc_swap_tmp = __builtin_bswap ## bits(mtc_swap_tmp); \
+	memcpy((dest_ptr), &mtc_swap_tmp, (bits) / 8); \
+} while (0)
+#endif
+
+#if defined(MTC_UINT16_LITTLE_ENDIAN)
+#define mtc_uint16_copy_to_le(le_ptr, h_ptr) \
+	mtc_uint_copy_native(le_ptr, h_ptr, 16)
+#define mtc_uint16_copy_from_le(le_ptr, h_ptr) \
+	mtc_uint_copy_native(h_ptr, le_ptr, 16)
+#elif defined(MTC_UINT16_BIG_ENDIAN) && defined(MTC_HAVE_BUILTIN_BSWAP)
+#define mtc_uint16_copy_to_le(le_ptr, h_ptr) \
+	mtc_uint_copy_swapped(le_ptr, h_ptr, 16)
+#define mtc_uint16_copy_from_le(le_ptr, h_ptr) \
+	mtc_uint_copy_swapped(h_ptr, le_ptr, 16)
+#else
 /**Copies a 16-bit wide unsigned integer from h_ptr, converts it to
  * little endian byte order, and then stores it at le_ptr.
  * \param le_ptr Pointer to store converted value
@@ -62,7 +94,19 @@ do { \
 	((char *) (h_ptr))[0] = ((char *) (le_ptr))[MTC_UINT16_BYTE_0_SIGNIFICANCE]; \
 	((char *) (h_ptr))[1] = ((char *) (le_ptr))[MTC_UINT16_BYTE_1_SIGNIFICANCE]; \
 } while (0)
+#endif
 
+#if defined(MTC_UINT32_LITTLE_ENDIAN)
+#define mtc_uint32_copy_to_le(le_ptr, h_ptr) \
+	mtc_uint_copy_native(le_ptr, h_ptr, 32)
+#define mtc_uint32_copy_from_le(le_ptr, h_ptr) \
+	mtc_uint_copy_native(h_ptr, le_ptr, 32)
+#elif defined(MTC_UINT32_BIG_ENDIAN) && defined(MTC_HAVE_BUILTIN_BSWAP)
+#define mtc_uint32_copy_to_le(le_ptr, h_ptr) \
+	mtc_uint_copy_swapped(le_ptr, h_ptr, 32)
+#define mtc_uint32_copy_from_le(le_ptr, h_ptr) \
+	mtc_uint_copy_swapped(h_ptr, le_ptr, 32)
+#else
 /**Copies a 32-bit wide unsigned integer from h_ptr, converts it to
  * little endian byte order, and then stores it at le_ptr.
  * \param le_ptr Pointer to store converted value
@@ -88,7 +132,19 @@ do { \
 	((char *) (h_ptr))[2] = ((char *) (le_ptr))[MTC_UINT32_BYTE_2_SIGNIFICANCE]; \
 	((char *) (h_ptr))[3] = ((char *) (le_ptr))[MTC_UINT32_BYTE_3_SIGNIFICANCE]; \
 } while (0)
+#endif
 
+#if defined(MTC_UINT64_LITTLE_ENDIAN)
+#define mtc_uint64_copy_to_le(le_ptr, h_ptr) \
+	mtc_uint_copy_native(le_ptr, h_ptr, 64)
+#define mtc_uint64_copy_from_le(le_ptr, h_ptr) \
+	mtc_uint_copy_native(h_ptr, le_ptr, 64)
+#elif defined(MTC_UINT64_BIG_ENDIAN) && defined(MTC_HAVE_BUILTIN_BSWAP)
+#define mtc_uint64_copy_to_le(le_ptr, h_ptr) \
+	mtc_uint_copy_swapped(le_ptr, h_ptr, 64)
+#define mtc_uint64_copy_from_le(le_ptr, h_ptr) \
+	mtc_uint_copy_swapped(h_ptr, le_ptr, 64)
+#else
 /**Copies a 64-bit wide unsigned integer from h_ptr, converts it to
  * little endian byte order, and then stores it at le_ptr.
  * \param le_ptr Pointer to store converted value
@@ -122,6 +178,7 @@ do { \
 	((char *) (h_ptr))[6] = ((char *) (le_ptr))[MTC_UINT64_BYTE_6_SIGNIFICANCE]; \
 	((char *) (h_ptr))[7] = ((char *) (le_ptr))[MTC_UINT64_BYTE_7_SIGNIFICANCE]; \
 } while (0)
+#endif
 
 //16-bit
 #ifndef MTC_UINT16_LITTLE_ENDIAN
@@ -19,6 +19,7 @@
  */
 
 #include "common.h"
+#include "inline.h"
 
 //If you want to break at an error or warning break at this function.
 void mtc_warn_break(int to_abort)
@@ -28,6 +29,71 @@ void mtc_warn_break(int to_abort)
 }
 
 //Memory allocation functions
+static void *mtc_libc_alloc(void *ctx, size_t size)
+{
+	return malloc(size);
+}
+
+static void *mtc_libc_realloc(void *ctx, void *mem, size_t size)
+{
+	return realloc(mem, size);
+}
+
+static void mtc_libc_free(void *ctx, void *mem)
+{
+	free(mem);
+}
+
+static const MtcAllocator mtc_libc_allocator = 
+{
+	mtc_libc_alloc,
+	mtc_libc_realloc,
+	mtc_libc_free,
+	NULL
+};
+
+static MtcAllocator mtc_allocator = 
+{
+	mtc_libc_alloc,
+	mtc_libc_realloc,
+	mtc_libc_free,
+	NULL
+};
+
+void mtc_set_allocator(const MtcAllocator *allocator)
+{
+	if (allocator)
+		mtc_allocator = *allocator;
+	else
+		mtc_allocator = mtc_libc_allocator;
+}
+
+void mtc_get_allocator(MtcAllocator *allocator)
+{
+	*allocator = mtc_allocator;
+}
+
+void *mtc_tryalloc(size_t size)
+{
+	return (* mtc_allocator.alloc)(mtc_allocator.ctx, size);
+}
+
+void *mtc_tryrealloc(void *old_mem, size_t size)
+{
+	if (! old_mem)
+		return mtc_tryalloc(size);
+	
+	return (* mtc_allocator.realloc)(mtc_allocator.ctx, old_mem, size);
+}
+
+void mtc_free(void *mem)
+{
+	if (! mem)
+		return;
+	
+	(* mtc_allocator.free)(mtc_allocator.ctx, mem);
+}
+
 void *mtc_alloc(size_t size)
 {
 	void *mem = mtc_tryalloc(size);
@@ -88,12 +154,7 @@ void *mtc_tryalloc2(size_t size1, size_t size2, void **mem2_return)
 
 char *mtc_strdup(const char *str)
 {
-	char *res = strdup(str);
-	if (!res)
-	{
-		mtc_error("Memory allocation failed.");
-	}
-	return res;
+	return (char *) mtc_memdup(str, strlen(str) + 1);
 }
 
 void *mtc_memdup(const void *mem, size_t len)
@@ -103,46 +164,222 @@ void *mtc_memdup(const void *mem, size_t len)
 	return res;
 }
 
-//Reference counted memory
-typedef struct
+//Accounted and reference counted memory
+
+//The header placed before the memory, MtcRCMem, is in inline.h
+
+//Memory is counted only if it was allocated in current accounting 
+//epoch, so that frees never make counters go negative. 
+//Epoch 0 means accounting is disabled. Epochs are stored in 28 bits
+//of the header, so they only repeat after 2^28 - 1 counter resets.
+#define MTC_ALLOC_EPOCH_MAX ((1U << 28) - 1)
+
+static unsigned int mtc_alloc_epoch = 0;
+static unsigned int mtc_alloc_last_epoch = 0;
+static MtcAllocCounters mtc_alloc_counters[MTC_ALLOC_CAT_N];
+
+static void mtc_alloc_new_epoch(void)
 {
-	int refcount;
-} MtcRCMemMembers;
+	if (mtc_alloc_last_epoch == MTC_ALLOC_EPOCH_MAX)
+		mtc_alloc_last_epoch = 0;
+	mtc_alloc_last_epoch++;
+	mtc_alloc_epoch = mtc_alloc_last_epoch;
+	
+	memset(mtc_alloc_counters, 0, sizeof(mtc_alloc_counters));
+}
 
-typedef union
+void mtc_set_alloc_accounting(int enabled)
 {
-	MtcRCMemMembers s;
-	struct {
-		char d[mtc_offset_align(sizeof(MtcRCMemMembers))];
-	} pad;
-} MtcRCMem;
+	if (! enabled)
+		mtc_alloc_epoch = 0;
+	else if (! mtc_alloc_epoch)
+		mtc_alloc_new_epoch();
+}
 
-void *mtc_rcmem_alloc(size_t size)
+void mtc_get_alloc_counters
+	(MtcAllocCategory category, MtcAllocCounters *counters)
+{
+	*counters = mtc_alloc_counters[category];
+}
+
+void mtc_reset_alloc_counters(void)
+{
+	if (mtc_alloc_epoch)
+		mtc_alloc_new_epoch();
+	else
+		memset(mtc_alloc_counters, 0, sizeof(mtc_alloc_counters));
+}
+
+#define mtc_md_is_counted(md) \
+	((md)->s.counted && (md)->s.counted == mtc_alloc_epoch)
+
+//Counters may be updated from several threads with atomic reference 
+//counts. Peak is then updated on a best effort basis. 
+#ifdef MTC_ATOMIC_REFCOUNT
+#define mtc_counter_add(ptr, val) \
+	__atomic_add_fetch((ptr), (val), __ATOMIC_RELAXED)
+#else
+#define mtc_counter_add(ptr, val) (*(ptr) += (val))
+#endif
+
+static void mtc_alloc_count_bytes
+	(MtcAllocCounters *counters, size_t size)
+{
+	size_t bytes = mtc_counter_add(&(counters->bytes), size);
+	
+	if (bytes > counters->peak_bytes)
+		counters->peak_bytes = bytes;
+}
+
+static void mtc_alloc_count(MtcRCMem *md)
+{
+	MtcAllocCounters *counters = mtc_alloc_counters + md->s.category;
+	
+	mtc_counter_add(&(counters->n_allocs), 1);
+	mtc_alloc_count_bytes(counters, md->s.size);
+}
+
+static void mtc_alloc_uncount(MtcRCMem *md)
+{
+	MtcAllocCounters *counters = mtc_alloc_counters + md->s.category;
+	
+	mtc_counter_add(&(counters->n_frees), 1);
+	mtc_counter_add(&(counters->bytes), - md->s.size);
+}
+
+static MtcRCMem *mtc_md_tryalloc(size_t size, MtcAllocCategory category)
 {
-	MtcRCMem *md = mtc_alloc(sizeof(MtcRCMem) + size);
+	MtcRCMem *md = NULL;
+	size_t mmpool_threshold = mtc_mmpool_get_threshold();
+	
+	//Large memory comes from the mapping pool if enabled, 
+	//falling back to usual allocation
+	if (mmpool_threshold && size >= mmpool_threshold)
+		md = (MtcRCMem *) mtc_mmpool_alloc(sizeof(MtcRCMem) + size);
+	
+	if (md)
+	{
+		md->s.mapped = 1;
+	}
+	else
+	{
+		md = (MtcRCMem *) mtc_tryalloc(sizeof(MtcRCMem) + size);
+		if (! md)
+			return NULL;
+		md->s.mapped = 0;
+	}
 	
 	md->s.refcount = 1;
+	md->s.category = category;
+	md->s.size = size;
+	md->s.counted = mtc_alloc_epoch;
+	if (md->s.counted)
+		mtc_alloc_count(md);
 	
-	return (void *) (md + 1);
+	return md;
 }
 
-void *mtc_rcmem_tryalloc(size_t size)
+static MtcRCMem *mtc_md_alloc(size_t size, MtcAllocCategory category)
+{
+	MtcRCMem *md = mtc_md_tryalloc(size, category);
+	
+	if (! md)
+	{
+		mtc_error("Memory allocation failed.");
+	}
+	
+	return md;
+}
+
+static void mtc_md_free(MtcRCMem *md)
+{
+	if (mtc_md_is_counted(md))
+		mtc_alloc_uncount(md);
+	
+	if (md->s.mapped)
+		mtc_mmpool_free(md);
+	else
+		mtc_free(md);
+}
+
+void *mtc_alloc_cat(size_t size, MtcAllocCategory category)
+{
+	return (void *) (mtc_md_alloc(size, category) + 1);
+}
+
+void *mtc_tryalloc_cat(size_t size, MtcAllocCategory category)
 {
-	MtcRCMem *md = mtc_tryalloc(sizeof(MtcRCMem) + size);
+	MtcRCMem *md = mtc_md_tryalloc(size, category);
 	
 	if (! md)
 		return NULL;
 	
-	md->s.refcount = 1;
+	return (void *) (md + 1);
+}
+
+void *mtc_realloc_cat(void *old_mem, size_t size)
+{
+	MtcRCMem *md = ((MtcRCMem *) old_mem) - 1;
+	int counted;
+	
+	counted = mtc_md_is_counted(md);
+	if (counted)
+		mtc_counter_add(&(mtc_alloc_counters[md->s.category].bytes), 
+			- md->s.size);
+	
+	if (md->s.mapped)
+	{
+		md = (MtcRCMem *) mtc_mmpool_realloc(md, sizeof(MtcRCMem) + size);
+		if (! md)
+			mtc_error("Memory allocation failed.");
+	}
+	else
+	{
+		md = (MtcRCMem *) mtc_realloc(md, sizeof(MtcRCMem) + size);
+	}
+	
+	md->s.size = size;
+	if (counted)
+		mtc_alloc_count_bytes(mtc_alloc_counters + md->s.category, size);
 	
 	return (void *) (md + 1);
 }
 
+void mtc_free_cat(void *mem)
+{
+	mtc_md_free(((MtcRCMem *) mem) - 1);
+}
+
+void *mtc_rcmem_alloc(size_t size)
+{
+	return (void *) (mtc_md_alloc(size, MTC_ALLOC_CAT_OTHER) + 1);
+}
+
+void *mtc_rcmem_tryalloc(size_t size)
+{
+	return mtc_tryalloc_cat(size, MTC_ALLOC_CAT_OTHER);
+}
+
+void *mtc_rcmem_alloc_cat(size_t size, MtcAllocCategory category)
+{
+	return (void *) (mtc_md_alloc(size, category) + 1);
+}
+
+void *mtc_rcmem_tryalloc_cat(size_t size, MtcAllocCategory category)
+{
+	return mtc_tryalloc_cat(size, category);
+}
+
 void *mtc_rcmem_dup(const void *mem, size_t size)
 {
-	MtcRCMem *md = mtc_alloc(sizeof(MtcRCMem) + size);
+	return mtc_rcmem_dup_cat(mem, size, MTC_ALLOC_CAT_OTHER);
+}
+
+void *mtc_rcmem_dup_cat
+	(const void *mem, size_t size, MtcAllocCategory category)
+{
+	MtcRCMem *md = mtc_md_alloc(size, category);
 	
-	md->s.refcount = 1;
 	memcpy((void *) (md + 1), mem, size);
 	
 	return (void *) (md + 1);
@@ -150,29 +387,71 @@ void *mtc_rcmem_dup(const void *mem, size_t size)
 
 char *mtc_rcmem_strdup(const char *str)
 {
-	size_t size = strlen(str) + 1;
-	MtcRCMem *md = mtc_alloc(sizeof(MtcRCMem) + size);
-	
-	md->s.refcount = 1;
-	memcpy((void *) (md + 1), (void *) str, size);
-	
-	return (void *) (md + 1);
+	return (char *) mtc_rcmem_dup_cat
+		(str, strlen(str) + 1, MTC_ALLOC_CAT_STRING);
 }
 
 void mtc_rcmem_ref(void *mem)
+{
+	mtc_rcmem_ref_inline(mem);
+}
+
+void mtc_rcmem_unref(void *mem)
+{
+	mtc_rcmem_unref_inline(mem);
+}
+
+int mtc_rcmem_get_refcount(void *mem)
 {
 	MtcRCMem *md = ((MtcRCMem *) mem) - 1;
 	
-	md->s.refcount++;
+	return mtc_refcount_get(&(md->s.refcount));
 }
 
-void mtc_rcmem_unref(void *mem)
+size_t mtc_rcmem_get_size(void *mem)
 {
 	MtcRCMem *md = ((MtcRCMem *) mem) - 1;
 	
-	md->s.refcount--;
-	if (md->s.refcount <= 0)
-		mtc_free(md);
+	return md->s.size;
+}
+
+//MtcMBlock
+
+MtcMBlock mtc_mblock_init(void *mem, size_t size)
+{
+	MtcMBlock res;
+	
+	res.mem = mem;
+	res.size = size;
+	res.parent = NULL;
+	
+	return res;
+}
+
+void mtc_mblock_ref(MtcMBlock block)
+{
+	mtc_mblock_ref_inline(block);
+}
+
+void mtc_mblock_unref(MtcMBlock block)
+{
+	mtc_mblock_unref_inline(block);
+}
+
+MtcMBlock mtc_mblock_slice(MtcMBlock block, size_t offset, size_t size)
+{
+	MtcMBlock res;
+	
+	if (offset > block.size || size > block.size - offset)
+		mtc_error("Slice [%ld, +%ld] out of range of block of size %ld",
+			(long) offset, (long) size, (long) block.size);
+	
+	res.mem = MTC_PTR_ADD(block.mem, offset);
+	res.size = size;
+	res.parent = block.parent ? block.parent : block.mem;
+	mtc_rcmem_ref(res.parent);
+	
+	return res;
 }
 
 //MtcVector
@@ -102,15 +102,89 @@ do {\
  */
 void mtc_warn_break(int to_abort);
 
+//Reference counts
+//With MTC_ATOMIC_REFCOUNT (configure --enable-atomic-refcount) 
+//reference counts are atomic: increments are relaxed and the 
+//decrement is a release operation followed by an acquire fence 
+//when the count drops to 0, so that the thread destroying an object
+//sees all writes done by threads that released it.
+#ifdef MTC_ATOMIC_REFCOUNT
+
+#define mtc_refcount_inc(ptr) \
+	((void) __atomic_fetch_add((ptr), 1, __ATOMIC_RELAXED))
+
+#define mtc_refcount_dec_and_test(ptr) \
+	((__atomic_sub_fetch((ptr), 1, __ATOMIC_RELEASE) <= 0) \
+		&& (__atomic_thread_fence(__ATOMIC_ACQUIRE), 1))
+
+#define mtc_refcount_get(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+
+#else
+
+#define mtc_refcount_inc(ptr) ((void) ((*(ptr))++))
+
+#define mtc_refcount_dec_and_test(ptr) ((--(*(ptr))) <= 0)
+
+#define mtc_refcount_get(ptr) (*(ptr))
+
+#endif
+
 //Allocation
-#define mtc_free free
-#define mtc_tryalloc malloc
-#define mtc_tryrealloc realloc
+
+/**Function table of a memory allocator. All memory used by MTC
+ * (reference counted memory, messages, MtcVector, MtcAfl, 
+ * routers, destinations and links) is obtained from the installed
+ * allocator. 
+ */
+typedef struct
+{
+	///Allocates size bytes, returns NULL on failure
+	void *(*alloc)(void *ctx, size_t size);
+	///Resizes mem to size bytes, returns NULL on failure
+	void *(*realloc)(void *ctx, void *mem, size_t size);
+	///Frees mem
+	void (*free)(void *ctx, void *mem);
+	///Context pointer passed to all the functions above
+	void *ctx;
+} MtcAllocator;
+
+/**Installs a memory allocator. The allocator is copied.
+ * 
+ * As memory is freed using the allocator installed at the time it 
+ * is freed, this should be done before MTC allocates anything.
+ * \param allocator The allocator to install, or NULL to restore
+ *                  the default allocator based on malloc(), 
+ *                  realloc() and free().
+ */
+void mtc_set_allocator(const MtcAllocator *allocator);
+
+/**Gets the installed memory allocator.
+ * \param allocator Return location for the allocator
+ */
+void mtc_get_allocator(MtcAllocator *allocator);
+
+/* Allocates memory of size bytes. 
+ * \param size Number of bytes to allocate
+ * \return Newly allocated memory, free with mtc_free(), or NULL
+ */
+void *mtc_tryalloc(size_t size);
+
+/* Reallocates memory old_mem to size bytes.
+ * \param old_mem Original memory to resize
+ * \param size Number of bytes to allocate
+ * \return Newly allocated memory, free with mtc_free(), or NULL
+ */
+void *mtc_tryrealloc(void *old_mem, size_t size);
+
+/* Frees memory allocated by mtc_alloc() and friends.
+ * \param mem Memory to free
+ */
+void mtc_free(void *mem);
 
 /* Allocates memory of size bytes. If memory allocation fails the program is
  * aborted.
  * \param size Number of bytes to allocate
- * \return Newly allocated memory, free with free()
+ * \return Newly allocated memory, free with mtc_free()
  */
 void *mtc_alloc(size_t size);
 
@@ -118,7 +192,7 @@ void *mtc_alloc(size_t size);
  * aborted.
  * \param old_mem Original memory to resize
  * \param size Number of bytes to allocate
- * \return Newly allocated memory, free with free()
+ * \return Newly allocated memory, free with mtc_free()
  */
 void *mtc_realloc(void *old_mem, size_t size);
 
@@ -127,7 +201,7 @@ void *mtc_realloc(void *old_mem, size_t size);
  * \param size1 Number of bytes to allocate for first memory block
  * \param size2 Number of bytes to allocate for second memory block
  * \param mem2_return Return location for second memory block
- * \return First memory block, free with free() to free both memory blocks.
+ * \return First memory block, free with mtc_free() to free both memory blocks.
  */
 void *mtc_alloc2(size_t size1, size_t size2, void **mem2_return);
 
@@ -137,10 +211,86 @@ void *mtc_alloc2(size_t size1, size_t size2, void **mem2_return);
  * \param size1 Number of bytes to allocate for first memory block
  * \param size2 Number of bytes to allocate for second memory block
  * \param mem2_return Return location for second memory block
- * \return First memory block, free with free() to free both memory blocks.
+ * \return First memory block, free with mtc_free() to free both memory blocks.
  */
 void *mtc_tryalloc2(size_t size1, size_t size2, void **mem2_return);
 
+//Accounting
+
+///Categories memory allocations are accounted under
+typedef enum
+{
+	///Anything not covered by other categories
+	MTC_ALLOC_CAT_OTHER = 0,
+	///Messages (byte streams, message headers and received blocks)
+	MTC_ALLOC_CAT_MSG = 1,
+	///Strings and raw blocks copied during serialization
+	MTC_ALLOC_CAT_STRING = 2,
+	///Routers, destinations, addresses and their lookup tables
+	MTC_ALLOC_CAT_DEST = 3,
+	///Links, their buffers and flush operators
+	MTC_ALLOC_CAT_LINK = 4,
+	
+	MTC_ALLOC_CAT_N = 5
+} MtcAllocCategory;
+
+///Allocation counters of one category
+typedef struct
+{
+	///Number of allocations made
+	size_t n_allocs;
+	///Number of allocations freed
+	size_t n_frees;
+	///Number of bytes currently allocated
+	size_t bytes;
+	///Highest value bytes has reached
+	size_t peak_bytes;
+} MtcAllocCounters;
+
+/**Enables or disables allocation accounting. It is disabled by 
+ * default. Enabling accounting resets the counters, only 
+ * allocations made while accounting is enabled are counted.
+ * \param enabled Nonzero to enable accounting, 0 to disable it
+ */
+void mtc_set_alloc_accounting(int enabled);
+
+/**Gets the allocation counters of a category.
+ * \param category The category
+ * \param counters Return location for the counters
+ */
+void mtc_get_alloc_counters
+	(MtcAllocCategory category, MtcAllocCounters *counters);
+
+/**Resets allocation counters of all categories to 0. Memory that is
+ * allocated at the time will not be counted when freed.
+ */
+void mtc_reset_alloc_counters(void);
+
+/* Allocates memory of size bytes accounted under given category. 
+ * If memory allocation fails the program is aborted.
+ * \param size Number of bytes to allocate
+ * \param category Category to account the memory under
+ * \return Newly allocated memory, free with mtc_free_cat()
+ */
+void *mtc_alloc_cat(size_t size, MtcAllocCategory category);
+
+/* Like mtc_alloc_cat() but returns NULL on failure
+ */
+void *mtc_tryalloc_cat(size_t size, MtcAllocCategory category);
+
+/* Reallocates memory allocated by mtc_alloc_cat(). 
+ * If memory allocation fails the program is aborted.
+ * \param old_mem Original memory to resize
+ * \param size Number of bytes to allocate
+ * \return Newly allocated memory, free with mtc_free_cat()
+ */
+void *mtc_realloc_cat(void *old_mem, size_t size);
+
+/* Frees memory allocated by mtc_alloc_cat().
+ * \param mem Memory to free
+ */
+void mtc_free_cat(void *mem);
+
 #define mtc_alloc_boundary (2 * sizeof(void *))
 
 #define mtc_offset_align(offset) \
@@ -164,6 +314,24 @@ void *mtc_rcmem_alloc(size_t size);
  */
 void *mtc_rcmem_tryalloc(size_t size);
 
+/**Allocates reference counted memory of size bytes, accounted under
+ * given category. Newly allocated memory has reference count 1.
+ * If memory allocation fails the program is aborted.
+ * \param size Number of bytes to allocate
+ * \param category Category to account the memory under
+ * \return Newly allocated reference counted memory
+ */
+void *mtc_rcmem_alloc_cat(size_t size, MtcAllocCategory category);
+
+/**Allocates reference counted memory of size bytes, accounted under
+ * given category. Newly allocated memory has reference count 1.
+ * If memory allocation fails NULL is returned.
+ * \param size Number of bytes to allocate
+ * \param category Category to account the memory under
+ * \return Newly allocated reference counted memory, or NULL
+ */
+void *mtc_rcmem_tryalloc_cat(size_t size, MtcAllocCategory category);
+
 /**Copies given data into a newly allocated reference counted memory.
  * Newly allocated memory has reference count 1.
  * If memory allocation fails the program is aborted.
@@ -181,6 +349,18 @@ void *mtc_rcmem_dup(const void *mem, size_t size);
  */
 char *mtc_rcmem_strdup(const char *str);
 
+/**Copies given data into a newly allocated reference counted memory
+ * accounted under given category.
+ * Newly allocated memory has reference count 1.
+ * If memory allocation fails the program is aborted.
+ * \param mem The memory to copy data from
+ * \param size Number of bytes to allocate
+ * \param category Category to account the memory under
+ * \return Newly allocated reference counted memory
+ */
+void *mtc_rcmem_dup_cat
+	(const void *mem, size_t size, MtcAllocCategory category);
+
 /**Increments reference count of the memory.
  * \param mem Reference counted memory.
  */
@@ -192,15 +372,66 @@ void mtc_rcmem_ref(void *mem);
  */
 void mtc_rcmem_unref(void *mem);
 
+/**Gets the reference count of the memory.
+ * \param mem Reference counted memory.
+ * \return The reference count
+ */
+int mtc_rcmem_get_refcount(void *mem);
+
+/**Gets the size the reference counted memory was allocated with.
+ * \param mem Reference counted memory.
+ * \return Size of the memory in bytes
+ */
+size_t mtc_rcmem_get_size(void *mem);
+
 ///A structure representing a memory block.
+///
+///A block either refers to a whole reference counted memory, in which
+///case parent is NULL and mem points to its start, or it is a slice,
+///a range of bytes inside a reference counted memory pointed to by
+///parent. A slice shares the reference count of its parent.
+///Use mtc_mblock_ref() and mtc_mblock_unref() to manage references 
+///of a block.
 typedef struct
 {
-	///Memory block, reference counted.
+	///Memory block, reference counted unless parent is set.
 	void *mem;
 	///Size of the memory block.
 	size_t size;
+	///Reference counted memory containing the block if the block is
+	///a slice, NULL otherwise.
+	void *parent;
 } MtcMBlock;
 
+/**Returns a memory block referring to a whole reference counted 
+ * memory. Use it instead of setting members of MtcMBlock one by one,
+ * so that parent is never left uninitialized.
+ * \param mem Reference counted memory, or NULL for an empty block
+ * \param size Size of the memory block
+ * \return The memory block
+ */
+MtcMBlock mtc_mblock_init(void *mem, size_t size);
+
+/**Increments the reference count of the memory behind the block.
+ * \param block The memory block
+ */
+void mtc_mblock_ref(MtcMBlock block);
+
+/**Decrements the reference count of the memory behind the block.
+ * \param block The memory block
+ */
+void mtc_mblock_unref(MtcMBlock block);
+
+/**Creates a slice of a memory block. The slice holds a new reference
+ * to the memory behind the block, release it using mtc_mblock_unref().
+ * Aborts if the range lies outside the block.
+ * \param block The memory block
+ * \param offset Offset of the slice from start of the block
+ * \param size Size of the slice
+ * \return The slice
+ */
+MtcMBlock mtc_mblock_slice(MtcMBlock block, size_t offset, size_t size);
+
 //Like strdup() but aborts on allocation failures
 char *mtc_strdup(const char *str);
 //This is self explanatory